@@ -0,0 +1,165 @@
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+/*
+ * Cost of a phase transition across N processes: shm_barrier and
+ * shm_tree_barrier with different wait strategies against pipes to a
+ * coordinator.
+ *
+ * Usage: barrier_phase [processes] [phases]
+ */
+
+#include <pshm/shm_barrier.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using std::chrono::nanoseconds;
+using std::chrono::steady_clock;
+
+namespace
+{
+    void check(bool ok, const char* what)
+    {
+        if (!ok) {
+            std::perror(what);
+            std::exit(EXIT_FAILURE);
+        }
+    }
+
+    void wait_for(const std::vector<pid_t>& kids)
+    {
+        for (pid_t kid : kids) {
+            int wstatus;
+            check(waitpid(kid, &wstatus, 0) == kid && WIFEXITED(wstatus) && WEXITSTATUS(wstatus) == 0, "worker");
+        }
+    }
+
+    void report(const char* what, size_t phases, nanoseconds elapsed)
+    {
+        std::printf("%-32s %10lld ns per phase\n", what, static_cast<long long>(elapsed.count() / static_cast<long long>(phases)));
+    }
+
+    /**
+     * @brief Every worker tells the coordinator it's done, and the
+     * coordinator tells every worker to go on.
+     */
+    void bench_pipes(size_t processes, size_t phases)
+    {
+        /* Children would flush their copy of anything still buffered. */
+        std::fflush(stdout);
+        int up[2];
+        check(pipe(up) == 0, "pipe()");
+        std::vector<int> down;
+        std::vector<pid_t> kids;
+        for (size_t id = 1; id < processes; ++id) {
+            int fds[2];
+            check(pipe(fds) == 0, "pipe()");
+            pid_t kid = fork();
+            check(kid != -1, "fork()");
+            if (kid == 0) {
+                char c = 0;
+                for (size_t p = 0; p < phases; ++p) {
+                    check(write(up[1], &c, 1) == 1, "write()");
+                    check(read(fds[0], &c, 1) == 1, "read()");
+                }
+                _exit(EXIT_SUCCESS);
+            }
+            close(fds[0]);
+            down.push_back(fds[1]);
+            kids.push_back(kid);
+        }
+
+        auto start = steady_clock::now();
+        for (size_t p = 0; p < phases; ++p) {
+            char c;
+            for (size_t i = 1; i < processes; ++i)
+                check(read(up[0], &c, 1) == 1, "read()");
+            for (int fd : down)
+                check(write(fd, &c, 1) == 1, "write()");
+        }
+        report("pipes", phases, steady_clock::now() - start);
+
+        wait_for(kids);
+        for (int fd : down)
+            close(fd);
+        close(up[0]);
+        close(up[1]);
+    }
+
+    /**
+     * @param open makes the barrier for a participant id.
+     */
+    template <class Open, class WaitStrategy>
+    void bench_barrier(const char* what, size_t processes, size_t phases, Open open, WaitStrategy strategy)
+    {
+        std::fflush(stdout);
+        auto barrier = open(0);
+        std::vector<pid_t> kids;
+        for (size_t id = 1; id < processes; ++id) {
+            pid_t kid = fork();
+            check(kid != -1, "fork()");
+            if (kid == 0) {
+                auto mine = open(id);
+                for (size_t p = 0; p < phases; ++p)
+                    mine->arrive_and_wait(strategy);
+                _exit(EXIT_SUCCESS);
+            }
+            kids.push_back(kid);
+        }
+
+        /* Line everyone up first so fork() isn't part of the timing. */
+        barrier->arrive_and_wait(strategy);
+        auto start = steady_clock::now();
+        for (size_t p = 1; p < phases; ++p)
+            barrier->arrive_and_wait(strategy);
+        report(what, phases - 1, steady_clock::now() - start);
+
+        wait_for(kids);
+        pshm::wait_stats st = strategy.stats();
+        std::printf("%-32s spins %llu yields %llu parks %llu\n", "",
+                    static_cast<unsigned long long>(st.spins),
+                    static_cast<unsigned long long>(st.yields),
+                    static_cast<unsigned long long>(st.parks));
+    }
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    size_t processes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 8;
+    size_t phases = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 10000;
+    if (processes < 2)
+        processes = 2;
+    if (phases < 2)
+        phases = 2;
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    std::printf("%zu processes, %zu phases, %ld online CPUs\n", processes, phases, cpus);
+
+    const pshm::flags_t flags = pshm::flags::RDWR | pshm::flags::CREAT;
+    auto flat = [processes, flags](size_t) {
+        return std::make_unique<pshm::shm_barrier>("/pshm_barrier_phase", flags, processes);
+    };
+    auto tree = [processes, flags](size_t id) {
+        return std::make_unique<pshm::shm_tree_barrier>("/pshm_barrier_phase_tree", flags, processes, id);
+    };
+
+    bench_pipes(processes, phases);
+    bench_barrier("shm_barrier spin_park", processes, phases, flat, pshm::spin_park());
+    bench_barrier("shm_tree_barrier spin_park", processes, phases, tree, pshm::spin_park());
+    if (cpus >= static_cast<long>(processes)) {
+        bench_barrier("shm_barrier busy_spin", processes, phases, flat, pshm::busy_spin());
+        bench_barrier("shm_tree_barrier busy_spin", processes, phases, tree, pshm::busy_spin());
+    } else {
+        std::printf("%-32s skipped: needs a CPU per process\n", "busy_spin");
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,171 @@
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+/*
+ * Round trip latency of a small request/response between two processes:
+ * shm_rpc_channel with different wait strategies against a socketpair.
+ *
+ * Usage: rpc_latency [iterations]
+ */
+
+#include <pshm/shm_rpc_channel.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using std::chrono::nanoseconds;
+using std::chrono::steady_clock;
+
+namespace
+{
+    struct request {
+        uint64_t id;
+        uint64_t argument;
+    };
+
+    struct response {
+        uint64_t id;
+        uint64_t result;
+    };
+
+    /** Tells the worker to exit. */
+    constexpr uint64_t stop = ~uint64_t(0);
+
+    void handle(const request& req, response& resp)
+    {
+        resp.id = req.id;
+        resp.result = req.argument * 2 + 1;
+    }
+
+    void report(const char* what, std::vector<nanoseconds>& samples)
+    {
+        std::sort(samples.begin(), samples.end());
+        nanoseconds total(0);
+        for (auto s : samples)
+            total += s;
+        auto at = [&samples](double q) {
+            return static_cast<long long>(samples[static_cast<size_t>(q * (samples.size() - 1))].count());
+        };
+        std::printf("%-28s mean %8lld ns  p50 %8lld ns  p99 %8lld ns  max %8lld ns\n",
+                    what,
+                    static_cast<long long>(total.count() / static_cast<long long>(samples.size())),
+                    at(0.50), at(0.99), at(1.0));
+    }
+
+    void check(bool ok, const char* what)
+    {
+        if (!ok) {
+            std::perror(what);
+            std::exit(EXIT_FAILURE);
+        }
+    }
+
+    void wait_for(pid_t kid)
+    {
+        int wstatus;
+        check(waitpid(kid, &wstatus, 0) == kid && WIFEXITED(wstatus) && WEXITSTATUS(wstatus) == 0, "worker");
+    }
+
+    void bench_socketpair(size_t iterations)
+    {
+        int sv[2];
+        check(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0, "socketpair()");
+
+        pid_t kid = fork();
+        check(kid != -1, "fork()");
+        if (kid == 0) {
+            close(sv[0]);
+            request req;
+            while (read(sv[1], &req, sizeof(req)) == sizeof(req) && req.argument != stop) {
+                response resp;
+                handle(req, resp);
+                check(write(sv[1], &resp, sizeof(resp)) == sizeof(resp), "write()");
+            }
+            _exit(EXIT_SUCCESS);
+        }
+        close(sv[1]);
+
+        std::vector<nanoseconds> samples;
+        samples.reserve(iterations);
+        for (size_t i = 0; i < iterations; ++i) {
+            request req{i, i};
+            response resp;
+            auto start = steady_clock::now();
+            check(write(sv[0], &req, sizeof(req)) == sizeof(req), "write()");
+            check(read(sv[0], &resp, sizeof(resp)) == sizeof(resp), "read()");
+            samples.push_back(steady_clock::now() - start);
+        }
+        request done{0, stop};
+        check(write(sv[0], &done, sizeof(done)) == sizeof(done), "write()");
+        close(sv[0]);
+        wait_for(kid);
+
+        report("socketpair", samples);
+    }
+
+    template <class WaitStrategy>
+    void bench_rpc(const char* what, size_t iterations, WaitStrategy caller, WaitStrategy worker)
+    {
+        using channel_type = pshm::shm_rpc_channel<request, response>;
+        const std::string name = "/pshm_rpc_latency";
+        channel_type channel(name, pshm::flags::RDWR | pshm::flags::CREAT, 16);
+
+        pid_t kid = fork();
+        check(kid != -1, "fork()");
+        if (kid == 0) {
+            channel_type server(name, pshm::flags::RDWR, 16);
+            bool running = true;
+            while (running) {
+                server.serve_wait([&running](const request& req, response& resp) {
+                    running = (req.argument != stop);
+                    handle(req, resp);
+                }, worker);
+            }
+            _exit(EXIT_SUCCESS);
+        }
+
+        std::vector<nanoseconds> samples;
+        samples.reserve(iterations);
+        for (size_t i = 0; i < iterations; ++i) {
+            auto start = steady_clock::now();
+            channel.call(request{i, i}, caller);
+            samples.push_back(steady_clock::now() - start);
+        }
+        channel.call(request{0, stop}, caller);
+        wait_for(kid);
+
+        report(what, samples);
+        pshm::wait_stats st = caller.stats();
+        std::printf("%-28s caller spins %llu yields %llu parks %llu\n", "",
+                    static_cast<unsigned long long>(st.spins),
+                    static_cast<unsigned long long>(st.yields),
+                    static_cast<unsigned long long>(st.parks));
+    }
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    size_t iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+    if (iterations == 0)
+        iterations = 1;
+
+    std::printf("%zu round trips, %ld online CPUs\n", iterations, sysconf(_SC_NPROCESSORS_ONLN));
+    bench_socketpair(iterations);
+    bench_rpc("shm_rpc_channel spin_park", iterations, pshm::spin_park(), pshm::spin_park());
+    bench_rpc("shm_rpc_channel spin_yield", iterations, pshm::spin_yield(), pshm::spin_yield());
+    if (sysconf(_SC_NPROCESSORS_ONLN) > 1)
+        bench_rpc("shm_rpc_channel busy_spin", iterations, pshm::busy_spin(), pshm::busy_spin());
+    else
+        std::printf("%-28s skipped: needs more than one CPU\n", "shm_rpc_channel busy_spin");
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,72 @@
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+/*
+ * Write bandwidth into a segment with memcpy and copy_to_shared, and how much
+ * of a private working set survives each.
+ *
+ * Usage: shared_copy_bandwidth [megabytes]
+ */
+
+#include <pshm/shared_copy.hpp>
+#include <pshm/shm_object_native.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using std::chrono::duration;
+using std::chrono::steady_clock;
+
+namespace
+{
+    volatile uint64_t sink;
+
+    /** Time a pass over the working set: fast while it's cached. */
+    double touch(const std::vector<uint64_t>& working)
+    {
+        auto start = steady_clock::now();
+        uint64_t sum = 0;
+        for (size_t i = 0; i < working.size(); i += 8)
+            sum += working[i];
+        sink = sum;
+        return duration<double, std::micro>(steady_clock::now() - start).count();
+    }
+
+    template <class Copy>
+    void bench(const char* what, void* dst, const void* src, size_t n, std::vector<uint64_t>& working, Copy copy)
+    {
+        constexpr int rounds = 10;
+        double seconds = 0;
+        double after = 0;
+        for (int r = 0; r < rounds; ++r) {
+            touch(working);
+            auto start = steady_clock::now();
+            copy(dst, src, n);
+            seconds += duration<double>(steady_clock::now() - start).count();
+            after += touch(working);
+        }
+        std::printf("%-16s %8.2f GB/s   working set pass after copy %8.1f us\n",
+                    what, rounds * n / seconds / 1e9, after / rounds);
+    }
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    size_t mb = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 16;
+    if (mb == 0)
+        mb = 1;
+    const size_t n = mb * 1024 * 1024;
+
+    pshm::shm_object_native segment("/pshm_shared_copy_bandwidth", pshm::flags::RDWR | pshm::flags::CREAT, n, 0);
+    std::vector<uint8_t> src(n, 0x5a);
+    /* About the size of a typical L2. */
+    std::vector<uint64_t> working(1024 * 1024 / sizeof(uint64_t), 1);
+
+    std::printf("%zu MiB per copy, streaming with %s\n", mb, pshm::streaming_copy_isa());
+    bench("memcpy", segment.get(), src.data(), n, working, [](void* d, const void* s, size_t len) { std::memcpy(d, s, len); });
+    bench("copy_to_shared", segment.get(), src.data(), n, working, [](void* d, const void* s, size_t len) { pshm::copy_to_shared(d, s, len); });
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,168 @@
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+/*
+ * Read throughput of shm_shared_mutex as reader processes are added, against
+ * a process shared pthread_rwlock_t. Readers copy a small config struct
+ * under the lock; one writer updates it every millisecond.
+ *
+ * Usage: shared_mutex_readers [max readers] [milliseconds per run]
+ */
+
+#include <pshm/shm_shared_mutex.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+
+namespace
+{
+    struct config {
+        uint64_t values[8];
+    };
+
+    /** Shared between the benchmark processes. */
+    struct state {
+        pthread_rwlock_t rwlock;
+        std::atomic<bool> go;
+        std::atomic<bool> stop;
+        config cfg;
+        /** Reads done by each reader, on their own cache lines. */
+        struct {
+            uint64_t reads;
+            /** Keeps the copies from being optimized away. */
+            uint64_t checksum;
+            uint8_t pad[48];
+        } counts[256];
+    };
+
+    void check(bool ok, const char* what)
+    {
+        if (!ok) {
+            std::perror(what);
+            std::exit(EXIT_FAILURE);
+        }
+    }
+
+    /** Adapts pthread_rwlock_t to the SharedMutex names. */
+    struct rwlock_ref {
+        pthread_rwlock_t* rw;
+        void lock() { pthread_rwlock_wrlock(rw); }
+        void unlock() { pthread_rwlock_unlock(rw); }
+        void lock_shared() { pthread_rwlock_rdlock(rw); }
+        void unlock_shared() { pthread_rwlock_unlock(rw); }
+    };
+
+    /**
+     * @param open makes the lock in a freshly forked process.
+     * @returns reads per second, all readers together.
+     */
+    template <class Open>
+    double run(state* st, size_t readers, milliseconds duration, Open open)
+    {
+        /* Children would flush their copy of anything still buffered. */
+        std::fflush(stdout);
+        st->go = false;
+        st->stop = false;
+        for (size_t i = 0; i < readers; ++i)
+            st->counts[i].reads = 0;
+
+        std::vector<pid_t> kids;
+        for (size_t i = 0; i < readers; ++i) {
+            pid_t kid = fork();
+            check(kid != -1, "fork()");
+            if (kid == 0) {
+                auto lock = open();
+                uint64_t reads = 0;
+                uint64_t sum = 0;
+                while (!st->go.load(std::memory_order_acquire)) {
+                }
+                while (!st->stop.load(std::memory_order_relaxed)) {
+                    lock->lock_shared();
+                    config copy = st->cfg;
+                    lock->unlock_shared();
+                    sum += copy.values[reads & 7];
+                    reads++;
+                }
+                st->counts[i].reads = reads;
+                st->counts[i].checksum = sum;
+                _exit(EXIT_SUCCESS);
+            }
+            kids.push_back(kid);
+        }
+
+        auto writer = open();
+        auto start = steady_clock::now();
+        st->go.store(true, std::memory_order_release);
+        uint64_t version = 0;
+        while (steady_clock::now() - start < duration) {
+            std::this_thread::sleep_for(milliseconds(1));
+            writer->lock();
+            version++;
+            for (auto& v : st->cfg.values)
+                v = version;
+            writer->unlock();
+        }
+        st->stop = true;
+        double seconds = std::chrono::duration<double>(steady_clock::now() - start).count();
+
+        uint64_t total = 0;
+        for (size_t i = 0; i < readers; ++i) {
+            int wstatus;
+            check(waitpid(kids[i], &wstatus, 0) == kids[i] && WIFEXITED(wstatus), "reader");
+            total += st->counts[i].reads;
+        }
+        return total / seconds;
+    }
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    size_t max_readers = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 32;
+    milliseconds duration(argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 500);
+    if (max_readers == 0)
+        max_readers = 1;
+    if (max_readers > 256)
+        max_readers = 256;
+
+    const pshm::flags_t flags = pshm::flags::RDWR | pshm::flags::CREAT;
+    std::unique_ptr<pshm::shm_object> segment(pshm::make_shm_object("/pshm_shared_mutex_readers_state", flags, sizeof(state), 0));
+    state* st = static_cast<state*>(segment->get());
+    std::memset(static_cast<void*>(st), 0, sizeof(*st));
+
+    pthread_rwlockattr_t attr;
+    pthread_rwlockattr_init(&attr);
+    pthread_rwlockattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    check(pthread_rwlock_init(&st->rwlock, &attr) == 0, "pthread_rwlock_init()");
+    pthread_rwlockattr_destroy(&attr);
+
+    pshm::shm_shared_mutex keep("/pshm_shared_mutex_readers", flags);
+
+    std::printf("%ld online CPUs, %lld ms per run\n", sysconf(_SC_NPROCESSORS_ONLN), static_cast<long long>(duration.count()));
+    std::printf("%8s %22s %22s\n", "readers", "shm_shared_mutex Mr/s", "pthread_rwlock Mr/s");
+    for (size_t readers = 1; readers <= max_readers; readers *= 2) {
+        double shm = run(st, readers, duration, [] {
+            return std::make_unique<pshm::shm_shared_mutex>("/pshm_shared_mutex_readers", pshm::flags::RDWR);
+        });
+        double rw = run(st, readers, duration, [st] {
+            return std::make_unique<rwlock_ref>(rwlock_ref{&st->rwlock});
+        });
+        std::printf("%8zu %22.2f %22.2f\n", readers, shm / 1e6, rw / 1e6);
+    }
+
+    pthread_rwlock_destroy(&st->rwlock);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,175 @@
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+/*
+ * Scaling of shm_task_pool from 1 to N worker processes. The work is a
+ * binary tree of tasks: each one hashes for a while, stores the result in a
+ * shared arena at its offset and pushes its two children, so everything
+ * starts on worker 0 and the rest have to steal it.
+ *
+ * Usage: task_pool_scaling [max workers] [tree depth] [hash rounds per task]
+ */
+
+#include <pshm/shm_task_pool.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using std::chrono::steady_clock;
+
+namespace
+{
+    /** Names node offset of the tree, whose result goes to the arena. */
+    struct task {
+        uint32_t offset;
+        uint32_t depth;
+    };
+
+    /** Shared between the benchmark processes, ahead of the arena. */
+    struct state {
+        /** Tasks queued or running. Whoever takes it to 0 stops the pool. */
+        std::atomic<uint64_t> outstanding;
+        uint8_t pad[56];
+        /** Tasks run and stolen by each worker, on their own cache lines. */
+        struct {
+            uint64_t runs;
+            uint64_t steals;
+            uint8_t pad[48];
+        } counts[64];
+    };
+
+    void check(bool ok, const char* what)
+    {
+        if (!ok) {
+            std::perror(what);
+            std::exit(EXIT_FAILURE);
+        }
+    }
+
+    uint64_t hash(uint64_t x, unsigned rounds) noexcept
+    {
+        for (unsigned i = 0; i < rounds; ++i) {
+            x ^= x >> 33;
+            x *= 0xff51afd7ed558ccdULL;
+        }
+        return x;
+    }
+
+    void work(pshm::shm_task_pool<task>& pool, state* st, uint64_t* arena, unsigned rounds)
+    {
+        uint64_t runs = 0;
+        task t;
+        while (pool.next(t)) {
+            arena[t.offset] = hash(t.offset + 1, rounds);
+            runs++;
+            if (t.depth > 0) {
+                st->outstanding.fetch_add(2, std::memory_order_relaxed);
+                for (uint32_t child = 1; child <= 2; ++child) {
+                    task c{t.offset * 2 + child, t.depth - 1};
+                    /* Deque full: run it here instead. */
+                    if (!pool.push(c)) {
+                        arena[c.offset] = hash(c.offset + 1, rounds);
+                        st->outstanding.fetch_sub(1, std::memory_order_relaxed);
+                        check(c.depth == 0, "deque overflowed above a leaf");
+                    }
+                }
+            }
+            if (st->outstanding.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                pool.stop();
+        }
+        st->counts[pool.id()].runs = runs;
+        st->counts[pool.id()].steals = pool.steals();
+    }
+
+    /** @returns seconds to run the whole tree. */
+    double run(state* st, uint64_t* arena, size_t workers, uint32_t depth, unsigned rounds)
+    {
+        const std::string name = "/pshm_task_pool_scaling";
+        const pshm::flags_t flags = pshm::flags::RDWR | pshm::flags::CREAT;
+        /* Deep enough for a depth first walk of the whole tree. */
+        const size_t capacity = 2 * depth + 2;
+
+        /* Children would flush their copy of anything still buffered. */
+        std::fflush(stdout);
+        pshm::shm_task_pool<task> pool(name, flags, workers, capacity, 0);
+        std::memset(static_cast<void*>(st->counts), 0, sizeof(st->counts));
+
+        std::vector<pid_t> kids;
+        for (size_t id = 1; id < workers; ++id) {
+            pid_t kid = fork();
+            check(kid != -1, "fork()");
+            if (kid == 0) {
+                pshm::shm_task_pool<task> mine(name, pshm::flags::RDWR, workers, capacity, id);
+                work(mine, st, arena, rounds);
+                _exit(EXIT_SUCCESS);
+            }
+            kids.push_back(kid);
+        }
+
+        /* The other workers are asleep in next() by now, or soon will be. */
+        auto start = steady_clock::now();
+        st->outstanding = 1;
+        pool.push(task{0, depth});
+        work(pool, st, arena, rounds);
+        double seconds = std::chrono::duration<double>(steady_clock::now() - start).count();
+
+        for (pid_t kid : kids) {
+            int wstatus;
+            check(waitpid(kid, &wstatus, 0) == kid && WIFEXITED(wstatus) && WEXITSTATUS(wstatus) == 0, "worker");
+        }
+        return seconds;
+    }
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    size_t max_workers = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 64;
+    uint32_t depth = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 16;
+    unsigned rounds = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 1000;
+    if (max_workers == 0)
+        max_workers = 1;
+    if (max_workers > 64)
+        max_workers = 64;
+    if (depth > 24)
+        depth = 24;
+
+    const size_t nodes = (size_t(1) << (depth + 1)) - 1;
+    const pshm::flags_t flags = pshm::flags::RDWR | pshm::flags::CREAT;
+    std::unique_ptr<pshm::shm_object> segment(
+        pshm::make_shm_object("/pshm_task_pool_scaling_arena", flags, sizeof(state) + nodes * sizeof(uint64_t), 0));
+    state* st = static_cast<state*>(segment->get());
+    uint64_t* arena = reinterpret_cast<uint64_t*>(st + 1);
+    std::memset(static_cast<void*>(st), 0, sizeof(*st));
+
+    std::printf("%zu tasks of %u hash rounds, %ld online CPUs\n", nodes, rounds, sysconf(_SC_NPROCESSORS_ONLN));
+    std::printf("%8s %12s %10s %12s %12s %12s\n", "workers", "ms", "speedup", "Mtasks/s", "steals", "busiest");
+    double base = 0;
+    for (size_t workers = 1; workers <= max_workers; workers *= 2) {
+        double seconds = run(st, arena, workers, depth, rounds);
+        if (workers == 1)
+            base = seconds;
+
+        uint64_t runs = 0;
+        uint64_t steals = 0;
+        uint64_t busiest = 0;
+        for (size_t i = 0; i < workers; ++i) {
+            runs += st->counts[i].runs;
+            steals += st->counts[i].steals;
+            if (st->counts[i].runs > busiest)
+                busiest = st->counts[i].runs;
+        }
+        check(runs <= nodes, "tasks ran twice");
+        std::printf("%8zu %12.2f %10.2f %12.3f %12llu %11.1f%%\n", workers, seconds * 1e3, base / seconds,
+                    nodes / seconds / 1e6, static_cast<unsigned long long>(steals), 100.0 * busiest / runs);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,58 @@
+#ifndef PSHM_BIT_OPS__HPP
+#define PSHM_BIT_OPS__HPP
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include <pshm/config.hpp>
+#include <pshm/pshm_export.hpp>
+#include <pshm/stdcpp.hpp>
+
+namespace pshm
+{
+    /**
+     * @brief Count the set bits in an array of words.
+     *
+     * Uses AVX-512 VPOPCNTDQ or the POPCNT instruction when the CPU has them.
+     *
+     * @param words the words to count.
+     * @param n how many.
+     * @returns the number of set bits.
+     */
+    PSHM_EXPORT size_t popcount_words(const uint64_t* words, size_t n) noexcept;
+
+    /**
+     * @brief dst[i] |= src[i] for each word, atomically.
+     *
+     * Meant for merging a process local bitmap into a shared one. Chunks of
+     * src that would change nothing are ruled out with vector compares
+     * first, so sparse or already merged data neither pays for atomic
+     * read-modify-writes nor dirties the shared cache lines.
+     *
+     * @param dst the shared words.
+     * @param src the words to merge in.
+     * @param n how many.
+     * @returns the number of words that changed.
+     */
+    PSHM_EXPORT size_t atomic_or_words(std::atomic<uint64_t>* dst, const uint64_t* src, size_t n) noexcept;
+
+    /**
+     * @brief dst[i] &= src[i] for each word, atomically.
+     *
+     * As atomic_or_words() but skips chunks with no bits to clear.
+     *
+     * @param dst the shared words.
+     * @param src the words to intersect with.
+     * @param n how many.
+     * @returns the number of words that changed.
+     */
+    PSHM_EXPORT size_t atomic_and_words(std::atomic<uint64_t>* dst, const uint64_t* src, size_t n) noexcept;
+
+    /**
+     * @returns the name of the instruction set the bit operations use, e.g.
+     * "avx512vpopcntdq", or "generic".
+     */
+    PSHM_EXPORT const char* bit_ops_isa() noexcept;
+
+} // namespace pshm
+
+#endif // PSHM_BIT_OPS__HPP
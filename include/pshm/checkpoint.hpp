@@ -0,0 +1,94 @@
+#ifndef PSHM_CHECKPOINT__HPP
+#define PSHM_CHECKPOINT__HPP
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include <pshm/config.hpp>
+#include <pshm/pshm_export.hpp>
+#include <pshm/stdcpp.hpp>
+
+namespace pshm
+{
+    /**
+     * @brief Header at the start of a file written by shm_object::checkpoint().
+     *
+     * The data starts at data_offset, a block boundary, so it can be written
+     * and read with O_DIRECT.
+     */
+    struct checkpoint_header {
+        /** Value of magic: "PSCK" in memory on little endian machines. */
+        static constexpr uint32_t MAGIC = 0x4b435350;
+
+        /** Version of the file format. */
+        static constexpr uint32_t VERSION = 1;
+
+        /** Where the data starts in every version 1 file. */
+        static constexpr uint64_t DATA_OFFSET = 4096;
+
+        uint32_t magic;
+        uint32_t version;
+        uint64_t data_offset;
+        /** Bytes of data, i.e. the object's size(). */
+        uint64_t length;
+        /** checksum64() of the data. */
+        uint64_t checksum;
+        /** The segment_header's layout_hash, or 0 for plain objects. */
+        uint64_t layout_hash;
+        uint8_t reserved[24];
+    };
+
+    static_assert(sizeof(checkpoint_header) == 64, "checkpoint_header should be 64 bytes");
+
+    /**
+     * @brief Fast non-cryptographic checksum used by checkpoints.
+     *
+     * Reads 32 bytes per round in four independent lanes, so it keeps up
+     * with memory bandwidth rather than a byte at a time.
+     *
+     * @param data the bytes to sum.
+     * @param length how many.
+     * @returns the checksum.
+     */
+    PSHM_EXPORT uint64_t checksum64(const void* data, size_t length) noexcept;
+
+    /**
+     * @brief Write a checkpoint of a mapped file range.
+     *
+     * The data goes straight from fd to the file with copy_file_range() or
+     * sendfile() when the kernel allows it, otherwise it's written from the
+     * mapping, with O_DIRECT if the mapping is suitably aligned. The file is
+     * written under a unique temporary name next to path and renamed into
+     * place once synced, so path never holds a torn checkpoint, even with
+     * several writers: the last rename wins. The directory is synced after
+     * the rename so the new checkpoint survives a crash. Like the shared
+     * memory objects, the file is only accessible to its owner.
+     *
+     * @param path the checkpoint file.
+     * @param fd the object's file descriptor.
+     * @param fd_offset where data starts in fd.
+     * @param data the object's mapping of that range.
+     * @param length bytes to write.
+     * @param layout_hash recorded in the header.
+     * @throws std::runtime_error on I/O errors.
+     */
+    PSHM_EXPORT void write_checkpoint(const std::string& path, int fd, uint64_t fd_offset, const void* data, size_t length, uint64_t layout_hash);
+
+    /**
+     * @brief Read a checkpoint back into a mapped file range.
+     *
+     * The header and the checksum of the file's data are validated before
+     * anything is written, so a bad checkpoint leaves the range alone.
+     *
+     * @param path the checkpoint file.
+     * @param fd the object's file descriptor, opened for writing.
+     * @param fd_offset where data starts in fd.
+     * @param data the object's mapping of that range.
+     * @param length bytes expected.
+     * @param layout_hash expected in the header.
+     * @throws std::runtime_error if the file doesn't match or on I/O errors.
+     */
+    PSHM_EXPORT void read_checkpoint(const std::string& path, int fd, uint64_t fd_offset, void* data, size_t length, uint64_t layout_hash);
+
+} // namespace pshm
+
+#endif // PSHM_CHECKPOINT__HPP
@@ -0,0 +1,145 @@
+#ifndef PSHM_CONTROL_GROUP__HPP
+#define PSHM_CONTROL_GROUP__HPP
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include <pshm/config.hpp>
+#include <pshm/stdcpp.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define PSHM_CONTROL_GROUP_SSE2 1
+#else
+#define PSHM_CONTROL_GROUP_SSE2 0
+#endif
+
+namespace pshm
+{
+    /**
+     * @brief Snapshot of a group of control bytes for Swiss table style probing.
+     *
+     * Open addressing tables in pshm keep one control byte per slot: the high
+     * bit set means the slot is full and the low 7 bits are a tag taken from
+     * the key's hash. Matching a tag against a whole group at once makes
+     * misses cheap, since most groups can be ruled out without touching the
+     * slots themselves.
+     *
+     * The snapshot is taken with a plain vector load, so it may be stale by
+     * the time it's used. Treat matches as hints and confirm them with an
+     * atomic load of the control byte.
+     */
+    class control_group
+    {
+      public:
+        /** Control bytes per group. */
+        static constexpr size_t WIDTH = 16;
+
+        /** Slot has never been used. Zero so a fresh segment is all empty. */
+        static constexpr uint8_t EMPTY = 0x00;
+
+        /** Slot has been claimed and is being written. */
+        static constexpr uint8_t BUSY = 0x01;
+
+        /** Slot held an erased entry. */
+        static constexpr uint8_t DELETED = 0x02;
+
+        /** Set in the control byte of full slots. */
+        static constexpr uint8_t FULL = 0x80;
+
+        /**
+         * @brief Load a group.
+         *
+         * @param ctrl the first of WIDTH control bytes. Should be 16 byte aligned.
+         */
+        explicit control_group(const std::atomic<uint8_t>* ctrl) noexcept
+        {
+            static_assert(sizeof(std::atomic<uint8_t>) == 1, "control bytes must be bytes");
+#if PSHM_CONTROL_GROUP_SSE2
+            mBytes = _mm_load_si128(reinterpret_cast<const __m128i*>(ctrl));
+#else
+            for (size_t i = 0; i < WIDTH; ++i)
+                mBytes[i] = ctrl[i].load(std::memory_order_relaxed);
+#endif
+        }
+
+        /**
+         * @brief Find the control bytes equal to byte.
+         *
+         * @param byte the value to look for.
+         * @returns a bit mask where bit i is set if the i'th byte matched.
+         */
+        uint32_t match(uint8_t byte) const noexcept
+        {
+#if PSHM_CONTROL_GROUP_SSE2
+            __m128i m = _mm_cmpeq_epi8(mBytes, _mm_set1_epi8(static_cast<char>(byte)));
+            return static_cast<uint32_t>(_mm_movemask_epi8(m));
+#else
+            uint32_t mask = 0;
+            for (size_t i = 0; i < WIDTH; ++i) {
+                if (mBytes[i] == byte)
+                    mask |= 1u << i;
+            }
+            return mask;
+#endif
+        }
+
+        /**
+         * @brief Make the tag stored in the control byte of a full slot.
+         *
+         * @param hash the key's hash.
+         */
+        static constexpr uint8_t tag(uint64_t hash) noexcept
+        {
+            return static_cast<uint8_t>(FULL | (hash & 0x7f));
+        }
+
+        /**
+         * @brief Index of the lowest set bit in a mask from match().
+         *
+         * @param mask must not be 0.
+         */
+        static int lowest(uint32_t mask) noexcept
+        {
+#if defined(__GNUC__)
+            return __builtin_ctz(mask);
+#else
+            int i = 0;
+            while ((mask & 1) == 0) {
+                mask >>= 1;
+                i++;
+            }
+            return i;
+#endif
+        }
+
+      private:
+#if PSHM_CONTROL_GROUP_SSE2
+        __m128i mBytes;
+#else
+        uint8_t mBytes[WIDTH];
+#endif
+    };
+
+    /**
+     * @brief Spread the bits of a std::hash value.
+     *
+     * std::hash is the identity for integers on common implementations, which
+     * would leave the tag bits all but constant.
+     *
+     * @param h the hash to mix.
+     * @returns the mixed hash.
+     */
+    constexpr uint64_t mix_hash(uint64_t h) noexcept
+    {
+        /* MurmurHash3's fmix64. */
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ull;
+        h ^= h >> 33;
+        return h;
+    }
+
+} // namespace pshm
+
+#endif // PSHM_CONTROL_GROUP__HPP
@@ -0,0 +1,30 @@
+#ifndef PSHM_CPU_RELAX__HPP
+#define PSHM_CPU_RELAX__HPP
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+#endif
+
+namespace pshm
+{
+    /**
+     * @brief Tell the CPU we're in a spin loop.
+     *
+     * Uses the pause instruction on x86 and yield on ARM. This keeps a spinning
+     * hyperthread from starving its sibling and avoids the memory order
+     * mis-speculation penalty when the spin ends.
+     */
+    inline void cpu_relax() noexcept
+    {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+        _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+        __asm__ __volatile__("yield");
+#endif
+    }
+
+} // namespace pshm
+
+#endif // PSHM_CPU_RELAX__HPP
@@ -0,0 +1,56 @@
+#ifndef PSHM_FD_PASSING__HPP
+#define PSHM_FD_PASSING__HPP
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include <pshm/config.hpp>
+#include <pshm/pshm_export.hpp>
+#include <pshm/stdcpp.hpp>
+
+#include <system_error>
+
+namespace pshm
+{
+    /**
+     * @brief Send a file descriptor over a unix domain socket.
+     *
+     * The descriptor travels as SCM_RIGHTS ancillary data along with one byte
+     * of payload. The receiver gets its own descriptor for the same open file.
+     *
+     * @param socket a connected AF_UNIX socket.
+     * @param fd the descriptor to send.
+     * @throws std::runtime_error if sendmsg() fails.
+     */
+    PSHM_EXPORT void send_fd(int socket, int fd);
+
+    /**
+     * @brief Receive a file descriptor sent with send_fd().
+     *
+     * @param socket a connected AF_UNIX socket.
+     * @returns the new descriptor, opened close-on-exec. The caller owns it.
+     * @throws std::runtime_error if recvmsg() fails or no descriptor came with
+     * the message.
+     */
+    PSHM_EXPORT int receive_fd(int socket);
+
+    /**
+     * @brief Get a copy of another process's file descriptor.
+     *
+     * Uses pidfd_getfd() where the kernel has it, which works for any kind of
+     * descriptor but needs ptrace access to pid. Otherwise it falls back to
+     * opening /proc/<pid>/fd/<fd>, which only works for things that can be
+     * reopened by path: not eventfds, sockets or other anonymous inodes. Use
+     * send_fd() when neither is available.
+     *
+     * @param pid the process that has the descriptor.
+     * @param fd the descriptor number in that process.
+     * @returns the new descriptor, opened close-on-exec. The caller owns it.
+     * @throws std::system_error with the errno on failure: ESRCH if pid is
+     * gone, EBADF or ENOENT if it has no such descriptor, EPERM or EACCES if
+     * this process may not take it.
+     */
+    PSHM_EXPORT int duplicate_fd(int pid, int fd);
+
+} // namespace pshm
+
+#endif // PSHM_FD_PASSING__HPP
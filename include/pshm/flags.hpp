@@ -46,6 +46,47 @@ namespace pshm
          * If exists then truncate to zero bytes.
          */
         static constexpr flags_t TRUNC = 00001000;
+
+        /**
+         * Keep a pshm::segment_header at the start of the object.
+         *
+         * pshm specific, there is no fcntl.h equivalent. The creator writes
+         * the header and the attachers validate it against the layout they
+         * expect instead of resizing the object. Requires an offset of 0.
+         *
+         * @see pshm::segment_header.
+         */
+        static constexpr flags_t HEADER = 0100000000;
+
+        /**
+         * Unlink the name when the handle that created the object goes away.
+         *
+         * pshm specific. This is the default lifetime: handles that only
+         * attached never unlink.
+         *
+         * With HEADER the creator's lifetime flag is recorded in the
+         * segment_header, and attachers using a different one are rejected.
+         */
+        static constexpr flags_t UNLINK_OWNER = 0200000000;
+
+        /**
+         * Unlink the name when the last attached handle goes away.
+         *
+         * pshm specific. Handles are counted in the segment_header, so this
+         * requires HEADER and RDWR. A process that dies without running its
+         * destructors leaves the count up and the object in place.
+         */
+        static constexpr flags_t UNLINK_LAST = 0400000000;
+
+        /**
+         * Never unlink the name.
+         *
+         * pshm specific. The object and its contents outlive every process
+         * until it's removed explicitly, so a restarted producer can attach
+         * to its old state. Requires HEADER, which records it so
+         * pshm-inspect --remove-stale leaves the object alone.
+         */
+        static constexpr flags_t PERSISTENT = 01000000000;
     };
 
 } // namespace pshm
@@ -0,0 +1,55 @@
+#ifndef PSHM_FUTEX__HPP
+#define PSHM_FUTEX__HPP
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include <pshm/config.hpp>
+#include <pshm/pshm_export.hpp>
+#include <pshm/stdcpp.hpp>
+
+#include <chrono>
+
+namespace pshm
+{
+    /**
+     * @brief Block while word still holds expected.
+     *
+     * On Linux this is FUTEX_WAIT without FUTEX_PRIVATE_FLAG, so it works on
+     * words in shared memory across processes. Elsewhere it degrades to
+     * yielding until the value changes.
+     *
+     * May return spuriously: always re-check the condition you're waiting on.
+     *
+     * @param word the word to wait on. Should be in shared memory.
+     * @param expected return immediately if word doesn't hold this.
+     */
+    PSHM_EXPORT void futex_wait(std::atomic<uint32_t>& word, uint32_t expected) noexcept;
+
+    /**
+     * @brief Block while word still holds expected, for at most timeout.
+     *
+     * @param word the word to wait on. Should be in shared memory.
+     * @param expected return immediately if word doesn't hold this.
+     * @param timeout how long to wait.
+     * @returns false if the timeout expired.
+     */
+    PSHM_EXPORT bool futex_wait_for(std::atomic<uint32_t>& word, uint32_t expected, std::chrono::nanoseconds timeout) noexcept;
+
+    /**
+     * @brief Wake up to count waiters blocked on word.
+     *
+     * @param word the word being waited on.
+     * @param count how many to wake.
+     */
+    PSHM_EXPORT void futex_wake(std::atomic<uint32_t>& word, int count) noexcept;
+
+    /**
+     * @brief Wake everyone blocked on word.
+     *
+     * @param word the word being waited on.
+     */
+    PSHM_EXPORT void futex_wake_all(std::atomic<uint32_t>& word) noexcept;
+
+} // namespace pshm
+
+#endif // PSHM_FUTEX__HPP
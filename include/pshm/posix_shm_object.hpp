@@ -23,24 +23,87 @@ namespace pshm
          * in shared memory. For portability this should begin with '/' on unix
          * platforms.
          *
-         * @param flags the file control flags.
+         * @param flags the file control flags. At most one of
+         * flags::UNLINK_OWNER, flags::UNLINK_LAST and flags::PERSISTENT picks
+         * when the name is unlinked, UNLINK_OWNER by default.
          *
          * @param length the length of the mapping starting at offset.
          *
-         * @param offset the offset into the mapping to start.
+         * @param offset the offset into the mapping to start. Must be a
+         * multiple of the page size. To walk an object bigger than the
+         * address space, see pshm::shm_window.
+         *
+         * @throws std::invalid_argument if offset isn't page aligned or the
+         * lifetime flags conflict.
          *
          * @see pshm::flags.
          * @see pshm::shm_ptr.
          */
         posix_shm_object(const string_type& name, flags_type flags, size_type length, offset_type offset);
 
+        /**
+         * @brief Construct a new shm object object with a known layout.
+         *
+         * Same as above but when flags includes flags::HEADER: the creator
+         * records layout in the segment_header and attachers throw if their
+         * layout doesn't match the creator's. Attachers do not resize the
+         * object.
+         *
+         * @param name two objects with the same name refer to the same object
+         * in shared memory. For portability this should begin with '/' on unix
+         * platforms.
+         *
+         * @param flags the file control flags.
+         *
+         * @param length the length of the mapping starting at offset. Must
+         * equal layout.size.
+         *
+         * @param offset the offset into the mapping to start.
+         *
+         * @param layout describes what's stored in the object.
+         *
+         * @see pshm::segment_header.
+         */
+        posix_shm_object(const string_type& name, flags_type flags, size_type length, offset_type offset, const segment_layout& layout);
+
+        /**
+         * @brief Open with a segment_header, building the payload once.
+         *
+         * As above, but the process that creates the object calls init on
+         * the payload before marking the header ready. Attachers wait for
+         * that, so nobody sees a half built payload.
+         *
+         * If init throws the object is unlinked and the exception propagates.
+         * Attachers already waiting time out.
+         *
+         * @param init builds the payload. May be empty.
+         */
+        posix_shm_object(const string_type& name, flags_type flags, size_type length, offset_type offset, const segment_layout& layout, initializer_type init);
+
         /**
          * @brief Destroy the shm object unix object.
          *
-         * Effectively calls munmap() on the pointer.
+         * Effectively calls munmap() on the pointer, then shm_unlink() if the
+         * lifetime flags say this handle is the last one that matters.
          */
         virtual ~posix_shm_object();
 
+        /**
+         * @brief Remove a name, e.g. of a flags::PERSISTENT object.
+         *
+         * Handles that are still open keep working.
+         *
+         * @param name the shared memory object name.
+         * @returns false if there was no such object.
+         * @throws std::runtime_error on other errors.
+         */
+        static bool unlink(const string_type& name);
+
+        /**
+         * @returns true if this handle created the object.
+         */
+        bool created() const noexcept;
+
         /**
          * @brief Move Constructor.
          * 
@@ -59,10 +122,62 @@ namespace pshm
          */
         void* get() const noexcept override;
 
+        /** @returns the segment header or nullptr.
+         */
+        const segment_header* header() const noexcept override;
+
+        using shm_object::advise;
+
+        /** @brief Calls madvise() on the range.
+         */
+        void advise(size_type offset, size_type length, advice hint) override;
+
+        /** @brief Calls mincore() on the whole object.
+         */
+        size_type resident_bytes() const override;
+
+        /** @brief Calls mincore() on the range.
+         */
+        std::vector<bool> residency(size_type offset, size_type length) const override;
+
+        /** @brief Copies to path with copy_file_range() or sendfile().
+         */
+        void checkpoint(const string_type& path) const override;
+
+        /** @brief Copies from path with copy_file_range() or sendfile().
+         */
+        void restore(const string_type& path) override;
+
       private:
         PSHM_DECLARE_ALLOCATION_TRACER();
         void* mPointer;
+        void* mMapping;
+        size_type mMappingSize;
         int mFile;
+        bool mCreator;
+
+        /**
+         * @brief Unmap, close and unlink as the lifetime flags say.
+         *
+         * Shared by the destructor and move assignment. Leaves the handle
+         * empty.
+         */
+        void release() noexcept;
+
+        /**
+         * @brief Open and map without a segment_header.
+         */
+        void open_plain();
+
+        /**
+         * @brief Open and map with a segment_header.
+         *
+         * @param layout written by the creator, validated by attachers.
+         * @param init run by the creator before the header is ready.
+         * @returns false if the last flags::UNLINK_LAST handle is unlinking
+         * the object, so it should be opened again.
+         */
+        bool open_with_header(const segment_layout& layout, const initializer_type& init);
     };
 
 } // namespace pshm
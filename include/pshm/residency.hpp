@@ -0,0 +1,88 @@
+#ifndef PSHM_RESIDENCY__HPP
+#define PSHM_RESIDENCY__HPP
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include <pshm/config.hpp>
+#include <pshm/pshm_export.hpp>
+#include <pshm/stdcpp.hpp>
+
+#include <vector>
+
+namespace pshm
+{
+    /** @returns the system page size. */
+    PSHM_EXPORT size_t page_size() noexcept;
+
+    /**
+     * @brief Which pages of a mapping are in physical memory.
+     *
+     * Asks the kernel with mincore(). Nothing is faulted in.
+     *
+     * @param address start of the range. Rounded down to a page.
+     * @param length size of the range in bytes.
+     * @returns one entry per page, true if resident.
+     * @throws std::runtime_error if mincore() fails, e.g. the range isn't
+     * mapped.
+     */
+    PSHM_EXPORT std::vector<bool> residency_map(const void* address, size_t length);
+
+    /**
+     * @brief How much of a mapping is in physical memory.
+     *
+     * @param address start of the range. Rounded down to a page.
+     * @param length size of the range in bytes.
+     * @returns resident pages times the page size, at most length rounded up
+     * to whole pages.
+     * @throws std::runtime_error if mincore() fails.
+     */
+    PSHM_EXPORT size_t resident_bytes(const void* address, size_t length);
+
+    /**
+     * @brief A mapping made by a live shm_object in this process.
+     */
+    struct mapping_info {
+        std::string name;
+        const void* address;
+        /** Mapped bytes, including any segment_header. */
+        size_t length;
+        /** Resident bytes when the summary was taken. */
+        size_t resident;
+    };
+
+    /**
+     * @brief Every live pshm mapping in this process.
+     */
+    struct mapping_summary {
+        std::vector<mapping_info> mappings;
+        size_t mapped_bytes;
+        size_t resident_bytes;
+    };
+
+    /**
+     * @brief Take stock of this process's pshm mappings.
+     *
+     * Costs a mincore() per mapping. Objects created or destroyed by other
+     * threads while this runs may or may not be included.
+     *
+     * @returns the mappings with their resident sizes and totals.
+     */
+    PSHM_EXPORT mapping_summary summarize_mappings();
+
+    /**
+     * @brief Add a mapping to the process registry.
+     *
+     * For shm_object implementations. Call once the mapping is made.
+     */
+    PSHM_EXPORT void register_mapping(const std::string& name, const void* address, size_t length);
+
+    /**
+     * @brief Remove a mapping from the process registry.
+     *
+     * For shm_object implementations. Call before unmapping.
+     */
+    PSHM_EXPORT void unregister_mapping(const void* address) noexcept;
+
+} // namespace pshm
+
+#endif // PSHM_RESIDENCY__HPP
@@ -0,0 +1,171 @@
+#ifndef PSHM_SEGMENT_HEADER__HPP
+#define PSHM_SEGMENT_HEADER__HPP
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include <pshm/config.hpp>
+#include <pshm/stdcpp.hpp>
+
+namespace pshm
+{
+    /**
+     * @brief Version of the user's type stored in a segment.
+     *
+     * Specialize this and bump value when T changes in a way that sizeof() and
+     * alignof() don't notice, e.g. two int fields being swapped around. It is
+     * mixed into layout_hash<T>().
+     *
+     * @tparam T the type stored in shared memory.
+     */
+    template <class T>
+    struct layout_version {
+        static constexpr uint64_t value = 0;
+    };
+
+    /**
+     * @brief Mix a value into a 64-bit FNV-1a hash.
+     *
+     * @param hash the hash so far.
+     * @param value hashed one byte at a time, least significant first.
+     * @returns the new hash.
+     */
+    constexpr uint64_t fnv1a_mix(uint64_t hash, uint64_t value) noexcept
+    {
+        for (int i = 0; i < 8; ++i) {
+            hash ^= (value >> (i * 8)) & 0xff;
+            hash *= 0x100000001b3ull;
+        }
+        return hash;
+    }
+
+    /**
+     * @brief Compile time hash describing the layout of T.
+     *
+     * Covers sizeof(T), alignof(T), the layout related type traits, and
+     * layout_version<T>. Two processes that disagree on any of these can't
+     * safely share a T.
+     *
+     * @tparam T the type stored in shared memory.
+     */
+    template <class T>
+    constexpr uint64_t layout_hash() noexcept
+    {
+        uint64_t h = 0xcbf29ce484222325ull;
+        h = fnv1a_mix(h, sizeof(T));
+        h = fnv1a_mix(h, alignof(T));
+        h = fnv1a_mix(h, std::is_trivially_copyable<T>::value);
+        h = fnv1a_mix(h, std::is_standard_layout<T>::value);
+        h = fnv1a_mix(h, layout_version<T>::value);
+        return h;
+    }
+
+    /**
+     * @brief Describes the payload of a segment.
+     *
+     * Used by creators to fill in the segment_header and by attachers to
+     * validate it.
+     */
+    struct segment_layout {
+        /** Size of the payload in bytes. */
+        uint64_t size;
+
+        /** Required alignment of the payload. */
+        uint64_t alignment;
+
+        /** The layout_hash() of the payload, or 0 for untyped memory. */
+        uint64_t hash;
+    };
+
+    /**
+     * @brief Make the segment_layout for T.
+     *
+     * @tparam T the type stored in shared memory.
+     */
+    template <class T>
+    constexpr segment_layout make_segment_layout() noexcept
+    {
+        return segment_layout{sizeof(T), alignof(T), layout_hash<T>()};
+    }
+
+    /**
+     * @brief Metadata at the start of a segment opened with flags::HEADER.
+     *
+     * The creator fills this in and then sets state to READY with a release
+     * store. Attachers wait for READY and compare the fields against their own
+     * segment_layout instead of resizing the object.
+     *
+     * The payload starts payload_offset bytes after the header's address.
+     */
+    struct segment_header {
+        /** Value of magic: "PSHM" in memory on little endian machines. */
+        static constexpr uint32_t MAGIC = 0x4d485350;
+
+        /** Version of this structure. */
+        static constexpr uint32_t VERSION = 2;
+
+        /** Values of state. */
+        enum : uint32_t {
+            /** Fresh from ftruncate(). */
+            UNINITIALIZED = 0,
+            /** The creator is filling in the segment. */
+            INITIALIZING = 1,
+            /** The header and payload are safe to use. */
+            READY = 2,
+        };
+
+        /** Values of lifetime, one per lifetime flag. */
+        enum : uint8_t {
+            /** flags::UNLINK_OWNER, or no lifetime flag. */
+            LIFETIME_OWNER = 0,
+            /** flags::UNLINK_LAST. */
+            LIFETIME_LAST = 1,
+            /** flags::PERSISTENT. */
+            LIFETIME_PERSISTENT = 2,
+        };
+
+        std::atomic<uint32_t> state;
+        uint32_t magic;
+        uint32_t version;
+        /** PSHM_VERSION_CODE of the creator. */
+        uint32_t library_version;
+        uint64_t payload_size;
+        uint64_t payload_offset;
+        uint64_t alignment;
+        uint64_t layout_hash;
+        /**
+         * Bumped around changes to the payload, see shm_write_epoch. The low
+         * 32 bits count writers in progress and the high 32 bits count
+         * finished writes.
+         */
+        std::atomic<uint64_t> write_epoch;
+        /**
+         * Handles attached with flags::UNLINK_LAST. Never raised from 0: once
+         * the last handle takes it there the object is on its way out.
+         */
+        std::atomic<uint32_t> attached;
+        /** The creator's lifetime flag. Attachers must use the same one. */
+        uint8_t lifetime;
+        uint8_t reserved[3];
+    };
+
+    static_assert(sizeof(segment_header) == 64, "segment_header should fill one cache line");
+    /* Not is_trivial: C++20 made std::atomic's default constructor non-trivial. */
+    static_assert(std::is_standard_layout<segment_header>::value && std::is_trivially_destructible<segment_header>::value,
+                  "segment_header lives in shared memory");
+
+    /**
+     * @brief Where the payload goes relative to the segment_header.
+     *
+     * @param alignment the payload's alignment.
+     * @returns sizeof(segment_header) rounded up to alignment.
+     */
+    constexpr uint64_t segment_payload_offset(uint64_t alignment) noexcept
+    {
+        return alignment <= sizeof(segment_header)
+                   ? sizeof(segment_header)
+                   : (sizeof(segment_header) + alignment - 1) / alignment * alignment;
+    }
+
+} // namespace pshm
+
+#endif // PSHM_SEGMENT_HEADER__HPP
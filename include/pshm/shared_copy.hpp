@@ -0,0 +1,77 @@
+#ifndef PSHM_SHARED_COPY__HPP
+#define PSHM_SHARED_COPY__HPP
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include <pshm/config.hpp>
+#include <pshm/pshm_export.hpp>
+#include <pshm/stdcpp.hpp>
+
+#include <cstddef>
+#include <cstring>
+
+namespace pshm
+{
+    /**
+     * @brief Copies at least this large bypass the cache in copy_to_shared().
+     *
+     * Below this the data is likely still in cache when the reader gets to it,
+     * and the fence costs more than the pollution.
+     */
+    constexpr size_t streaming_copy_threshold = 256 * 1024;
+
+    /**
+     * @brief Copy n bytes with non-temporal stores, whatever the size.
+     *
+     * Picks AVX-512, AVX or SSE2 streaming stores at run time depending on
+     * what the CPU supports, and plain memcpy elsewhere. Ends with a store
+     * fence, so the data is visible before any release store that follows.
+     *
+     * @returns dst.
+     */
+    PSHM_EXPORT void* streaming_copy(void* dst, const void* src, size_t n) noexcept;
+
+    /**
+     * @returns the name of the instruction set streaming_copy() uses, e.g.
+     * "avx512f", or "memcpy".
+     */
+    PSHM_EXPORT const char* streaming_copy_isa() noexcept;
+
+    /**
+     * @brief Copy into a segment for some other process to read.
+     *
+     * Large copies use streaming_copy() so data only the reader will touch
+     * doesn't evict the writer's working set. Small ones are plain memcpy.
+     *
+     * @param dst where to copy to, usually in a segment.
+     * @param src where to copy from.
+     * @param n the number of bytes.
+     * @returns dst.
+     */
+    inline void* copy_to_shared(void* dst, const void* src, size_t n) noexcept
+    {
+        if (n < streaming_copy_threshold)
+            return std::memcpy(dst, src, n);
+        return streaming_copy(dst, src, n);
+    }
+
+    /**
+     * @brief Copy out of a segment into private memory.
+     *
+     * This is plain memcpy: the caller is about to use the copy, so it
+     * should land in cache. Non-temporal loads only bypass the cache for
+     * write-combining memory, which segments never are.
+     *
+     * @param dst where to copy to.
+     * @param src where to copy from, usually in a segment.
+     * @param n the number of bytes.
+     * @returns dst.
+     */
+    inline void* copy_from_shared(void* dst, const void* src, size_t n) noexcept
+    {
+        return std::memcpy(dst, src, n);
+    }
+
+} // namespace pshm
+
+#endif // PSHM_SHARED_COPY__HPP
@@ -0,0 +1,124 @@
+#ifndef PSHM_SHARED_SEGMENT__HPP
+#define PSHM_SHARED_SEGMENT__HPP
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include <pshm/config.hpp>
+#include <pshm/shm_object_native.hpp>
+#include <pshm/stdcpp.hpp>
+
+#include <new>
+
+namespace pshm
+{
+    /**
+     * @brief An object built in place in shared memory, exactly once.
+     *
+     * Unlike shm_ptr, T may have constructors. The process that creates the
+     * segment constructs T in it while the segment_header says INITIALIZING,
+     * and everyone else waits for READY before mapping it. So no process ever
+     * sees a half built T, and T is never built twice.
+     *
+     * T is never destroyed: the segment outlives the processes using it.
+     *
+     * @tparam T the type to build. Must be standard layout and trivially
+     * destructible, and must not hold pointers, since the segment is mapped
+     * at a different address in every process.
+     *
+     * @see make_shared_segment().
+     */
+    template <class T>
+    class shared_segment
+    {
+      public:
+        static_assert(std::is_standard_layout<T>::value, "shared_segment types must be standard layout");
+        static_assert(std::is_trivially_destructible<T>::value, "shared_segment types are never destroyed");
+        static_assert(!std::is_pointer<T>::value, "pointers are meaningless in other processes");
+
+        using element_type = T;
+        using pointer = element_type*;
+        using flags_type = shm_object::flags_type;
+        using string_type = shm_object::string_type;
+
+        /**
+         * @brief Create or attach to a segment holding a T.
+         *
+         * @param name the shared memory object name.
+         *
+         * @param flags the file control flags. flags::HEADER is implied.
+         *
+         * @param args passed to T's constructor if this process creates the
+         * segment, ignored otherwise.
+         *
+         * @throws std::runtime_error if the segment can't be opened, holds a
+         * different type, or the creator didn't finish in time.
+         * @throws whatever T's constructor throws. The segment is removed.
+         */
+        template <class... Args>
+        shared_segment(const string_type& name, flags_type flags, Args&&... args)
+            : mCreated(false)
+        {
+            bool created = false;
+            shm_object::initializer_type init = [&](void* p) {
+                ::new (p) T(std::forward<Args>(args)...);
+                created = true;
+            };
+            mObject.reset(make_shm_object(name, flags | pshm::flags::HEADER, sizeof(T), 0, make_segment_layout<T>(), init));
+            mCreated = created;
+        }
+
+        /** @returns the shared T. */
+        pointer get() const noexcept
+        {
+            return static_cast<pointer>(mObject->get());
+        }
+
+        /** @returns the shared T. */
+        element_type& operator*() const noexcept
+        {
+            return *get();
+        }
+
+        /** @returns the shared T. */
+        pointer operator->() const noexcept
+        {
+            return get();
+        }
+
+        /** @returns true if this process constructed the T. */
+        bool created() const noexcept
+        {
+            return mCreated;
+        }
+
+        /** @returns the underlying shared memory object. */
+        shm_object& object() const noexcept
+        {
+            return *mObject;
+        }
+
+      private:
+        std::unique_ptr<shm_object> mObject;
+        bool mCreated;
+    };
+
+    /**
+     * @brief Create or attach to a segment holding a T.
+     *
+     * Equivalent to shared_segment<T>(name, flags::RDWR | flags::CREAT, args...).
+     *
+     *     auto config = pshm::make_shared_segment<config_block>("/config", 42, "default");
+     *
+     * @param name the shared memory object name.
+     * @param args passed to T's constructor by whichever process creates the
+     * segment.
+     */
+    template <class T, class... Args>
+    shared_segment<T> make_shared_segment(const shm_object::string_type& name, Args&&... args)
+    {
+        return shared_segment<T>(name, flags::RDWR | flags::CREAT, std::forward<Args>(args)...);
+    }
+
+} // namespace pshm
+
+#endif // PSHM_SHARED_SEGMENT__HPP
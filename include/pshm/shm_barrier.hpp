@@ -0,0 +1,281 @@
+#ifndef PSHM_SHM_BARRIER__HPP
+#define PSHM_SHM_BARRIER__HPP
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include <pshm/config.hpp>
+#include <pshm/shm_doorbell.hpp>
+#include <pshm/shm_object_native.hpp>
+#include <pshm/stdcpp.hpp>
+#include <pshm/wait_strategy.hpp>
+
+#include <vector>
+
+namespace pshm
+{
+    /**
+     * @brief Control block at the start of a barrier segment.
+     *
+     * All zero is phase 0 with nobody arrived.
+     */
+    struct barrier_control {
+        /** Participants that arrived in this phase. Reset by the last one. */
+        std::atomic<uint32_t> arrived;
+        uint8_t pad0[60];
+
+        /**
+         * Number of completed phases. This is the sense of a sense reversing
+         * barrier: waiters wait for it to move off the value they arrived
+         * with, so it never needs resetting.
+         */
+        std::atomic<uint32_t> phase;
+        uint8_t pad1[60];
+
+        /** Rung when a phase completes. */
+        doorbell_state doorbell;
+    };
+
+    static_assert(sizeof(barrier_control) == 192, "arrived, phase and doorbell should be on their own cache lines");
+
+    /**
+     * @brief Arrival counter of an inner node of a shm_tree_barrier.
+     */
+    struct barrier_node {
+        std::atomic<uint32_t> arrived;
+        uint8_t pad[60];
+    };
+
+    /**
+     * @brief What shm_barrier and shm_tree_barrier have in common: the phase
+     * and waiting for it to complete.
+     *
+     * Arriving is split from waiting. arrive() returns the phase it arrived
+     * in, and wait() blocks until that phase completes, so a participant can
+     * do unrelated work in between. A participant must wait for a phase
+     * before arriving at the next one.
+     */
+    class PSHM_EXPORT shm_barrier_base
+    {
+      public:
+        using flags_type = shm_object::flags_type;
+        using size_type = shm_object::size_type;
+        using string_type = shm_object::string_type;
+
+        /** @returns the number of completed phases. Wraps at 2^32. */
+        uint32_t phase() const noexcept;
+
+        /** @returns the number of participants per phase. */
+        size_type participants() const noexcept;
+
+        /**
+         * @param phase a value returned by arrive().
+         * @returns true if that phase has completed.
+         */
+        bool completed(uint32_t phase) const noexcept;
+
+        /**
+         * @brief Block until phase completes, spinning briefly then parking.
+         *
+         * @param phase a value returned by arrive().
+         */
+        void wait(uint32_t phase)
+        {
+            spin_park strategy;
+            wait(phase, strategy);
+        }
+
+        /**
+         * @brief Block until phase completes, waiting the way strategy does.
+         *
+         * @param phase a value returned by arrive().
+         * @param strategy e.g. busy_spin or spin_park, see wait_strategy.hpp.
+         * Its counters are updated.
+         */
+        template <class WaitStrategy>
+        void wait(uint32_t phase, WaitStrategy& strategy)
+        {
+            strategy.wait(mDoorbell, [this, phase] { return completed(phase); });
+        }
+
+        /**
+         * @brief Block until phase completes or timeout passes.
+         *
+         * Timing out doesn't take back the arrival.
+         *
+         * @param phase a value returned by arrive().
+         * @param strategy e.g. busy_spin or spin_park, see wait_strategy.hpp.
+         * @param timeout how long to wait.
+         * @returns completed(phase).
+         */
+        template <class WaitStrategy>
+        bool wait_for(uint32_t phase, WaitStrategy& strategy, std::chrono::nanoseconds timeout)
+        {
+            return strategy.wait_for(mDoorbell, [this, phase] { return completed(phase); }, timeout);
+        }
+
+      protected:
+        /**
+         * @param nodes inner nodes after the control block.
+         * @param fan_in mixed into the layout, 0 for a flat barrier.
+         */
+        shm_barrier_base(const string_type& name, flags_type flags, size_type participants, size_type nodes, size_type fan_in);
+
+        /**
+         * @brief Count an arrival at the root, completing the phase if it was
+         * the last one.
+         *
+         * @param expected arrivals per phase at the root.
+         */
+        void arrive_at_root(uint32_t expected);
+
+        std::unique_ptr<shm_object> mObject;
+        barrier_control* mControl;
+        barrier_node* mNodes;
+        shm_doorbell mDoorbell;
+        size_type mParticipants;
+    };
+
+    /**
+     * @brief Reusable barrier for a fixed number of processes.
+     *
+     * Every participant arrives at one counter. The last to arrive resets it
+     * and bumps the phase, then rings the doorbell with a single
+     * futex_wake_all(), so waking N sleepers costs one system call. Waiters
+     * that are still spinning never need one.
+     *
+     * With many participants the shared counter becomes the bottleneck, since
+     * every arrival pulls its cache line over. See shm_tree_barrier.
+     *
+     * The segment is opened with flags::HEADER so processes that disagree on
+     * the number of participants fail to attach.
+     */
+    class PSHM_EXPORT shm_barrier : public shm_barrier_base
+    {
+      public:
+        /**
+         * @brief Open a barrier.
+         *
+         * @param name the shared memory object name.
+         *
+         * @param flags the file control flags, e.g. flags::RDWR |
+         * flags::CREAT. Must include flags::RDWR. flags::HEADER is implied.
+         *
+         * @param participants arrivals that complete a phase. Every process
+         * must use the same value.
+         *
+         * @throws std::invalid_argument if participants is 0 or flags lacks
+         * flags::RDWR.
+         * @throws std::runtime_error if the segment can't be opened.
+         */
+        shm_barrier(const string_type& name, flags_type flags, size_type participants);
+
+        /**
+         * @brief Arrive without waiting.
+         *
+         * @returns the phase arrived at, for wait().
+         */
+        uint32_t arrive();
+
+        /**
+         * @brief Arrive and block until everyone else has.
+         */
+        void arrive_and_wait()
+        {
+            wait(arrive());
+        }
+
+        /**
+         * @brief Arrive and block until everyone else has, waiting the way
+         * strategy does.
+         */
+        template <class WaitStrategy>
+        void arrive_and_wait(WaitStrategy& strategy)
+        {
+            wait(arrive(), strategy);
+        }
+    };
+
+    /**
+     * @brief Reusable barrier that combines arrivals in a tree.
+     *
+     * Participants are split into groups of fan_in, each arriving at its own
+     * cache line. The last of a group carries the arrival up to the next
+     * level, and the last at the root completes the phase. Each counter only
+     * ever sees fan_in arrivals, so arriving costs O(log N) uncontended
+     * atomics rather than N contended ones. Completion is the same as
+     * shm_barrier: one phase word and one futex_wake_all().
+     *
+     * Each process passes its own participant id, which picks its leaf.
+     */
+    class PSHM_EXPORT shm_tree_barrier : public shm_barrier_base
+    {
+      public:
+        /**
+         * @brief Open a tree barrier.
+         *
+         * @param name the shared memory object name.
+         *
+         * @param flags the file control flags, e.g. flags::RDWR |
+         * flags::CREAT. Must include flags::RDWR. flags::HEADER is implied.
+         *
+         * @param participants arrivals that complete a phase. Every process
+         * must use the same value.
+         *
+         * @param id this participant, in [0, participants). Each must be used
+         * by exactly one process per phase.
+         *
+         * @param fan_in children per node. Every process must use the same
+         * value.
+         *
+         * @throws std::invalid_argument if an argument is out of range or
+         * flags lacks flags::RDWR.
+         * @throws std::runtime_error if the segment can't be opened.
+         */
+        shm_tree_barrier(const string_type& name, flags_type flags, size_type participants, size_type id, size_type fan_in = 4);
+
+        /**
+         * @brief Arrive without waiting.
+         *
+         * @returns the phase arrived at, for wait().
+         */
+        uint32_t arrive();
+
+        /**
+         * @brief Arrive and block until everyone else has.
+         */
+        void arrive_and_wait()
+        {
+            wait(arrive());
+        }
+
+        /**
+         * @brief Arrive and block until everyone else has, waiting the way
+         * strategy does.
+         */
+        template <class WaitStrategy>
+        void arrive_and_wait(WaitStrategy& strategy)
+        {
+            wait(arrive(), strategy);
+        }
+
+        /** @returns this participant's id. */
+        size_type id() const noexcept;
+
+        /** @returns the number of levels below the root. */
+        size_type depth() const noexcept;
+
+      private:
+        /** A node on the way from this participant's leaf to the root. */
+        struct step {
+            barrier_node* node;
+            uint32_t expected;
+        };
+
+        size_type mId;
+        std::vector<step> mPath;
+        uint32_t mRootExpected;
+    };
+
+} // namespace pshm
+
+#endif // PSHM_SHM_BARRIER__HPP
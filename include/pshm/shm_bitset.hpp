@@ -0,0 +1,149 @@
+#ifndef PSHM_SHM_BITSET__HPP
+#define PSHM_SHM_BITSET__HPP
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include <pshm/bit_ops.hpp>
+#include <pshm/config.hpp>
+#include <pshm/shm_object_native.hpp>
+#include <pshm/stdcpp.hpp>
+
+namespace pshm
+{
+    /**
+     * @brief Fixed size bitset in shared memory with atomic bit operations.
+     *
+     * Every process may set, clear and test bits at the same time. Each
+     * operation is a single atomic read-modify-write on the word holding the
+     * bit. Whole bitmaps built up privately can be merged in with merge_or()
+     * and merge_and(), which skip the chunks that wouldn't change.
+     *
+     * The words start on a cache line.
+     */
+    class PSHM_EXPORT shm_bitset
+    {
+      public:
+        using flags_type = shm_object::flags_type;
+        using size_type = shm_object::size_type;
+        using string_type = shm_object::string_type;
+        using word_type = uint64_t;
+
+        /** Bits per word. */
+        static constexpr size_type WORD_BITS = 64;
+
+        /** size() is rounded up to a multiple of this. */
+        static constexpr size_type BLOCK_BITS = 512;
+
+        /**
+         * @brief Open a bitset.
+         *
+         * @param name the shared memory object name.
+         *
+         * @param flags the file control flags, e.g. flags::RDWR |
+         * flags::CREAT. flags::HEADER is implied.
+         *
+         * @param bits the number of bits. Rounded up to a multiple of
+         * BLOCK_BITS. Every process must use the same value.
+         *
+         * @param layout_tag mixed into the layout hash, so structures built
+         * on a bitset can tell their segments from a plain bitset's.
+         *
+         * @throws std::runtime_error if the segment can't be opened or was
+         * created with a different layout.
+         */
+        shm_bitset(const string_type& name, flags_type flags, size_type bits, uint64_t layout_tag = 0);
+
+        /**
+         * @brief Set a bit.
+         *
+         * @param pos the bit.
+         * @returns true if this call changed it.
+         * @throws std::out_of_range if pos >= size().
+         */
+        bool set(size_type pos);
+
+        /**
+         * @brief Clear a bit.
+         *
+         * @param pos the bit.
+         * @returns true if this call changed it.
+         * @throws std::out_of_range if pos >= size().
+         */
+        bool reset(size_type pos);
+
+        /**
+         * @param pos the bit.
+         * @returns true if the bit is set.
+         * @throws std::out_of_range if pos >= size().
+         */
+        bool test(size_type pos) const;
+
+        /**
+         * @brief Clear every bit.
+         *
+         * Not atomic as a whole: bits set meanwhile may or may not survive.
+         */
+        void clear() noexcept;
+
+        /**
+         * @brief Count the set bits, see popcount_words().
+         *
+         * Not a snapshot if bits change meanwhile.
+         */
+        size_type count() const noexcept;
+
+        /**
+         * @brief OR a bitmap of the same size into this one.
+         *
+         * @param words word_count() words.
+         * @param n must be word_count().
+         * @returns the number of words that changed.
+         * @throws std::invalid_argument if n is wrong.
+         */
+        size_type merge_or(const word_type* words, size_type n);
+
+        /**
+         * @brief AND a bitmap of the same size into this one.
+         *
+         * @param words word_count() words.
+         * @param n must be word_count().
+         * @returns the number of words that changed.
+         * @throws std::invalid_argument if n is wrong.
+         */
+        size_type merge_and(const word_type* words, size_type n);
+
+        /**
+         * @brief Copy the words out.
+         *
+         * @param words receives word_count() words.
+         * @param n must be word_count().
+         * @throws std::invalid_argument if n is wrong.
+         */
+        void copy_to(word_type* words, size_type n) const;
+
+        /** @returns the number of bits. */
+        size_type size() const noexcept;
+
+        /** @returns the number of words. */
+        size_type word_count() const noexcept;
+
+        /** @returns the words, e.g. to hand to popcount_words(). */
+        const std::atomic<word_type>* words() const noexcept;
+
+        /**
+         * @brief Round a number of bits up as the constructor does.
+         */
+        static size_type round_bits(size_type bits) noexcept;
+
+      private:
+        std::unique_ptr<shm_object> mObject;
+        std::atomic<word_type>* mWords;
+        size_type mWordCount;
+
+        void check_position(size_type pos) const;
+        void check_words(size_type n) const;
+    };
+
+} // namespace pshm
+
+#endif // PSHM_SHM_BITSET__HPP
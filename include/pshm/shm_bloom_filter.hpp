@@ -0,0 +1,276 @@
+#ifndef PSHM_SHM_BLOOM_FILTER__HPP
+#define PSHM_SHM_BLOOM_FILTER__HPP
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include <pshm/config.hpp>
+#include <pshm/control_group.hpp>
+#include <pshm/shm_bitset.hpp>
+#include <pshm/stdcpp.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace pshm
+{
+    /**
+     * @brief Hashing shared by shm_bloom_filter and local_bloom_filter.
+     *
+     * Derives every probe from one 64-bit hash by double hashing, so the
+     * key is only hashed once however many probes there are.
+     */
+    struct bloom_hashing {
+        /**
+         * @brief Round a number of bits up to a usable filter size.
+         *
+         * @returns a power of two, at least shm_bitset::BLOCK_BITS.
+         */
+        static size_t round_bits(size_t bits) noexcept
+        {
+            size_t b = shm_bitset::BLOCK_BITS;
+            while (b < bits)
+                b <<= 1;
+            return b;
+        }
+
+        /**
+         * @brief Call fn with each bit position for a hash.
+         *
+         * @param h the key's mixed hash.
+         * @param hashes the number of probes.
+         * @param bits the filter size, a power of two.
+         * @param fn called as fn(size_t); returns false to stop.
+         * @returns false if fn stopped early.
+         */
+        template <class F>
+        static bool probe(uint64_t h, unsigned hashes, size_t bits, F fn)
+        {
+            const uint64_t h2 = ((h >> 32) | (h << 32)) | 1;
+            for (unsigned i = 0; i < hashes; ++i) {
+                if (!fn(static_cast<size_t>((h + i * h2) & (bits - 1))))
+                    return false;
+            }
+            return true;
+        }
+    };
+
+    /**
+     * @brief Process local Bloom filter to merge into a shm_bloom_filter.
+     *
+     * Fill this in without touching shared memory, then merge() it in one
+     * pass.
+     *
+     * @tparam K the key type.
+     * @tparam Hash hashes keys. Must give the same result in every process.
+     */
+    template <class K, class Hash = std::hash<K>>
+    class local_bloom_filter
+    {
+      public:
+        using key_type = K;
+        using hasher = Hash;
+        using size_type = size_t;
+        using word_type = shm_bitset::word_type;
+
+        /**
+         * @param bits the filter size. Rounded as by shm_bloom_filter.
+         * @param hashes probes per key.
+         */
+        local_bloom_filter(size_type bits, unsigned hashes = 7)
+            : mBits(bloom_hashing::round_bits(bits))
+            , mHashes(hashes)
+            , mWords(mBits / shm_bitset::WORD_BITS, 0)
+        {
+        }
+
+        /**
+         * @param key the key to add.
+         */
+        void insert(const K& key)
+        {
+            bloom_hashing::probe(mix_hash(static_cast<uint64_t>(mHasher(key))), mHashes, mBits, [this](size_t pos) {
+                mWords[pos / shm_bitset::WORD_BITS] |= word_type(1) << (pos % shm_bitset::WORD_BITS);
+                return true;
+            });
+        }
+
+        /**
+         * @param key the key to look for.
+         * @returns false if key was never inserted, true if it probably was.
+         */
+        bool contains(const K& key) const
+        {
+            return bloom_hashing::probe(mix_hash(static_cast<uint64_t>(mHasher(key))), mHashes, mBits, [this](size_t pos) {
+                return (mWords[pos / shm_bitset::WORD_BITS] >> (pos % shm_bitset::WORD_BITS)) & 1;
+            });
+        }
+
+        /** @brief Remove every key. */
+        void clear() noexcept
+        {
+            std::fill(mWords.begin(), mWords.end(), 0);
+        }
+
+        size_type bits() const noexcept
+        {
+            return mBits;
+        }
+
+        unsigned hashes() const noexcept
+        {
+            return mHashes;
+        }
+
+        const std::vector<word_type>& words() const noexcept
+        {
+            return mWords;
+        }
+
+      private:
+        size_type mBits;
+        unsigned mHashes;
+        std::vector<word_type> mWords;
+        Hash mHasher;
+    };
+
+    /**
+     * @brief Bloom filter in shared memory.
+     *
+     * Any process can insert and query keys concurrently: each probe is one
+     * atomic bit operation on a shm_bitset. A process adding keys in bulk
+     * can fill a local_bloom_filter privately and merge() it, which ORs the
+     * words in at memory bandwidth and leaves unchanged cache lines alone.
+     *
+     * Like any Bloom filter it has false positives and no false negatives,
+     * and keys can't be removed. It tells a process it has probably seen a
+     * key before, but can't pick a single winner among processes that insert
+     * the same key at once.
+     *
+     * @tparam K the key type.
+     * @tparam Hash hashes keys. Must give the same result in every process.
+     */
+    template <class K, class Hash = std::hash<K>>
+    class shm_bloom_filter
+    {
+      public:
+        using key_type = K;
+        using hasher = Hash;
+        using local_type = local_bloom_filter<K, Hash>;
+        using flags_type = shm_object::flags_type;
+        using size_type = shm_object::size_type;
+        using string_type = shm_object::string_type;
+
+        /**
+         * @brief Open a Bloom filter.
+         *
+         * @param name the shared memory object name.
+         *
+         * @param flags the file control flags, e.g. flags::RDWR |
+         * flags::CREAT. flags::HEADER is implied.
+         *
+         * @param bits the filter size. Rounded up to a power of two of at
+         * least shm_bitset::BLOCK_BITS. About 10 bits per key with 7 hashes
+         * gives a 1% false positive rate.
+         *
+         * @param hashes probes per key. Every process must use the same
+         * bits and hashes.
+         *
+         * @throws std::runtime_error if the segment can't be opened or was
+         * created with a different layout.
+         */
+        shm_bloom_filter(const string_type& name, flags_type flags, size_type bits, unsigned hashes = 7)
+            : mBits(name, flags, bloom_hashing::round_bits(bits), fnv1a_mix(0x626c6f6f6d, hashes))
+            , mHashes(hashes)
+        {
+        }
+
+        /**
+         * @brief Add a key.
+         *
+         * @param key the key to add.
+         * @returns true if this call set at least one of the key's bits.
+         * Only a hint under races: the probes are separate atomic
+         * operations, so two processes inserting the same key at once can
+         * each set some of its bits and both see true. Use
+         * shm_hash_map::insert() when exactly one of them must win.
+         */
+        bool insert(const K& key)
+        {
+            bool changed = false;
+            bloom_hashing::probe(hash(key), mHashes, mBits.size(), [this, &changed](size_t pos) {
+                changed |= mBits.set(pos);
+                return true;
+            });
+            return changed;
+        }
+
+        /**
+         * @param key the key to look for.
+         * @returns false if key was never inserted, true if it probably was.
+         */
+        bool contains(const K& key) const
+        {
+            return bloom_hashing::probe(hash(key), mHashes, mBits.size(), [this](size_t pos) {
+                return mBits.test(pos);
+            });
+        }
+
+        /**
+         * @brief Add every key of a local filter.
+         *
+         * @param local a filter with the same bits() and hashes().
+         * @returns the number of words that changed.
+         * @throws std::invalid_argument if the filters don't match.
+         */
+        size_type merge(const local_type& local)
+        {
+            if (local.bits() != bits() || local.hashes() != mHashes)
+                throw std::invalid_argument("local_bloom_filter doesn't match the shm_bloom_filter");
+            return mBits.merge_or(local.words().data(), local.words().size());
+        }
+
+        /**
+         * @brief Estimate how many distinct keys have been inserted.
+         *
+         * @returns -m/k ln(1 - X/m) for m bits, k hashes and X bits set.
+         */
+        double estimated_size() const noexcept
+        {
+            double m = static_cast<double>(bits());
+            double x = static_cast<double>(mBits.count());
+            if (x >= m)
+                return std::numeric_limits<double>::infinity();
+            return -m / mHashes * std::log(1.0 - x / m);
+        }
+
+        size_type bits() const noexcept
+        {
+            return mBits.size();
+        }
+
+        unsigned hashes() const noexcept
+        {
+            return mHashes;
+        }
+
+        /** @returns the bits, e.g. for count() or clear(). */
+        shm_bitset& bitset() noexcept
+        {
+            return mBits;
+        }
+
+      private:
+        shm_bitset mBits;
+        unsigned mHashes;
+        Hash mHasher;
+
+        uint64_t hash(const K& key) const
+        {
+            return mix_hash(static_cast<uint64_t>(mHasher(key)));
+        }
+    };
+
+} // namespace pshm
+
+#endif // PSHM_SHM_BLOOM_FILTER__HPP
@@ -0,0 +1,294 @@
+#ifndef PSHM_SHM_BROADCAST_RING__HPP
+#define PSHM_SHM_BROADCAST_RING__HPP
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include <pshm/config.hpp>
+#include <pshm/shm_doorbell.hpp>
+#include <pshm/shm_object_native.hpp>
+#include <pshm/stdcpp.hpp>
+#include <pshm/wait_strategy.hpp>
+
+namespace pshm
+{
+    /**
+     * @brief Control block at the start of a broadcast ring segment.
+     *
+     * Positions are absolute byte counts that only ever grow. The data area
+     * offset of a position is position & (capacity - 1).
+     */
+    struct broadcast_ring_control {
+        /** One past the last published record. Written by the writer. */
+        std::atomic<uint64_t> head;
+        /** Sequence number of the next record. Written by the writer. */
+        uint64_t next_sequence;
+        uint8_t pad0[48];
+
+        /** The oldest record that hasn't been overwritten. Written by the writer. */
+        std::atomic<uint64_t> tail;
+        uint8_t pad1[56];
+
+        /** Rung by the writer after each publish. Written by sleeping subscribers. */
+        doorbell_state doorbell;
+    };
+
+    static_assert(sizeof(broadcast_ring_control) == 192, "head, tail and doorbell should be on their own cache lines");
+
+    /**
+     * @brief Header in front of each record in the data area.
+     */
+    struct broadcast_record_header {
+        /** Set in flags when the rest of the lap is unused. */
+        static constexpr uint32_t PAD = 1;
+
+        uint32_t length;
+        uint32_t flags;
+        uint64_t sequence;
+    };
+
+    /**
+     * @brief Single writer side of a broadcast ring.
+     *
+     * A broadcast ring is a log of variable length records in one segment.
+     * Any number of shm_broadcast_subscriber can read it, each with its own
+     * cursor. The writer never waits on subscribers: when the log wraps, the
+     * oldest records are overwritten and subscribers that haven't read them
+     * yet find out with shm_broadcast_subscriber::status::overrun.
+     *
+     * The segment is opened with flags::HEADER so writers and subscribers that
+     * disagree on the capacity fail to attach.
+     */
+    class PSHM_EXPORT shm_broadcast_ring
+    {
+      public:
+        using flags_type = shm_object::flags_type;
+        using size_type = shm_object::size_type;
+        using string_type = shm_object::string_type;
+
+        /**
+         * @brief Open a broadcast ring for writing.
+         *
+         * @param name the shared memory object name.
+         *
+         * @param flags the file control flags, e.g. flags::RDWR |
+         * flags::CREAT. flags::HEADER is implied.
+         *
+         * @param capacity size of the data area in bytes. Must be a power of
+         * two and at least 64.
+         *
+         * @throws std::invalid_argument if capacity isn't valid.
+         * @throws std::runtime_error if the segment can't be opened.
+         */
+        shm_broadcast_ring(const string_type& name, flags_type flags, size_type capacity);
+
+        /**
+         * @brief Append a record.
+         *
+         * Copies length bytes from data into the ring and publishes it with a
+         * release store, then rings the doorbell. Never blocks, and only makes
+         * a system call if a subscriber is asleep in wait().
+         *
+         * @param data the record contents.
+         * @param length the record size, at most max_record_size().
+         * @returns the sequence number of the record.
+         * @throws std::invalid_argument if the record is too large.
+         */
+        uint64_t publish(const void* data, size_type length);
+
+        /** @returns the size of the data area in bytes. */
+        size_type capacity() const noexcept;
+
+        /**
+         * @returns the largest record that fits in the ring, and never more
+         * than UINT32_MAX bytes.
+         */
+        size_type max_record_size() const noexcept;
+
+        /**
+         * @brief The doorbell rung by publish().
+         *
+         * Use shm_doorbell::notify_eventfd() here to signal a subscriber's
+         * eventfd received with receive_fd().
+         */
+        shm_doorbell& doorbell() noexcept;
+
+      private:
+        std::unique_ptr<shm_object> mObject;
+        broadcast_ring_control* mControl;
+        shm_doorbell mDoorbell;
+        uint8_t* mData;
+        size_type mCapacity;
+        uint64_t mHead;
+        uint64_t mTail;
+        uint64_t mSequence;
+    };
+
+    /**
+     * @brief One reader of a broadcast ring.
+     *
+     * Records are returned as pointers straight into the segment. Since the
+     * writer doesn't wait on anyone, check valid() after using a record and
+     * discard whatever was computed from it if that returns false.
+     */
+    class PSHM_EXPORT shm_broadcast_subscriber
+    {
+      public:
+        using flags_type = shm_object::flags_type;
+        using size_type = shm_object::size_type;
+        using string_type = shm_object::string_type;
+
+        /**
+         * @brief A record in the ring.
+         */
+        struct record {
+            /** Points into the segment. */
+            const void* data;
+            size_type length;
+            uint64_t sequence;
+            /** Where the record starts in the ring. */
+            uint64_t position;
+        };
+
+        /**
+         * @brief Result of next().
+         */
+        enum class status {
+            /** A record was returned. */
+            ok,
+            /** Nothing new has been published. */
+            empty,
+            /** The writer overwrote unread records. The cursor moved to the oldest remaining record. */
+            overrun,
+        };
+
+        /**
+         * @brief Open a broadcast ring for reading.
+         *
+         * The cursor starts at the newest end of the ring, so only records
+         * published from now on are seen. Use seek_oldest() for the backlog.
+         *
+         * @param name the shared memory object name.
+         *
+         * @param flags the file control flags, usually flags::RDONLY.
+         * flags::HEADER is implied.
+         *
+         * @param capacity must match the writer's capacity.
+         *
+         * @throws std::invalid_argument if capacity isn't valid.
+         * @throws std::runtime_error if the segment can't be opened or the
+         * capacity doesn't match.
+         */
+        shm_broadcast_subscriber(const string_type& name, flags_type flags, size_type capacity);
+
+        /**
+         * @brief Read the record at the cursor and advance past it.
+         *
+         * @param rec set to the record when status::ok is returned.
+         * @returns whether a record was read.
+         */
+        status next(record& rec);
+
+        /**
+         * @brief Check that a record hasn't been overwritten.
+         *
+         * @param rec a record returned by next().
+         * @returns true if everything read from rec so far is intact.
+         */
+        bool valid(const record& rec) const noexcept;
+
+        /**
+         * @brief Move the cursor to the oldest record still in the ring.
+         */
+        void seek_oldest() noexcept;
+
+        /**
+         * @brief Move the cursor past the newest record.
+         */
+        void seek_newest() noexcept;
+
+        /** @returns the number of records skipped because of overruns. */
+        uint64_t dropped() const noexcept;
+
+        /** @returns true if next() would not return status::empty. */
+        bool pending() const noexcept;
+
+        /**
+         * @brief Block until pending().
+         *
+         * Sleeping marks the subscriber in the segment, so it must have been
+         * opened with flags::RDWR.
+         *
+         * @throws std::runtime_error if opened read only.
+         */
+        void wait();
+
+        /**
+         * @brief Block until pending() or timeout passes.
+         *
+         * @param timeout how long to wait.
+         * @returns pending().
+         * @throws std::runtime_error if opened read only.
+         */
+        bool wait_for(std::chrono::nanoseconds timeout);
+
+        /**
+         * @brief Block until pending(), waiting the way strategy does.
+         *
+         * @param strategy e.g. busy_spin or spin_park, see wait_strategy.hpp.
+         * Its counters are updated.
+         *
+         * @throws std::runtime_error if strategy parks and the subscriber
+         * was opened read only.
+         */
+        template <class WaitStrategy>
+        void wait(WaitStrategy& strategy)
+        {
+            strategy.wait(doorbell_for(WaitStrategy::parks), [this] { return pending(); });
+        }
+
+        /**
+         * @brief Block until pending() or timeout passes, waiting the way
+         * strategy does.
+         *
+         * @param strategy e.g. busy_spin or spin_park, see wait_strategy.hpp.
+         * @param timeout how long to wait.
+         * @returns pending().
+         * @throws std::runtime_error if strategy parks and the subscriber
+         * was opened read only.
+         */
+        template <class WaitStrategy>
+        bool wait_for(WaitStrategy& strategy, std::chrono::nanoseconds timeout)
+        {
+            return strategy.wait_for(doorbell_for(WaitStrategy::parks), [this] { return pending(); }, timeout);
+        }
+
+        /**
+         * @brief The ring's doorbell, for waiting with an eventfd.
+         *
+         * Register an eventfd with shm_doorbell::use_eventfd() and bracket
+         * epoll_wait() with shm_doorbell::prepare_sleep() and
+         * shm_doorbell::finish_sleep(), checking pending() in between.
+         *
+         * @throws std::runtime_error if opened read only.
+         */
+        shm_doorbell& doorbell();
+
+      private:
+        std::unique_ptr<shm_object> mObject;
+        const broadcast_ring_control* mControl;
+        shm_doorbell mDoorbell;
+        bool mWritable;
+
+        /** Strategies that don't park never write to the doorbell. */
+        shm_doorbell& doorbell_for(bool parks);
+        const uint8_t* mData;
+        size_type mCapacity;
+        uint64_t mCursor;
+        uint64_t mExpected;
+        bool mSynced;
+        uint64_t mDropped;
+    };
+
+} // namespace pshm
+
+#endif // PSHM_SHM_BROADCAST_RING__HPP
@@ -0,0 +1,410 @@
+#ifndef PSHM_SHM_CACHE__HPP
+#define PSHM_SHM_CACHE__HPP
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include <pshm/config.hpp>
+#include <pshm/control_group.hpp>
+#include <pshm/cpu_relax.hpp>
+#include <pshm/shm_object_native.hpp>
+#include <pshm/stdcpp.hpp>
+
+#include <cstring>
+
+namespace pshm
+{
+    /**
+     * @brief Per set state of a shm_cache, one cache line each.
+     *
+     * Lookups only read this line, so it stays shared between readers.
+     */
+    struct cache_set {
+        /** Serializes writers of this set. Readers never take it. */
+        std::atomic<uint32_t> lock;
+        /** The CLOCK hand, only moved under lock. */
+        uint32_t hand;
+        uint8_t pad[40];
+        /** One control byte per way, see control_group. */
+        std::atomic<uint8_t> ctrl[control_group::WIDTH];
+    };
+
+    static_assert(sizeof(cache_set) == 64, "cache_set should fill one cache line");
+
+    /**
+     * @brief Per set counters of a shm_cache, one cache line each.
+     *
+     * Kept apart from the cache_set lines so counting a hit doesn't take the
+     * control bytes away from other readers.
+     */
+    struct cache_set_counters {
+        std::atomic<uint64_t> hits;
+        std::atomic<uint64_t> misses;
+        std::atomic<uint64_t> inserts;
+        std::atomic<uint64_t> evictions;
+        uint8_t pad[32];
+    };
+
+    static_assert(sizeof(cache_set_counters) == 64, "cache_set_counters should fill one cache line");
+
+    /**
+     * @brief A way in a shm_cache set.
+     *
+     * Unlike shm_hash_map the key changes on eviction, so both key and value
+     * are read under the version sequence lock.
+     */
+    template <class K, class V>
+    struct cache_slot {
+        std::atomic<uint32_t> version;
+        /** CLOCK reference bit, set by readers on a hit. */
+        std::atomic<uint8_t> referenced;
+        K key;
+        V value;
+    };
+
+    /**
+     * @brief Counters of a shm_cache, summed over all sets.
+     */
+    struct cache_stats {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t inserts;
+        uint64_t evictions;
+    };
+
+    /**
+     * @brief Fixed size cache in shared memory with CLOCK eviction.
+     *
+     * Keys are hashed to a set of control_group::WIDTH ways. Lookups are
+     * lock-free: they match tags in the set's control bytes and read the slot
+     * under its sequence lock, then set the slot's reference bit. Writers take
+     * a spin lock on the set they change, so there's no global lock and
+     * writers to different sets never contend. When a set is full the CLOCK
+     * hand sweeps its ways, clearing reference bits, and evicts the first way
+     * that hasn't been used since the last sweep.
+     *
+     * Hit, miss, insert and eviction counters live in the segment and can be
+     * read by every process with stats().
+     *
+     * A process that dies while holding a set's lock leaves that set locked.
+     * The critical sections are a handful of stores, so this takes a crash
+     * at exactly the wrong instant.
+     *
+     * @tparam K the key type. Must be trivially copyable.
+     * @tparam V the value type. Must be trivially copyable.
+     * @tparam Hash hashes keys. Must give the same result in every process.
+     * @tparam KeyEqual compares keys.
+     */
+    template <class K, class V, class Hash = std::hash<K>, class KeyEqual = std::equal_to<K>>
+    class shm_cache
+    {
+      public:
+        static_assert(std::is_trivially_copyable<K>::value, "shm_cache keys must be trivially copyable");
+        static_assert(std::is_trivially_copyable<V>::value, "shm_cache values must be trivially copyable");
+
+        using key_type = K;
+        using mapped_type = V;
+        using hasher = Hash;
+        using key_equal = KeyEqual;
+        using slot_type = cache_slot<K, V>;
+        using flags_type = shm_object::flags_type;
+        using size_type = shm_object::size_type;
+        using string_type = shm_object::string_type;
+
+        /** Number of ways in each set. */
+        static constexpr size_type WAYS = control_group::WIDTH;
+
+        /**
+         * @brief Open a cache.
+         *
+         * @param name the shared memory object name.
+         *
+         * @param flags the file control flags, e.g. flags::RDWR |
+         * flags::CREAT. flags::HEADER is implied.
+         *
+         * @param capacity the number of entries. Rounded up so the number of
+         * sets is a power of two. Every process must use the same value.
+         *
+         * @throws std::runtime_error if the segment can't be opened or was
+         * created with a different layout.
+         */
+        shm_cache(const string_type& name, flags_type flags, size_type capacity)
+            : mSetCount(round_sets(capacity))
+        {
+            segment_layout layout = make_layout(mSetCount);
+            mObject.reset(make_shm_object(name, flags | pshm::flags::HEADER, layout.size, 0, layout));
+
+            uint8_t* base = static_cast<uint8_t*>(mObject->get());
+            mSets = reinterpret_cast<cache_set*>(base);
+            mCounters = reinterpret_cast<cache_set_counters*>(base + counters_offset(mSetCount));
+            mSlots = reinterpret_cast<slot_type*>(base + slots_offset(mSetCount));
+        }
+
+        /**
+         * @brief Look up a key.
+         *
+         * Counts a hit or a miss and marks the entry as recently used.
+         *
+         * @param key the key to find.
+         * @param value set to a consistent copy of the value on a hit.
+         * @returns true on a hit.
+         */
+        bool get(const K& key, V& value)
+        {
+            uint64_t h = hash(key);
+            cache_set& set = set_for(h);
+            slot_type* ways = ways_for(h);
+            const uint8_t t = control_group::tag(h);
+
+            control_group group(set.ctrl);
+            for (uint32_t m = group.match(t); m != 0; m &= m - 1) {
+                size_type way = control_group::lowest(m);
+                slot_type& s = ways[way];
+                if (!read_if_equal(s, key, value))
+                    continue;
+                /* Erasing leaves the key in the slot, so check it's still in use. */
+                if (set.ctrl[way].load(std::memory_order_relaxed) != t)
+                    continue;
+                /* Only write the reference bit when it changes to keep the line shared. */
+                if (s.referenced.load(std::memory_order_relaxed) == 0)
+                    s.referenced.store(1, std::memory_order_relaxed);
+                counters_for(h).hits.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+            counters_for(h).misses.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        /**
+         * @brief Insert or replace an entry, evicting one if the set is full.
+         *
+         * @param key the key to store.
+         * @param value the value to store.
+         * @returns true if a new entry was inserted, false if replaced.
+         */
+        bool put(const K& key, const V& value)
+        {
+            uint64_t h = hash(key);
+            cache_set& set = set_for(h);
+            slot_type* ways = ways_for(h);
+            const uint8_t t = control_group::tag(h);
+
+            lock(set);
+            size_type way = find_locked(set, ways, t, key);
+            bool inserted = (way == WAYS);
+            if (inserted) {
+                way = victim_locked(set, counters_for(h), ways);
+                counters_for(h).inserts.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            slot_type& s = ways[way];
+            begin_write(s);
+            std::memcpy(&s.key, &key, sizeof(K));
+            std::memcpy(&s.value, &value, sizeof(V));
+            s.referenced.store(inserted ? 0 : 1, std::memory_order_relaxed);
+            set.ctrl[way].store(t, std::memory_order_relaxed);
+            end_write(s);
+            unlock(set);
+
+            return inserted;
+        }
+
+        /**
+         * @brief Remove an entry.
+         *
+         * @param key the key to remove.
+         * @returns true if the key was present.
+         */
+        bool erase(const K& key)
+        {
+            uint64_t h = hash(key);
+            cache_set& set = set_for(h);
+            slot_type* ways = ways_for(h);
+
+            lock(set);
+            size_type way = find_locked(set, ways, control_group::tag(h), key);
+            if (way != WAYS) {
+                begin_write(ways[way]);
+                set.ctrl[way].store(control_group::EMPTY, std::memory_order_relaxed);
+                end_write(ways[way]);
+            }
+            unlock(set);
+
+            return way != WAYS;
+        }
+
+        /**
+         * @brief Read the counters.
+         *
+         * @returns the counters summed over every set.
+         */
+        cache_stats stats() const noexcept
+        {
+            cache_stats st{0, 0, 0, 0};
+            for (size_type i = 0; i < mSetCount; ++i) {
+                st.hits += mCounters[i].hits.load(std::memory_order_relaxed);
+                st.misses += mCounters[i].misses.load(std::memory_order_relaxed);
+                st.inserts += mCounters[i].inserts.load(std::memory_order_relaxed);
+                st.evictions += mCounters[i].evictions.load(std::memory_order_relaxed);
+            }
+            return st;
+        }
+
+        /** @returns the maximum number of entries. */
+        size_type capacity() const noexcept
+        {
+            return mSetCount * WAYS;
+        }
+
+      private:
+        std::unique_ptr<shm_object> mObject;
+        cache_set* mSets;
+        cache_set_counters* mCounters;
+        slot_type* mSlots;
+        size_type mSetCount;
+        Hash mHasher;
+        KeyEqual mEqual;
+
+        static size_type round_sets(size_type capacity) noexcept
+        {
+            size_type n = 1;
+            while (n * WAYS < capacity)
+                n <<= 1;
+            return n;
+        }
+
+        static constexpr size_type counters_offset(size_type sets) noexcept
+        {
+            return sets * sizeof(cache_set);
+        }
+
+        static constexpr size_type slots_offset(size_type sets) noexcept
+        {
+            return counters_offset(sets) + sets * sizeof(cache_set_counters);
+        }
+
+        static segment_layout make_layout(size_type sets) noexcept
+        {
+            uint64_t h = layout_hash<slot_type>();
+            h = fnv1a_mix(h, layout_hash<cache_set>());
+            h = fnv1a_mix(h, layout_hash<cache_set_counters>());
+            h = fnv1a_mix(h, layout_hash<K>());
+            h = fnv1a_mix(h, layout_hash<V>());
+            h = fnv1a_mix(h, sets);
+            return segment_layout{slots_offset(sets) + sets * WAYS * sizeof(slot_type), 64, h};
+        }
+
+        uint64_t hash(const K& key) const
+        {
+            return mix_hash(static_cast<uint64_t>(mHasher(key)));
+        }
+
+        cache_set& set_for(uint64_t h) const noexcept
+        {
+            return mSets[(h >> 7) & (mSetCount - 1)];
+        }
+
+        cache_set_counters& counters_for(uint64_t h) const noexcept
+        {
+            return mCounters[(h >> 7) & (mSetCount - 1)];
+        }
+
+        slot_type* ways_for(uint64_t h) const noexcept
+        {
+            return mSlots + ((h >> 7) & (mSetCount - 1)) * WAYS;
+        }
+
+        static void lock(cache_set& set) noexcept
+        {
+            uint32_t expected = 0;
+            while (!set.lock.compare_exchange_weak(expected, 1, std::memory_order_acquire)) {
+                expected = 0;
+                cpu_relax();
+            }
+        }
+
+        static void unlock(cache_set& set) noexcept
+        {
+            set.lock.store(0, std::memory_order_release);
+        }
+
+        static void begin_write(slot_type& s) noexcept
+        {
+            s.version.store(s.version.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            /* Readers must see the odd version before any of the new bytes. */
+            std::atomic_thread_fence(std::memory_order_release);
+        }
+
+        static void end_write(slot_type& s) noexcept
+        {
+            s.version.store(s.version.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        /**
+         * @brief Copy out value if s holds key, under the sequence lock.
+         */
+        bool read_if_equal(const slot_type& s, const K& key, V& value) const
+        {
+            for (;;) {
+                uint32_t v1 = s.version.load(std::memory_order_acquire);
+                if (v1 & 1) {
+                    cpu_relax();
+                    continue;
+                }
+                K k;
+                V v;
+                std::memcpy(&k, &s.key, sizeof(K));
+                std::memcpy(&v, &s.value, sizeof(V));
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (s.version.load(std::memory_order_relaxed) != v1)
+                    continue;
+                if (!mEqual(k, key))
+                    return false;
+                value = v;
+                return true;
+            }
+        }
+
+        /**
+         * @returns the way holding key, or WAYS. Requires the set lock.
+         */
+        size_type find_locked(cache_set& set, slot_type* ways, uint8_t t, const K& key) const
+        {
+            control_group group(set.ctrl);
+            for (uint32_t m = group.match(t); m != 0; m &= m - 1) {
+                size_type way = control_group::lowest(m);
+                if (mEqual(ways[way].key, key))
+                    return way;
+            }
+            return WAYS;
+        }
+
+        /**
+         * @returns an empty way or the CLOCK victim. Requires the set lock.
+         */
+        static size_type victim_locked(cache_set& set, cache_set_counters& counters, slot_type* ways) noexcept
+        {
+            control_group group(set.ctrl);
+            uint32_t empty = group.match(control_group::EMPTY);
+            if (empty != 0)
+                return control_group::lowest(empty);
+
+            /* At most two sweeps: the first clears every reference bit. */
+            for (;;) {
+                size_type way = set.hand;
+                set.hand = (set.hand + 1) % WAYS;
+                if (ways[way].referenced.load(std::memory_order_relaxed) != 0) {
+                    ways[way].referenced.store(0, std::memory_order_relaxed);
+                    continue;
+                }
+                counters.evictions.fetch_add(1, std::memory_order_relaxed);
+                return way;
+            }
+        }
+    };
+
+    template <class K, class V, class Hash, class KeyEqual>
+    constexpr typename shm_cache<K, V, Hash, KeyEqual>::size_type shm_cache<K, V, Hash, KeyEqual>::WAYS;
+
+} // namespace pshm
+
+#endif // PSHM_SHM_CACHE__HPP
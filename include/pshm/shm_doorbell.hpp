@@ -0,0 +1,226 @@
+#ifndef PSHM_SHM_DOORBELL__HPP
+#define PSHM_SHM_DOORBELL__HPP
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include <pshm/config.hpp>
+#include <pshm/futex.hpp>
+#include <pshm/pshm_export.hpp>
+#include <pshm/stdcpp.hpp>
+
+#include <chrono>
+
+namespace pshm
+{
+    /**
+     * @brief Shared state of a doorbell, embedded in a channel's control block.
+     *
+     * All zero is a valid doorbell with nobody asleep and no eventfd.
+     */
+    struct doorbell_state {
+        /** Number of consumers that can register an eventfd. */
+        static constexpr size_t EVENTFDS = 7;
+
+        /** Futex word, bumped by each ring that finds a sleeper. */
+        std::atomic<uint32_t> sequence;
+        /** Number of consumers between prepare_sleep() and finish_sleep(). */
+        std::atomic<uint32_t> sleepers;
+        /** Consumers' eventfds as pid << 32 | fd, or 0 for a free slot. */
+        std::atomic<uint64_t> eventfds[EVENTFDS];
+    };
+
+    static_assert(sizeof(doorbell_state) == 64, "doorbell_state should fill one cache line");
+
+    /**
+     * @brief Process local handle on a doorbell_state.
+     *
+     * A doorbell is how a producer tells a consumer that a channel has
+     * something new. Consumers announce that they're about to sleep and
+     * producers only make a system call when somebody has, so a busy channel
+     * costs a fence and a load per ring.
+     *
+     * Consumers either block on the futex with wait(), or register an eventfd
+     * so they can epoll_wait() on many channels and sockets at once:
+     *
+     *     for (auto& bell : bells) {
+     *         bell.use_eventfd(efd);      // same efd for all, cheap when still registered
+     *         bell.prepare_sleep();
+     *     }
+     *     if (!anything_pending())
+     *         epoll_wait(...);
+     *     for (auto& bell : bells)
+     *         bell.finish_sleep();
+     *     drain_eventfd(efd);
+     *
+     * Producers find the consumer's eventfd through the registration with
+     * duplicate_fd(), which needs ptrace access to the consumer: under Yama
+     * ptrace_scope 1, the default on e.g. Ubuntu, only its ancestors have
+     * that. Other producers still wake futex sleepers but can't signal the
+     * eventfd, so hand it to them with send_fd() and notify_eventfd().
+     *
+     * Each consumer process registers its own eventfd, up to
+     * doorbell_state::EVENTFDS of them, and every ring signals them all.
+     * Registering again before each sleep puts back a registration that a
+     * producer dropped, e.g. because it looked stale.
+     */
+    class PSHM_EXPORT shm_doorbell
+    {
+      public:
+        /**
+         * @brief Attach to a doorbell.
+         *
+         * @param state the shared state, or nullptr for a doorbell that does
+         * nothing.
+         */
+        explicit shm_doorbell(doorbell_state* state = nullptr) noexcept;
+
+        /**
+         * @brief Closes any eventfd this handle opened. Registrations in the
+         * shared state are removed if this handle made them.
+         */
+        ~shm_doorbell();
+
+        shm_doorbell(const shm_doorbell&) = delete;
+        shm_doorbell& operator=(const shm_doorbell&) = delete;
+        shm_doorbell(shm_doorbell&& other) noexcept;
+        shm_doorbell& operator=(shm_doorbell&& other) noexcept;
+
+        /**
+         * @brief Wake the sleeping consumers, if there are any.
+         *
+         * Call after publishing whatever the consumer waits for. Without
+         * sleepers this is a fence and a load.
+         *
+         * A registered eventfd whose consumer died or closed it is
+         * unregistered. One this process isn't permitted to duplicate stays
+         * registered but isn't signalled, and isn't tried again until the
+         * registration changes. Sleepers are still woken through the futex.
+         */
+        void ring() noexcept;
+
+        /**
+         * @brief Block until ready() returns true.
+         *
+         * @param ready predicate checking the channel, e.g. that a ring is
+         * not empty. Called again after each wake up.
+         */
+        template <class Ready>
+        void wait(Ready ready)
+        {
+            while (!ready()) {
+                uint32_t seen = mState->sequence.load(std::memory_order_acquire);
+                prepare_sleep();
+                if (!ready())
+                    futex_wait(mState->sequence, seen);
+                finish_sleep();
+            }
+        }
+
+        /**
+         * @brief Block until ready() returns true or timeout passes.
+         *
+         * @param ready predicate checking the channel.
+         * @param timeout how long to wait.
+         * @returns the last result of ready().
+         */
+        template <class Ready>
+        bool wait_for(Ready ready, std::chrono::nanoseconds timeout)
+        {
+            auto deadline = std::chrono::steady_clock::now() + timeout;
+            while (!ready()) {
+                auto left = deadline - std::chrono::steady_clock::now();
+                if (left <= std::chrono::nanoseconds::zero())
+                    return ready();
+                uint32_t seen = mState->sequence.load(std::memory_order_acquire);
+                prepare_sleep();
+                if (!ready())
+                    futex_wait_for(mState->sequence, seen, left);
+                finish_sleep();
+            }
+            return true;
+        }
+
+        /**
+         * @brief Announce that this consumer is about to sleep.
+         *
+         * Check the channel again afterwards and only sleep if it's still
+         * empty: anything published after this call rings.
+         */
+        void prepare_sleep() noexcept;
+
+        /**
+         * @brief Undo prepare_sleep() after waking up.
+         */
+        void finish_sleep() noexcept;
+
+        /**
+         * @brief Create an eventfd and register it for this doorbell.
+         *
+         * @returns the eventfd, non-blocking. Owned by this handle.
+         * @throws std::runtime_error if eventfd() fails or isn't supported.
+         */
+        int make_eventfd();
+
+        /**
+         * @brief Register an existing eventfd for this doorbell.
+         *
+         * A consumer that serves many channels registers the same eventfd in
+         * each of them. Registering it again only loads the slots, unless a
+         * producer dropped it. A different fd replaces this handle's
+         * previous registration. When every slot is taken, slots of
+         * processes that no longer exist are reclaimed.
+         *
+         * @param fd an eventfd owned by the caller, or -1 to unregister.
+         * @returns false if every slot is taken by a live process, in which
+         * case only futex waiters are woken. Sleep with a timeout.
+         */
+        bool use_eventfd(int fd) noexcept;
+
+        /**
+         * @brief Producer side: also signal fd on each ring.
+         *
+         * For a descriptor received with receive_fd(), when duplicate_fd()
+         * isn't permitted.
+         *
+         * @param fd the consumer's eventfd, owned by the caller, or -1 to
+         * stop.
+         */
+        void notify_eventfd(int fd) noexcept;
+
+        /** @returns the shared state. */
+        doorbell_state* state() const noexcept;
+
+      private:
+        doorbell_state* mState;
+        /** eventfd registered by this handle, if any. */
+        uint64_t mRegistered;
+        /** eventfd created by make_eventfd(). */
+        int mOwnedFd;
+        /** eventfd given to notify_eventfd(). */
+        int mNotifyFd;
+
+        /** Producer's copy of the eventfd registered in one slot. */
+        struct cached_eventfd {
+            /** Registration that fd was obtained for. */
+            uint64_t registration;
+            /** The copy, or -1 if it couldn't be had. */
+            int fd;
+            bool owned;
+        };
+
+        cached_eventfd mCached[doorbell_state::EVENTFDS];
+
+        int registered_fd(size_t slot, uint64_t registration) noexcept;
+        void release() noexcept;
+    };
+
+    /**
+     * @brief Reset an eventfd after waking up.
+     *
+     * @param fd a non-blocking eventfd.
+     */
+    PSHM_EXPORT void drain_eventfd(int fd) noexcept;
+
+} // namespace pshm
+
+#endif // PSHM_SHM_DOORBELL__HPP
@@ -0,0 +1,216 @@
+#ifndef PSHM_SHM_EPOCH_DOMAIN__HPP
+#define PSHM_SHM_EPOCH_DOMAIN__HPP
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include <pshm/config.hpp>
+#include <pshm/shm_object_native.hpp>
+#include <pshm/stdcpp.hpp>
+
+#include <functional>
+
+namespace pshm
+{
+    /**
+     * @brief Control block at the start of an epoch domain segment.
+     */
+    struct epoch_domain_control {
+        /** The global epoch. Only ever grows. */
+        std::atomic<uint64_t> epoch;
+        uint8_t pad[56];
+    };
+
+    /**
+     * @brief A participant's registration in an epoch domain.
+     *
+     * All zero is a free slot with an empty retire list.
+     */
+    struct epoch_slot {
+        /** pid of the owning process, or 0 if free. */
+        std::atomic<uint64_t> owner;
+        /** Announced epoch << 1 | 1 while in a critical section, 0 outside. */
+        std::atomic<uint64_t> epoch;
+        /** Oldest entry of the retire list. Only touched by the owner. */
+        uint32_t head;
+        /** One past the newest entry of the retire list. Only touched by the owner. */
+        uint32_t tail;
+        uint8_t pad[40];
+    };
+
+    static_assert(sizeof(epoch_slot) == 64, "epoch_slot should fill one cache line");
+
+    /**
+     * @brief Something retired but not yet reclaimed.
+     */
+    struct retired_entry {
+        /** What to hand to the reclaim function, e.g. an arena offset. */
+        uint64_t offset;
+        /** Global epoch when it was retired. */
+        uint64_t epoch;
+    };
+
+    /**
+     * @brief Epoch based memory reclamation across processes.
+     *
+     * Lock-free structures in shared memory can't free a node the moment
+     * it's unlinked, since another process may still be reading it. Readers
+     * bracket each access with enter() and leave(), which announce the global
+     * epoch in their slot. Writers retire() unlinked nodes instead of freeing
+     * them. The global epoch only advances once every participant inside a
+     * critical section has seen the current one, and a node retired in epoch
+     * e is reclaimed once the global epoch reaches e + 2, when nobody can
+     * hold a reference to it any more.
+     *
+     * Nodes are named by a 64 bit value, usually their offset in a shared
+     * arena, and reclaimed by calling the reclaim function with it. Retire
+     * lists live in the segment, so a participant that exits with nodes
+     * still pending hands them to the next owner of its slot, and every
+     * process must use a reclaim function that frees to the same place.
+     *
+     * Each handle is one participant and must only be used by one thread at
+     * a time. A process that dies inside a critical section would stop the
+     * epoch forever. Instead, participants that hold the epoch back are
+     * checked with kill(pid, 0), and the slots of dead ones are adopted: their
+     * announcement is cleared and their retire lists are reclaimed by the
+     * adopter. A dead child counts as alive until it has been reaped, and a
+     * reused pid hides a death until the new process exits.
+     */
+    class PSHM_EXPORT shm_epoch_domain
+    {
+      public:
+        using flags_type = shm_object::flags_type;
+        using size_type = shm_object::size_type;
+        using string_type = shm_object::string_type;
+        using reclaim_function = std::function<void(uint64_t)>;
+
+        /**
+         * @brief RAII critical section: enter() on construction, leave() on
+         * destruction.
+         */
+        class guard
+        {
+          public:
+            explicit guard(shm_epoch_domain& domain) noexcept
+                : mDomain(domain)
+            {
+                mDomain.enter();
+            }
+
+            ~guard()
+            {
+                mDomain.leave();
+            }
+
+            guard(const guard&) = delete;
+            guard& operator=(const guard&) = delete;
+
+          private:
+            shm_epoch_domain& mDomain;
+        };
+
+        /**
+         * @brief Join an epoch domain.
+         *
+         * @param name the shared memory object name.
+         *
+         * @param flags the file control flags, e.g. flags::RDWR |
+         * flags::CREAT. Must include flags::RDWR. flags::HEADER is implied.
+         *
+         * @param participants the number of slots. Every process must use
+         * the same value.
+         *
+         * @param retire_capacity entries per retire list, rounded up to a
+         * power of two. Every process must use the same value.
+         *
+         * @param reclaim called with each retired value once it's safe. Must
+         * not throw.
+         *
+         * @throws std::invalid_argument if flags lacks flags::RDWR or a size
+         * is 0.
+         * @throws std::runtime_error if the segment can't be opened or every
+         * slot is taken by a live process.
+         */
+        shm_epoch_domain(const string_type& name, flags_type flags, size_type participants, size_type retire_capacity, reclaim_function reclaim);
+
+        /**
+         * @brief Reclaim what's safe and give up the slot.
+         *
+         * Anything still pending stays in the slot for its next owner.
+         */
+        ~shm_epoch_domain();
+
+        shm_epoch_domain(const shm_epoch_domain&) = delete;
+        shm_epoch_domain& operator=(const shm_epoch_domain&) = delete;
+
+        /**
+         * @brief Begin a critical section. Nests.
+         */
+        void enter() noexcept;
+
+        /**
+         * @brief End a critical section.
+         */
+        void leave() noexcept;
+
+        /** @returns true between enter() and the matching leave(). */
+        bool active() const noexcept;
+
+        /**
+         * @brief Hand over an unlinked node for reclaiming later.
+         *
+         * Reclaims first if the retire list is full.
+         *
+         * @param offset passed to the reclaim function once it's safe.
+         * @throws std::length_error if the list is still full, because a
+         * live participant is holding the epoch back.
+         */
+        void retire(uint64_t offset);
+
+        /**
+         * @brief Try to advance the epoch, then reclaim whatever is safe.
+         *
+         * @returns the number of values passed to the reclaim function.
+         */
+        size_type reclaim();
+
+        /**
+         * @brief Adopt the slot of every participant that has died.
+         *
+         * reclaim() only checks the participants holding the epoch back. This
+         * also finds dead ones that left nodes in their retire lists.
+         *
+         * @returns the number of slots adopted.
+         */
+        size_type recover();
+
+        /** @returns the global epoch. */
+        uint64_t epoch() const noexcept;
+
+        /** @returns values retired through this handle or adopted slots and not yet reclaimed. */
+        size_type pending() const noexcept;
+
+        /** @returns this participant's slot. */
+        size_type slot() const noexcept;
+
+      private:
+        std::unique_ptr<shm_object> mObject;
+        epoch_domain_control* mControl;
+        epoch_slot* mSlots;
+        retired_entry* mEntries;
+        size_type mSlotCount;
+        size_type mCapacity;
+        reclaim_function mReclaim;
+        uint64_t mPid;
+        size_type mSlot;
+        unsigned mDepth;
+        /** Slots of dead participants this handle took over. */
+        std::vector<size_type> mAdopted;
+
+        bool try_advance();
+        bool adopt(size_type i, uint64_t owner);
+        size_type collect(size_type i);
+    };
+
+} // namespace pshm
+
+#endif // PSHM_SHM_EPOCH_DOMAIN__HPP
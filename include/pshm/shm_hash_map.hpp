@@ -0,0 +1,386 @@
+#ifndef PSHM_SHM_HASH_MAP__HPP
+#define PSHM_SHM_HASH_MAP__HPP
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include <pshm/config.hpp>
+#include <pshm/control_group.hpp>
+#include <pshm/cpu_relax.hpp>
+#include <pshm/shm_object_native.hpp>
+#include <pshm/stdcpp.hpp>
+
+#include <cstring>
+
+namespace pshm
+{
+    /**
+     * @brief Control block at the start of a shm_hash_map segment.
+     */
+    struct hash_map_control {
+        /** Number of entries, maintained with relaxed atomics. */
+        std::atomic<uint64_t> size;
+        uint8_t pad[56];
+    };
+
+    /**
+     * @brief A slot in a shm_hash_map.
+     *
+     * The key is written once, before the slot's control byte is published,
+     * and never changes. The value is guarded by version, a sequence lock:
+     * odd while a writer is changing it.
+     */
+    template <class K, class V>
+    struct hash_map_slot {
+        std::atomic<uint32_t> version;
+        K key;
+        V value;
+    };
+
+    /**
+     * @brief Fixed capacity hash map in shared memory.
+     *
+     * All the state lives in one segment so any process can use the map.
+     * Lookups are lock-free: they probe groups of control bytes with SIMD tag
+     * matching and read values under a per-slot sequence lock. Inserts claim
+     * empty slots with compare-and-swap, and updates briefly lock only the slot
+     * being changed.
+     *
+     * Erased slots are not reused, so the capacity bounds the total number of
+     * inserts over the map's lifetime rather than the number of live entries.
+     *
+     * @tparam K the key type. Must be trivially copyable.
+     * @tparam V the value type. Must be trivially copyable.
+     * @tparam Hash hashes keys. Must give the same result in every process.
+     * @tparam KeyEqual compares keys.
+     */
+    template <class K, class V, class Hash = std::hash<K>, class KeyEqual = std::equal_to<K>>
+    class shm_hash_map
+    {
+      public:
+        static_assert(std::is_trivially_copyable<K>::value, "shm_hash_map keys must be trivially copyable");
+        static_assert(std::is_trivially_copyable<V>::value, "shm_hash_map values must be trivially copyable");
+
+        using key_type = K;
+        using mapped_type = V;
+        using hasher = Hash;
+        using key_equal = KeyEqual;
+        using slot_type = hash_map_slot<K, V>;
+        using flags_type = shm_object::flags_type;
+        using size_type = shm_object::size_type;
+        using string_type = shm_object::string_type;
+
+        /**
+         * @brief Open a hash map.
+         *
+         * @param name the shared memory object name.
+         *
+         * @param flags the file control flags, e.g. flags::RDWR |
+         * flags::CREAT. flags::HEADER is implied.
+         *
+         * @param capacity the number of slots. Rounded up to a power of two and
+         * at least control_group::WIDTH. Every process must use the same
+         * value.
+         *
+         * @throws std::runtime_error if the segment can't be opened or was
+         * created with a different layout.
+         */
+        shm_hash_map(const string_type& name, flags_type flags, size_type capacity)
+            : mCapacity(round_capacity(capacity))
+            , mGroupMask(mCapacity / control_group::WIDTH - 1)
+        {
+            segment_layout layout = make_layout(mCapacity);
+            mObject.reset(make_shm_object(name, flags | pshm::flags::HEADER, layout.size, 0, layout));
+
+            uint8_t* base = static_cast<uint8_t*>(mObject->get());
+            mControl = reinterpret_cast<hash_map_control*>(base);
+            mCtrl = reinterpret_cast<std::atomic<uint8_t>*>(base + ctrl_offset());
+            mSlots = reinterpret_cast<slot_type*>(base + slots_offset(mCapacity));
+        }
+
+        /**
+         * @brief Look up a key.
+         *
+         * @param key the key to find.
+         * @param value set to a consistent copy of the value if found.
+         * @returns true if the key was found.
+         */
+        bool find(const K& key, V& value) const
+        {
+            const slot_type* s = locate(key, hash(key));
+            if (s == nullptr)
+                return false;
+            value = read_value(*s);
+            return true;
+        }
+
+        /**
+         * @param key the key to find.
+         * @returns true if the key is in the map.
+         */
+        bool contains(const K& key) const
+        {
+            return locate(key, hash(key)) != nullptr;
+        }
+
+        /**
+         * @brief Insert a key if it isn't already present.
+         *
+         * @param key the key to insert.
+         * @param value the value to insert.
+         * @returns true if inserted, false if the key was already present.
+         * @throws std::length_error if the map is full.
+         */
+        bool insert(const K& key, const V& value)
+        {
+            return claim(key, value).second;
+        }
+
+        /**
+         * @brief Insert a key or replace its value.
+         *
+         * @param key the key to insert.
+         * @param value the value to store.
+         * @returns true if inserted, false if an existing value was replaced.
+         * @throws std::length_error if the map is full.
+         */
+        bool insert_or_assign(const K& key, const V& value)
+        {
+            auto r = claim(key, value);
+            if (!r.second)
+                write_value(*r.first, [&value](V& v) { v = value; });
+            return r.second;
+        }
+
+        /**
+         * @brief Change the value of an existing key.
+         *
+         * @param key the key to change.
+         * @param fn called as fn(V&) while the slot is locked. Keep it short:
+         * readers of this key retry until it returns.
+         * @returns true if the key was found.
+         */
+        template <class F>
+        bool update(const K& key, F&& fn)
+        {
+            slot_type* s = locate(key, hash(key));
+            if (s == nullptr)
+                return false;
+            write_value(*s, std::forward<F>(fn));
+            return true;
+        }
+
+        /**
+         * @brief Remove a key.
+         *
+         * @param key the key to remove.
+         * @returns true if this call removed the key.
+         */
+        bool erase(const K& key)
+        {
+            uint64_t h = hash(key);
+            slot_type* s = locate(key, h);
+            if (s == nullptr)
+                return false;
+
+            uint8_t expected = control_group::tag(h);
+            if (!mCtrl[s - mSlots].compare_exchange_strong(expected, control_group::DELETED, std::memory_order_acq_rel))
+                return false;
+            mControl->size.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        /**
+         * @brief Visit every entry.
+         *
+         * Entries inserted or erased while this runs may or may not be seen.
+         *
+         * @param fn called as fn(const K&, const V&) with copies.
+         */
+        template <class F>
+        void for_each(F&& fn) const
+        {
+            for (size_type i = 0; i < mCapacity; ++i) {
+                if ((mCtrl[i].load(std::memory_order_acquire) & control_group::FULL) == 0)
+                    continue;
+                K key;
+                std::memcpy(&key, &mSlots[i].key, sizeof(K));
+                V value = read_value(mSlots[i]);
+                fn(static_cast<const K&>(key), static_cast<const V&>(value));
+            }
+        }
+
+        /** @returns the number of entries. */
+        size_type size() const noexcept
+        {
+            return static_cast<size_type>(mControl->size.load(std::memory_order_relaxed));
+        }
+
+        /** @returns the number of slots. */
+        size_type capacity() const noexcept
+        {
+            return mCapacity;
+        }
+
+      private:
+        std::unique_ptr<shm_object> mObject;
+        hash_map_control* mControl;
+        std::atomic<uint8_t>* mCtrl;
+        slot_type* mSlots;
+        size_type mCapacity;
+        uint64_t mGroupMask;
+        Hash mHasher;
+        KeyEqual mEqual;
+
+        static size_type round_capacity(size_type capacity) noexcept
+        {
+            size_type c = control_group::WIDTH;
+            while (c < capacity)
+                c <<= 1;
+            return c;
+        }
+
+        static constexpr size_type ctrl_offset() noexcept
+        {
+            return sizeof(hash_map_control);
+        }
+
+        static constexpr size_type slots_offset(size_type capacity) noexcept
+        {
+            /* Slots start on a cache line. */
+            return (ctrl_offset() + capacity + 63) / 64 * 64;
+        }
+
+        static segment_layout make_layout(size_type capacity) noexcept
+        {
+            uint64_t h = layout_hash<slot_type>();
+            h = fnv1a_mix(h, layout_hash<K>());
+            h = fnv1a_mix(h, layout_hash<V>());
+            h = fnv1a_mix(h, capacity);
+            return segment_layout{slots_offset(capacity) + capacity * sizeof(slot_type), 64, h};
+        }
+
+        uint64_t hash(const K& key) const
+        {
+            return mix_hash(static_cast<uint64_t>(mHasher(key)));
+        }
+
+        /**
+         * @brief Find the full slot holding key.
+         *
+         * @returns the slot or nullptr.
+         */
+        slot_type* locate(const K& key, uint64_t h) const
+        {
+            const uint8_t t = control_group::tag(h);
+            const uint64_t g = h >> 7;
+
+            for (uint64_t probe = 0; probe <= mGroupMask; ++probe) {
+                size_type base = static_cast<size_type>((g + probe) & mGroupMask) * control_group::WIDTH;
+                control_group group(mCtrl + base);
+
+                for (uint32_t m = group.match(t); m != 0; m &= m - 1) {
+                    size_type i = base + control_group::lowest(m);
+                    if (mCtrl[i].load(std::memory_order_acquire) == t && mEqual(mSlots[i].key, key))
+                        return &mSlots[i];
+                }
+                /* Inserts never skip an empty slot, so the key can't be further on. */
+                if (group.match(control_group::EMPTY) != 0)
+                    return nullptr;
+            }
+            return nullptr;
+        }
+
+        /**
+         * @brief Find key's slot, inserting key and value if missing.
+         *
+         * Every inserter of a key walks the same probe sequence and takes the
+         * first empty slot it sees. Two racing inserters of the same key thus
+         * contend for the same slot, and the loser finds the key there.
+         *
+         * @returns the slot and whether it was inserted.
+         * @throws std::length_error if the map is full.
+         */
+        std::pair<slot_type*, bool> claim(const K& key, const V& value)
+        {
+            const uint64_t h = hash(key);
+            const uint8_t t = control_group::tag(h);
+            const uint64_t g = h >> 7;
+
+            for (uint64_t probe = 0; probe <= mGroupMask; ++probe) {
+                size_type base = static_cast<size_type>((g + probe) & mGroupMask) * control_group::WIDTH;
+                control_group group(mCtrl + base);
+                uint32_t m = group.match(t) | group.match(control_group::BUSY) | group.match(control_group::EMPTY);
+
+                for (; m != 0; m &= m - 1) {
+                    size_type i = base + control_group::lowest(m);
+                    for (;;) {
+                        uint8_t c = mCtrl[i].load(std::memory_order_acquire);
+                        if (c == control_group::BUSY) {
+                            cpu_relax();
+                            continue;
+                        }
+                        if (c == t && mEqual(mSlots[i].key, key))
+                            return std::make_pair(&mSlots[i], false);
+                        if (c != control_group::EMPTY)
+                            break;
+
+                        uint8_t expected = control_group::EMPTY;
+                        if (mCtrl[i].compare_exchange_strong(expected, control_group::BUSY, std::memory_order_acquire)) {
+                            std::memcpy(&mSlots[i].key, &key, sizeof(K));
+                            std::memcpy(&mSlots[i].value, &value, sizeof(V));
+                            mCtrl[i].store(t, std::memory_order_release);
+                            mControl->size.fetch_add(1, std::memory_order_relaxed);
+                            return std::make_pair(&mSlots[i], true);
+                        }
+                        /* Somebody else got it first: look at what they put there. */
+                    }
+                }
+            }
+            throw std::length_error("shm_hash_map is full");
+        }
+
+        /**
+         * @brief Copy a value out under its sequence lock.
+         */
+        static V read_value(const slot_type& s) noexcept
+        {
+            V value;
+            for (;;) {
+                uint32_t v1 = s.version.load(std::memory_order_acquire);
+                if (v1 & 1) {
+                    cpu_relax();
+                    continue;
+                }
+                std::memcpy(&value, &s.value, sizeof(V));
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (s.version.load(std::memory_order_relaxed) == v1)
+                    return value;
+            }
+        }
+
+        /**
+         * @brief Change a value under its sequence lock.
+         */
+        template <class F>
+        static void write_value(slot_type& s, F&& fn)
+        {
+            uint32_t v = s.version.load(std::memory_order_relaxed);
+            for (;;) {
+                if (v & 1) {
+                    cpu_relax();
+                    v = s.version.load(std::memory_order_relaxed);
+                    continue;
+                }
+                if (s.version.compare_exchange_weak(v, v + 1, std::memory_order_acquire))
+                    break;
+            }
+            /* Readers must see the odd version before any of the new bytes. */
+            std::atomic_thread_fence(std::memory_order_release);
+            fn(s.value);
+            s.version.store(v + 2, std::memory_order_release);
+        }
+    };
+
+} // namespace pshm
+
+#endif // PSHM_SHM_HASH_MAP__HPP
@@ -0,0 +1,137 @@
+#ifndef PSHM_SHM_LATCH__HPP
+#define PSHM_SHM_LATCH__HPP
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include <pshm/config.hpp>
+#include <pshm/shm_doorbell.hpp>
+#include <pshm/shm_object_native.hpp>
+#include <pshm/stdcpp.hpp>
+#include <pshm/wait_strategy.hpp>
+
+namespace pshm
+{
+    /**
+     * @brief Control block of a shm_latch.
+     *
+     * Counts up rather than down so that all zero is a fresh latch.
+     */
+    struct latch_control {
+        /** Number of count_down() units so far. */
+        std::atomic<uint64_t> arrived;
+        uint8_t pad0[56];
+
+        /** Rung when arrived reaches the count. */
+        doorbell_state doorbell;
+    };
+
+    static_assert(sizeof(latch_control) == 128, "arrived and doorbell should be on their own cache lines");
+
+    /**
+     * @brief Single use countdown in shared memory, like std::latch.
+     *
+     * Processes count down with count_down() and others block in wait()
+     * until the count reaches zero, e.g. for workers to announce that they
+     * have finished starting up. Whoever counts down to zero rings the
+     * doorbell, waking every sleeper with one futex_wake_all(). Unlike
+     * shm_barrier it never resets: once open it stays open.
+     *
+     * The segment is opened with flags::HEADER so processes that disagree on
+     * the count fail to attach.
+     */
+    class PSHM_EXPORT shm_latch
+    {
+      public:
+        using flags_type = shm_object::flags_type;
+        using size_type = shm_object::size_type;
+        using string_type = shm_object::string_type;
+
+        /**
+         * @brief Open a latch.
+         *
+         * @param name the shared memory object name.
+         *
+         * @param flags the file control flags, e.g. flags::RDWR |
+         * flags::CREAT. Must include flags::RDWR. flags::HEADER is implied.
+         *
+         * @param count how many count_down() units open the latch. Every
+         * process must use the same value.
+         *
+         * @throws std::invalid_argument if flags lacks flags::RDWR.
+         * @throws std::runtime_error if the segment can't be opened.
+         */
+        shm_latch(const string_type& name, flags_type flags, uint64_t count);
+
+        /**
+         * @brief Count down without waiting.
+         *
+         * Counting past zero is harmless.
+         *
+         * @param n how much to count down by.
+         */
+        void count_down(uint64_t n = 1);
+
+        /** @returns true if the count has reached zero. */
+        bool try_wait() const noexcept;
+
+        /** @returns how much is left to count down, 0 once open. */
+        uint64_t remaining() const noexcept;
+
+        /** @returns the count the latch was opened with. */
+        uint64_t count() const noexcept;
+
+        /**
+         * @brief Block until the count reaches zero, spinning briefly then
+         * parking.
+         */
+        void wait()
+        {
+            spin_park strategy;
+            wait(strategy);
+        }
+
+        /**
+         * @brief Block until the count reaches zero, waiting the way strategy
+         * does.
+         *
+         * @param strategy e.g. busy_spin or spin_park, see wait_strategy.hpp.
+         * Its counters are updated.
+         */
+        template <class WaitStrategy>
+        void wait(WaitStrategy& strategy)
+        {
+            strategy.wait(mDoorbell, [this] { return try_wait(); });
+        }
+
+        /**
+         * @brief Block until the count reaches zero or timeout passes.
+         *
+         * @param strategy e.g. busy_spin or spin_park, see wait_strategy.hpp.
+         * @param timeout how long to wait.
+         * @returns try_wait().
+         */
+        template <class WaitStrategy>
+        bool wait_for(WaitStrategy& strategy, std::chrono::nanoseconds timeout)
+        {
+            return strategy.wait_for(mDoorbell, [this] { return try_wait(); }, timeout);
+        }
+
+        /**
+         * @brief count_down() then wait().
+         */
+        void arrive_and_wait(uint64_t n = 1)
+        {
+            count_down(n);
+            wait();
+        }
+
+      private:
+        std::unique_ptr<shm_object> mObject;
+        latch_control* mControl;
+        shm_doorbell mDoorbell;
+        uint64_t mCount;
+    };
+
+} // namespace pshm
+
+#endif // PSHM_SHM_LATCH__HPP
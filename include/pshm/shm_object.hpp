@@ -6,6 +6,7 @@
 #include <pshm/config.hpp>
 #include <pshm/flags.hpp>
 #include <pshm/pshm_export.hpp>
+#include <pshm/segment_header.hpp>
 #include <pshm/stdcpp.hpp>
 #include <pshm/tracing.hpp>
 
@@ -23,6 +24,37 @@ namespace pshm
         using size_type = size_t;
         using string_type = std::string;
 
+        /**
+         * @brief Builds the payload of a newly created object in place.
+         *
+         * Called with the payload address, only in the creating process.
+         */
+        using initializer_type = std::function<void(void*)>;
+
+        /**
+         * @brief Access pattern hints for advise().
+         */
+        enum class advice {
+            /** Forget earlier hints. */
+            normal,
+            /** Read ahead aggressively, drop pages soon after they're read. */
+            sequential,
+            /** Don't read ahead. */
+            random,
+            /** Start faulting the range in now. */
+            will_need,
+            /** Drop this process's mappings of the range. The contents stay in the object. */
+            dont_need,
+            /** Back the range with transparent huge pages where possible. */
+            hugepage,
+            /** Never back the range with transparent huge pages. */
+            no_hugepage,
+            /** Make the range the first to be reclaimed under memory pressure. */
+            cold,
+            /** Reclaim the range now, writing it to swap. */
+            pageout,
+        };
+
         /**
          * @brief Construct a new shm object object.
          *
@@ -109,6 +141,86 @@ namespace pshm
 
         virtual void* get() const noexcept = 0;
 
+        /**
+         * @brief Get the segment header.
+         *
+         * @returns the header at the start of the object when opened with
+         * flags::HEADER, otherwise nullptr.
+         */
+        virtual const segment_header* header() const noexcept = 0;
+
+        /**
+         * @brief Tell the kernel how a range of the object will be used.
+         *
+         * The start of the range is rounded down to a page boundary.
+         *
+         * @param offset where the range starts, relative to get().
+         * @param length the size of the range.
+         * @param hint how the range will be used.
+         *
+         * @throws std::invalid_argument if the range goes past size().
+         * @throws std::runtime_error if the hint isn't supported here or the
+         * kernel rejects it.
+         */
+        virtual void advise(size_type offset, size_type length, advice hint) = 0;
+
+        /**
+         * @brief Tell the kernel how the whole object will be used.
+         *
+         * @param hint how the object will be used.
+         */
+        void advise(advice hint);
+
+        /**
+         * @brief How much of the object is in physical memory.
+         *
+         * Unlike size() this is what the object really costs. Pages count
+         * once they've been touched by any process, not just this one.
+         *
+         * @returns resident bytes of this mapping, in whole pages.
+         * @throws std::runtime_error if the kernel can't tell.
+         */
+        virtual size_type resident_bytes() const = 0;
+
+        /**
+         * @brief Which pages of a range are in physical memory.
+         *
+         * @param offset where the range starts, relative to get(). Rounded
+         * down to a page.
+         * @param length the size of the range.
+         * @returns one entry per page, true if resident.
+         *
+         * @throws std::invalid_argument if the range goes past size().
+         * @throws std::runtime_error if the kernel can't tell.
+         */
+        virtual std::vector<bool> residency(size_type offset, size_type length) const = 0;
+
+        /**
+         * @brief Save the object's contents to a file.
+         *
+         * The file holds a checkpoint_header, including a checksum and the
+         * layout hash, followed by the data. The kernel copies straight from
+         * the object to the file where it can, so nothing extra is mapped or
+         * read into the process. Writers should be quiet while this runs or
+         * the checksum won't match on restore().
+         *
+         * @param path the file to write. Replaced atomically.
+         * @throws std::runtime_error on I/O errors.
+         *
+         * @see pshm::checkpoint_header.
+         */
+        virtual void checkpoint(const string_type& path) const = 0;
+
+        /**
+         * @brief Load the object's contents from a checkpoint() file.
+         *
+         * @param path the file to read.
+         * @throws std::runtime_error if the object isn't writable, the file's
+         * size or layout hash doesn't match the object, the checksum is wrong,
+         * or on I/O errors.
+         */
+        virtual void restore(const string_type& path) = 0;
+
       protected:
         /**
          * @brief Builds a string error message from mTag.
@@ -76,11 +76,15 @@ namespace pshm
          *
          * @param offset the offset into the mapping to start.
          *
+         * When flags includes flags::HEADER, attaching to a segment created
+         * for a different T throws std::runtime_error.
+         *
          * @see pshm::flags.
          * @see pshm::shm_object.
+         * @see pshm::segment_header.
          */
         shm_ptr(const string_type& name, flags_type flags, offset_type offset)
-            : mObject(make_shm_object(name, flags, sizeof(T), offset))
+            : mObject(make_shm_object(name, flags, sizeof(T), offset, make_segment_layout<T>()))
         {
         }
 
@@ -96,7 +100,7 @@ namespace pshm
          * @param flags the file control flags.
          */
         shm_ptr(const string_type& name, flags_type flags)
-            : mObject(make_shm_object(name, flags, sizeof(T), 0))
+            : mObject(make_shm_object(name, flags, sizeof(T), 0, make_segment_layout<T>()))
         {
         }
 
@@ -110,7 +114,7 @@ namespace pshm
          * platforms.
          */
         shm_ptr(const string_type& name)
-            : mObject(make_shm_object(name, flags::RDWR | flags::CREAT, sizeof(T), 0))
+            : mObject(make_shm_object(name, flags::RDWR | flags::CREAT, sizeof(T), 0, make_segment_layout<T>()))
         {
         }
 
@@ -0,0 +1,206 @@
+#ifndef PSHM_SHM_REACTOR__HPP
+#define PSHM_SHM_REACTOR__HPP
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include <pshm/config.hpp>
+
+#if PSHM_COROUTINES
+
+#include <pshm/pshm_export.hpp>
+#include <pshm/shm_broadcast_ring.hpp>
+#include <pshm/shm_doorbell.hpp>
+#include <pshm/stdcpp.hpp>
+
+#include <coroutine>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace pshm
+{
+    /**
+     * @brief Resumes coroutines waiting on shared memory channels.
+     *
+     * The reactor owns one thread and one eventfd. Every doorbell a coroutine
+     * waits on gets the eventfd registered next to other consumers', and the
+     * thread sleeps in epoll_wait() until some producer rings. Producers keep
+     * their syscall free fast path: they only touch the eventfd while the
+     * reactor is asleep.
+     *
+     * The sleep is bounded, so a producer that isn't permitted to signal the
+     * eventfd, or a doorbell with no registration slot left, only delays
+     * wake ups rather than losing them.
+     *
+     * Coroutines are resumed on the reactor thread unless a scheduler is
+     * given, in which case they're handed to it instead so they can carry on
+     * in their own executor.
+     *
+     * Only available when built with PSHM_COROUTINES.
+     */
+    class PSHM_EXPORT shm_reactor
+    {
+      public:
+        using predicate_type = std::function<bool()>;
+        using scheduler_type = std::function<void(std::coroutine_handle<>)>;
+
+        /**
+         * @brief Start the reactor thread.
+         *
+         * @param scheduler called with each coroutine that's ready to resume.
+         * Empty resumes them on the reactor thread.
+         *
+         * @throws std::runtime_error if the eventfd or epoll can't be set up.
+         */
+        explicit shm_reactor(scheduler_type scheduler = scheduler_type());
+
+        /**
+         * @brief Stop the reactor thread.
+         *
+         * Coroutines still waiting are never resumed, so finish them first.
+         */
+        ~shm_reactor();
+
+        shm_reactor(const shm_reactor&) = delete;
+        shm_reactor& operator=(const shm_reactor&) = delete;
+
+        /**
+         * @brief Resume a coroutine once ready() returns true.
+         *
+         * @param bell the doorbell rung when ready() might have changed. The
+         * reactor registers its eventfd there before each sleep.
+         * @param ready checks the channel. Called on the reactor thread.
+         * @param handle the coroutine to resume.
+         */
+        void watch(shm_doorbell& bell, predicate_type ready, std::coroutine_handle<> handle);
+
+        /** @returns the eventfd registered in watched doorbells. */
+        int eventfd() const noexcept;
+
+      private:
+        struct waiter {
+            shm_doorbell* bell;
+            predicate_type ready;
+            std::coroutine_handle<> handle;
+        };
+
+        scheduler_type mScheduler;
+        int mEventFd;
+        int mEpollFd;
+        std::mutex mMutex;
+        std::vector<waiter> mIncoming;
+        bool mStopping;
+        std::thread mThread;
+
+        void run();
+        void resume(std::coroutine_handle<> handle);
+    };
+
+    /**
+     * @brief Awaitable that completes once a predicate on a channel holds.
+     */
+    class doorbell_awaitable
+    {
+      public:
+        doorbell_awaitable(shm_reactor& reactor, shm_doorbell& bell, shm_reactor::predicate_type ready)
+            : mReactor(reactor)
+            , mBell(bell)
+            , mReady(std::move(ready))
+        {
+        }
+
+        bool await_ready()
+        {
+            return mReady();
+        }
+
+        void await_suspend(std::coroutine_handle<> handle)
+        {
+            mReactor.watch(mBell, mReady, handle);
+        }
+
+        void await_resume() noexcept
+        {
+        }
+
+      private:
+        shm_reactor& mReactor;
+        shm_doorbell& mBell;
+        shm_reactor::predicate_type mReady;
+    };
+
+    /**
+     * @brief Wait for a channel without blocking the calling thread.
+     *
+     *     co_await pshm::async_wait(reactor, bell, [&] { return !queue.empty(); });
+     *
+     * @param reactor resumes the coroutine.
+     * @param bell the channel's doorbell.
+     * @param ready checks the channel.
+     */
+    inline doorbell_awaitable async_wait(shm_reactor& reactor, shm_doorbell& bell, shm_reactor::predicate_type ready)
+    {
+        return doorbell_awaitable(reactor, bell, std::move(ready));
+    }
+
+    /**
+     * @brief Awaitable reading the next record of a broadcast ring.
+     */
+    class broadcast_next_awaitable
+    {
+      public:
+        broadcast_next_awaitable(shm_reactor& reactor, shm_broadcast_subscriber& sub, shm_broadcast_subscriber::record& rec)
+            : mReactor(reactor)
+            , mSubscriber(sub)
+            , mRecord(rec)
+        {
+        }
+
+        bool await_ready()
+        {
+            return mSubscriber.pending();
+        }
+
+        void await_suspend(std::coroutine_handle<> handle)
+        {
+            shm_broadcast_subscriber& sub = mSubscriber;
+            mReactor.watch(sub.doorbell(), [&sub] { return sub.pending(); }, handle);
+        }
+
+        shm_broadcast_subscriber::status await_resume()
+        {
+            return mSubscriber.next(mRecord);
+        }
+
+      private:
+        shm_reactor& mReactor;
+        shm_broadcast_subscriber& mSubscriber;
+        shm_broadcast_subscriber::record& mRecord;
+    };
+
+    /**
+     * @brief Read the next record of a broadcast ring, suspending while empty.
+     *
+     *     shm_broadcast_subscriber::record rec;
+     *     while (co_await pshm::async_next(reactor, sub, rec) != status::empty)
+     *         ...
+     *
+     * The subscriber must have been opened with flags::RDWR.
+     *
+     * @param reactor resumes the coroutine.
+     * @param sub the subscriber to read from.
+     * @param rec set to the record on status::ok.
+     * @returns an awaitable producing the status of
+     * shm_broadcast_subscriber::next(). Never status::empty unless another
+     * thread reads the same subscriber.
+     */
+    inline broadcast_next_awaitable async_next(shm_reactor& reactor, shm_broadcast_subscriber& sub, shm_broadcast_subscriber::record& rec)
+    {
+        return broadcast_next_awaitable(reactor, sub, rec);
+    }
+
+} // namespace pshm
+
+#endif // PSHM_COROUTINES
+
+#endif // PSHM_SHM_REACTOR__HPP
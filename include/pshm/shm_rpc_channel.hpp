@@ -0,0 +1,380 @@
+#ifndef PSHM_SHM_RPC_CHANNEL__HPP
+#define PSHM_SHM_RPC_CHANNEL__HPP
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include <pshm/config.hpp>
+#include <pshm/cpu_relax.hpp>
+#include <pshm/shared_copy.hpp>
+#include <pshm/shm_doorbell.hpp>
+#include <pshm/shm_object_native.hpp>
+#include <pshm/stdcpp.hpp>
+#include <pshm/wait_strategy.hpp>
+
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace pshm
+{
+    /**
+     * @brief Control block at the start of a shm_rpc_channel segment.
+     */
+    struct rpc_control {
+        /** Next correlation ID. */
+        std::atomic<uint64_t> next_id;
+        /** Requests ever submitted. */
+        std::atomic<uint64_t> submitted;
+        uint8_t pad0[48];
+
+        /** Requests ever taken by a worker. */
+        std::atomic<uint64_t> taken;
+        uint8_t pad1[56];
+
+        /** Rung by callers after submitting, waited on by workers. */
+        doorbell_state requests;
+    };
+
+    static_assert(sizeof(rpc_control) == 192, "caller and worker counters should be on their own cache lines");
+
+    /**
+     * @brief State of a shm_rpc_channel slot.
+     */
+    struct rpc_slot_header {
+        /** Slot is unused. Zero so a fresh segment is all free. */
+        static constexpr uint32_t FREE = 0;
+        /** A caller is writing the request. */
+        static constexpr uint32_t CLAIMED = 1;
+        /** The request is waiting for a worker. */
+        static constexpr uint32_t REQUEST = 2;
+        /** A worker is computing the response. */
+        static constexpr uint32_t SERVING = 3;
+        /** The response is waiting for the caller. */
+        static constexpr uint32_t RESPONSE = 4;
+        /** The worker's handler threw. The caller gets an error. */
+        static constexpr uint32_t FAILED = 5;
+
+        std::atomic<uint32_t> state;
+        uint32_t reserved;
+        /** Correlation ID of the call using the slot. */
+        uint64_t id;
+        /** Rung by the worker when the response is ready. */
+        doorbell_state done;
+    };
+
+    /**
+     * @brief Request/response calls between processes through one segment.
+     *
+     * The segment holds a fixed array of slots, each with room for one
+     * request, its response, a correlation ID and a doorbell. A caller claims
+     * a free slot, writes its request and rings the workers. A worker takes
+     * every waiting request in one pass, answers them and rings each caller's
+     * slot doorbell. Nothing is copied through the kernel, and with a
+     * spinning wait strategy on both sides no system call is made at all.
+     *
+     * Any number of processes can call and serve. Use one channel object per
+     * thread. A caller that dies between submit() and wait() leaks its slot.
+     * A handler that throws fails only the call it was serving: its caller
+     * gets a std::runtime_error instead of a response.
+     *
+     * @tparam Req the request type. Must be trivially copyable.
+     * @tparam Resp the response type. Must be trivially copyable.
+     */
+    template <class Req, class Resp>
+    class shm_rpc_channel
+    {
+      public:
+        static_assert(std::is_trivially_copyable<Req>::value, "shm_rpc_channel requests must be trivially copyable");
+        static_assert(std::is_trivially_copyable<Resp>::value, "shm_rpc_channel responses must be trivially copyable");
+
+        using request_type = Req;
+        using response_type = Resp;
+        using flags_type = shm_object::flags_type;
+        using size_type = shm_object::size_type;
+        using string_type = shm_object::string_type;
+
+        /**
+         * @brief A submitted call.
+         */
+        struct ticket {
+            size_type slot;
+            uint64_t id;
+        };
+
+        /**
+         * @brief Open a channel.
+         *
+         * @param name the shared memory object name.
+         *
+         * @param flags the file control flags. Callers and workers both need
+         * flags::RDWR. flags::HEADER is implied.
+         *
+         * @param slots the number of calls that can be in flight at once.
+         * Every process must use the same value.
+         *
+         * @throws std::invalid_argument if slots is 0.
+         * @throws std::runtime_error if the segment can't be opened or was
+         * created with a different layout.
+         */
+        shm_rpc_channel(const string_type& name, flags_type flags, size_type slots)
+            : mSlotCount(check_slots(slots))
+            , mNext(0)
+        {
+            segment_layout layout = make_layout(mSlotCount);
+            mObject.reset(make_shm_object(name, flags | pshm::flags::HEADER, layout.size, 0, layout));
+
+            uint8_t* base = static_cast<uint8_t*>(mObject->get());
+            mControl = reinterpret_cast<rpc_control*>(base);
+            mSlots = base + sizeof(rpc_control);
+            mRequests = shm_doorbell(&mControl->requests);
+            mSlotBells.reserve(mSlotCount);
+            for (size_type i = 0; i < mSlotCount; ++i)
+                mSlotBells.emplace_back(&header(i).done);
+        }
+
+        /**
+         * @brief Call a worker and wait for the response.
+         *
+         * @param request the request.
+         * @param strategy how to wait, see wait_strategy.hpp.
+         * @returns the response.
+         * @throws std::runtime_error if the worker's handler threw.
+         */
+        template <class WaitStrategy>
+        Resp call(const Req& request, WaitStrategy& strategy)
+        {
+            return wait(submit(request), strategy);
+        }
+
+        /**
+         * @brief Call a worker and wait for the response, parking after a
+         * short spin.
+         */
+        Resp call(const Req& request)
+        {
+            spin_park strategy;
+            return call(request, strategy);
+        }
+
+        /**
+         * @brief Start a call.
+         *
+         * Spins while every slot is in use.
+         *
+         * @param request the request.
+         * @returns the ticket to pass to wait() or try_get().
+         */
+        ticket submit(const Req& request)
+        {
+            size_type i = claim();
+            rpc_slot_header& h = header(i);
+            uint64_t id = mControl->next_id.fetch_add(1, std::memory_order_relaxed) + 1;
+            h.id = id;
+            copy_to_shared(request_of(i), &request, sizeof(Req));
+            h.state.store(rpc_slot_header::REQUEST, std::memory_order_release);
+
+            mControl->submitted.fetch_add(1, std::memory_order_release);
+            mRequests.ring();
+            return ticket{i, id};
+        }
+
+        /**
+         * @brief Collect the response if it's ready.
+         *
+         * @param t a ticket from submit() that hasn't been collected.
+         * @param response set to the response if ready.
+         * @returns true if the response was ready. The ticket is spent.
+         * @throws std::logic_error if the ticket was already spent.
+         * @throws std::runtime_error if the worker's handler threw. The
+         * ticket is spent.
+         */
+        bool try_get(const ticket& t, Resp& response)
+        {
+            rpc_slot_header& h = header(t.slot);
+            if (h.id != t.id)
+                throw std::logic_error("shm_rpc_channel ticket " + std::to_string(t.id) + " was already collected");
+            uint32_t state = h.state.load(std::memory_order_acquire);
+            if (state == rpc_slot_header::FAILED) {
+                h.id = 0;
+                h.state.store(rpc_slot_header::FREE, std::memory_order_release);
+                throw std::runtime_error("shm_rpc_channel call " + std::to_string(t.id) + " failed: the worker's handler threw");
+            }
+            if (state != rpc_slot_header::RESPONSE)
+                return false;
+            copy_from_shared(&response, response_of(t.slot), sizeof(Resp));
+            h.id = 0;
+            h.state.store(rpc_slot_header::FREE, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * @brief Wait for a response.
+         *
+         * @param t a ticket from submit() that hasn't been collected.
+         * @param strategy how to wait, see wait_strategy.hpp.
+         * @returns the response.
+         * @throws std::logic_error if the ticket was already spent.
+         * @throws std::runtime_error if the worker's handler threw.
+         */
+        template <class WaitStrategy>
+        Resp wait(const ticket& t, WaitStrategy& strategy)
+        {
+            rpc_slot_header& h = header(t.slot);
+            strategy.wait(mSlotBells[t.slot], [&h] {
+                uint32_t state = h.state.load(std::memory_order_acquire);
+                return state == rpc_slot_header::RESPONSE || state == rpc_slot_header::FAILED;
+            });
+            Resp response;
+            if (!try_get(t, response))
+                throw std::logic_error("shm_rpc_channel slot changed state while waiting");
+            return response;
+        }
+
+        /**
+         * @brief Answer every waiting request.
+         *
+         * Takes all the requests that are waiting in one pass, then calls
+         * handler for each and wakes its caller.
+         *
+         * If handler throws, that call is marked failed and its caller woken
+         * to collect the error, then the exception is rethrown. Requests not
+         * reached yet stay waiting for the next serve().
+         *
+         * @param handler called as handler(const Req&, Resp&).
+         * @returns the number of requests answered.
+         * @throws whatever handler throws, after failing its call.
+         */
+        template <class Handler>
+        size_type serve(Handler&& handler)
+        {
+            size_type served = 0;
+            for (size_type i = 0; i < mSlotCount; ++i) {
+                rpc_slot_header& h = header(i);
+                uint32_t expected = rpc_slot_header::REQUEST;
+                if (h.state.load(std::memory_order_relaxed) != expected)
+                    continue;
+                if (!h.state.compare_exchange_strong(expected, rpc_slot_header::SERVING, std::memory_order_acquire))
+                    continue;
+                mControl->taken.fetch_add(1, std::memory_order_relaxed);
+
+                Req request;
+                Resp response;
+                copy_from_shared(&request, request_of(i), sizeof(Req));
+                try {
+                    handler(static_cast<const Req&>(request), response);
+                } catch (...) {
+                    /* Otherwise the slot stays SERVING and its caller waits forever. */
+                    h.state.store(rpc_slot_header::FAILED, std::memory_order_release);
+                    mSlotBells[i].ring();
+                    throw;
+                }
+                copy_to_shared(response_of(i), &response, sizeof(Resp));
+                h.state.store(rpc_slot_header::RESPONSE, std::memory_order_release);
+                mSlotBells[i].ring();
+                served++;
+            }
+            return served;
+        }
+
+        /**
+         * @brief Wait for requests and answer them.
+         *
+         * @param handler called as handler(const Req&, Resp&).
+         * @param strategy how to wait, see wait_strategy.hpp.
+         * @returns the number of requests answered. May be 0 if another
+         * worker got them first.
+         * @throws whatever handler throws, after failing its call.
+         */
+        template <class Handler, class WaitStrategy>
+        size_type serve_wait(Handler&& handler, WaitStrategy& strategy)
+        {
+            rpc_control* c = mControl;
+            strategy.wait(mRequests, [c] {
+                return c->submitted.load(std::memory_order_acquire) != c->taken.load(std::memory_order_relaxed);
+            });
+            return serve(std::forward<Handler>(handler));
+        }
+
+        /**
+         * @returns true if there are requests no worker has taken yet.
+         */
+        bool pending() const noexcept
+        {
+            return mControl->submitted.load(std::memory_order_acquire) != mControl->taken.load(std::memory_order_relaxed);
+        }
+
+        /** @returns the number of slots. */
+        size_type slots() const noexcept
+        {
+            return mSlotCount;
+        }
+
+      private:
+        std::unique_ptr<shm_object> mObject;
+        rpc_control* mControl;
+        uint8_t* mSlots;
+        size_type mSlotCount;
+        size_type mNext;
+        shm_doorbell mRequests;
+        std::vector<shm_doorbell> mSlotBells;
+
+        static constexpr size_type request_offset = (sizeof(rpc_slot_header) + alignof(Req) - 1) / alignof(Req) * alignof(Req);
+        static constexpr size_type response_offset = (request_offset + sizeof(Req) + alignof(Resp) - 1) / alignof(Resp) * alignof(Resp);
+        /** Slots start on cache lines so calls in flight don't share any. */
+        static constexpr size_type slot_stride = (response_offset + sizeof(Resp) + 63) / 64 * 64;
+
+        static size_type check_slots(size_type slots)
+        {
+            if (slots == 0)
+                throw std::invalid_argument("shm_rpc_channel needs at least one slot");
+            return slots;
+        }
+
+        static segment_layout make_layout(size_type slots) noexcept
+        {
+            uint64_t h = layout_hash<rpc_control>();
+            h = fnv1a_mix(h, layout_hash<rpc_slot_header>());
+            h = fnv1a_mix(h, layout_hash<Req>());
+            h = fnv1a_mix(h, layout_hash<Resp>());
+            h = fnv1a_mix(h, slots);
+            return segment_layout{sizeof(rpc_control) + slots * slot_stride, 64, h};
+        }
+
+        rpc_slot_header& header(size_type i) const noexcept
+        {
+            return *reinterpret_cast<rpc_slot_header*>(mSlots + i * slot_stride);
+        }
+
+        void* request_of(size_type i) const noexcept
+        {
+            return mSlots + i * slot_stride + request_offset;
+        }
+
+        void* response_of(size_type i) const noexcept
+        {
+            return mSlots + i * slot_stride + response_offset;
+        }
+
+        /**
+         * @brief Take a free slot, starting after the last one this handle used.
+         */
+        size_type claim()
+        {
+            for (;;) {
+                for (size_type n = 0; n < mSlotCount; ++n) {
+                    size_type i = mNext;
+                    mNext = (mNext + 1 == mSlotCount) ? 0 : mNext + 1;
+                    uint32_t expected = rpc_slot_header::FREE;
+                    rpc_slot_header& h = header(i);
+                    if (h.state.load(std::memory_order_relaxed) == expected
+                        && h.state.compare_exchange_strong(expected, rpc_slot_header::CLAIMED, std::memory_order_acquire))
+                        return i;
+                }
+                std::this_thread::yield();
+            }
+        }
+    };
+
+} // namespace pshm
+
+#endif // PSHM_SHM_RPC_CHANNEL__HPP
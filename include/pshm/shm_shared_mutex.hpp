@@ -0,0 +1,131 @@
+#ifndef PSHM_SHM_SHARED_MUTEX__HPP
+#define PSHM_SHM_SHARED_MUTEX__HPP
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include <pshm/config.hpp>
+#include <pshm/shm_object_native.hpp>
+#include <pshm/stdcpp.hpp>
+
+namespace pshm
+{
+    /**
+     * @brief Control block at the start of a shm_shared_mutex segment.
+     */
+    struct shared_mutex_control {
+        /** 0 when free, 1 when a writer holds or wants the lock, 2 when somebody sleeps on it too. */
+        std::atomic<uint32_t> writer;
+        uint8_t pad0[60];
+
+        /** Hands out the first slot of each handle, round robin. */
+        std::atomic<uint32_t> next_slot;
+        uint8_t pad1[60];
+    };
+
+    /**
+     * @brief Reader indicator of a shm_shared_mutex, one cache line each.
+     */
+    struct shared_mutex_slot {
+        /** Readers holding the lock through this slot. */
+        std::atomic<uint32_t> readers;
+        uint8_t pad[60];
+    };
+
+    static_assert(sizeof(shared_mutex_slot) == 64, "shared_mutex_slot should fill one cache line");
+
+    /**
+     * @brief Reader-writer lock in shared memory for read mostly data.
+     *
+     * Readers don't share a counter: each handle starts at its own reader
+     * slot and each thread using it takes the next one along, so readers
+     * are spread over many slots, each on its own cache line.
+     * Uncontended shared locking is an atomic increment of a line that stays
+     * in the reader's cache and a load of the writer word, which every
+     * reader keeps shared. Writers pay instead: they claim the writer word,
+     * then wait for every slot to drain.
+     *
+     * Writers are preferred. Once a writer has claimed the writer word, new
+     * readers back off and wait for it, so a steady stream of readers can't
+     * starve it. Waiters spin briefly and then sleep on a futex, and unlocks
+     * only make a system call when somebody could be asleep.
+     *
+     * Meets the SharedMutex requirements, so std::unique_lock and
+     * std::shared_lock work. lock_shared() and unlock_shared() must be called
+     * from the same thread, since that picks the slot.
+     *
+     * A process that dies holding the lock leaves it held.
+     */
+    class PSHM_EXPORT shm_shared_mutex
+    {
+      public:
+        using flags_type = shm_object::flags_type;
+        using size_type = shm_object::size_type;
+        using string_type = shm_object::string_type;
+
+        /**
+         * @brief Open a shared mutex.
+         *
+         * @param name the shared memory object name.
+         *
+         * @param flags the file control flags, e.g. flags::RDWR |
+         * flags::CREAT. Must include flags::RDWR. flags::HEADER is implied.
+         *
+         * @param slots the number of reader slots, rounded up to a power of
+         * two. Around the number of cores that read is plenty. Every process
+         * must use the same value.
+         *
+         * @throws std::invalid_argument if flags lacks flags::RDWR.
+         * @throws std::runtime_error if the segment can't be opened or was
+         * created with a different number of slots.
+         */
+        shm_shared_mutex(const string_type& name, flags_type flags, size_type slots = 64);
+
+        shm_shared_mutex(const shm_shared_mutex&) = delete;
+        shm_shared_mutex& operator=(const shm_shared_mutex&) = delete;
+
+        /** @brief Take the lock exclusively, waiting for readers to leave. */
+        void lock();
+
+        /**
+         * @brief Take the lock exclusively if nobody holds it.
+         *
+         * @returns true if taken.
+         */
+        bool try_lock() noexcept;
+
+        /** @brief Release an exclusive lock. */
+        void unlock() noexcept;
+
+        /** @brief Take the lock shared, waiting for any writer. */
+        void lock_shared();
+
+        /**
+         * @brief Take the lock shared unless a writer holds or wants it.
+         *
+         * @returns true if taken.
+         */
+        bool try_lock_shared() noexcept;
+
+        /** @brief Release a shared lock taken by this thread. */
+        void unlock_shared() noexcept;
+
+        /** @returns the number of reader slots. */
+        size_type slots() const noexcept;
+
+      private:
+        std::unique_ptr<shm_object> mObject;
+        shared_mutex_control* mControl;
+        shared_mutex_slot* mSlots;
+        size_type mSlotCount;
+        /** This handle's first slot. */
+        uint32_t mBase;
+
+        shared_mutex_slot& my_slot() const noexcept;
+        void leave(shared_mutex_slot& slot) noexcept;
+        void wait_for_writer() noexcept;
+        void wait_for_readers(shared_mutex_slot& slot) noexcept;
+    };
+
+} // namespace pshm
+
+#endif // PSHM_SHM_SHARED_MUTEX__HPP
@@ -0,0 +1,168 @@
+#ifndef PSHM_SHM_SNAPSHOT__HPP
+#define PSHM_SHM_SNAPSHOT__HPP
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include <pshm/config.hpp>
+#include <pshm/pshm_export.hpp>
+#include <pshm/shm_object.hpp>
+#include <pshm/stdcpp.hpp>
+
+namespace pshm
+{
+    /**
+     * @brief Marks a change to a segment's payload for shm_snapshot.
+     *
+     * Bumps segment_header::write_epoch when constructed and again when
+     * destroyed, so snapshots taken while it's alive are retaken or reported
+     * invalid. Writers that overlap are fine: the epoch stays busy until the
+     * last one finishes.
+     *
+     * Writers that don't use this are invisible to snapshots.
+     */
+    class shm_write_epoch
+    {
+      public:
+        /**
+         * @brief Begin a write.
+         *
+         * @param object a segment opened with flags::HEADER and flags::RDWR.
+         * @throws std::invalid_argument if it wasn't.
+         */
+        explicit shm_write_epoch(shm_object& object)
+            : mEpoch(epoch_of(object))
+        {
+            mEpoch.fetch_add(1, std::memory_order_relaxed);
+            /* Snapshots must see the busy epoch before any of the new bytes. */
+            std::atomic_thread_fence(std::memory_order_release);
+        }
+
+        /**
+         * @brief End the write.
+         */
+        ~shm_write_epoch()
+        {
+            mEpoch.fetch_add((uint64_t(1) << 32) - 1, std::memory_order_release);
+        }
+
+        shm_write_epoch(const shm_write_epoch&) = delete;
+        shm_write_epoch& operator=(const shm_write_epoch&) = delete;
+
+      private:
+        std::atomic<uint64_t>& mEpoch;
+
+        static std::atomic<uint64_t>& epoch_of(shm_object& object)
+        {
+            const segment_header* h = object.header();
+            if (h == nullptr)
+                throw std::invalid_argument("shm_write_epoch requires flags::HEADER: " + object.name());
+            if ((object.flags() & flags::RDWR) == 0)
+                throw std::invalid_argument("shm_write_epoch requires flags::RDWR: " + object.name());
+            return const_cast<segment_header*>(h)->write_epoch;
+        }
+    };
+
+    /**
+     * @brief Point in time view of a segment that a writer keeps changing.
+     *
+     * The snapshot maps the object MAP_PRIVATE and checks
+     * segment_header::write_epoch before and after, so it never mixes bytes
+     * from before and after a shm_write_epoch.
+     *
+     * A private mapping only copies the pages its own process writes. Pages
+     * changed through another process's shared mapping still show through
+     * until they are copied, so there are two modes:
+     *
+     * - mode::frozen breaks copy-on-write for every page up front with
+     *   MADV_POPULATE_WRITE. The kernel copies the payload once and the view
+     *   stays put. Memory use is the payload size.
+     *
+     * - mode::optimistic copies nothing. The view is live, and valid() says
+     *   whether a write has started since it was taken. Process the data,
+     *   then check valid() and refresh() and start over if needed.
+     *
+     * An optimistic snapshot costs next to nothing. A frozen one copies the
+     * payload inside the kernel, once, with no user space loop.
+     */
+    class PSHM_EXPORT shm_snapshot
+    {
+      public:
+        using size_type = shm_object::size_type;
+        using string_type = shm_object::string_type;
+
+        enum class mode {
+            /** Copy every page up front. */
+            frozen,
+            /** Copy nothing and check valid() afterwards. */
+            optimistic,
+        };
+
+        /**
+         * @brief Take a snapshot.
+         *
+         * @param live the segment, opened with flags::HEADER. Must outlive
+         * the snapshot. Its segment_header supplies the epoch and its name
+         * is opened again for the private mapping.
+         *
+         * @param m how to take it.
+         *
+         * @param attempts how many times a snapshot is retaken when a write
+         * overlaps it.
+         *
+         * @throws std::invalid_argument if live has no segment_header.
+         * @throws std::runtime_error if the object can't be mapped or a
+         * consistent snapshot wasn't taken in attempts tries.
+         */
+        explicit shm_snapshot(const shm_object& live, mode m = mode::frozen, unsigned attempts = 16);
+
+        ~shm_snapshot();
+
+        shm_snapshot(const shm_snapshot&) = delete;
+        shm_snapshot& operator=(const shm_snapshot&) = delete;
+
+        /** @returns the snapshot of the payload. */
+        const void* get() const noexcept;
+
+        /** @returns the size of the payload. */
+        size_type size() const noexcept;
+
+        /** @returns the write_epoch the snapshot was taken at. */
+        uint64_t epoch() const noexcept;
+
+        /** @returns the mode the snapshot was taken in. */
+        mode snapshot_mode() const noexcept;
+
+        /**
+         * @brief Check that the snapshot is consistent.
+         *
+         * Always true for a frozen snapshot.
+         *
+         * @returns false if an optimistic snapshot has seen a write start.
+         */
+        bool valid() const noexcept;
+
+        /**
+         * @brief Throw away the view and take a new one.
+         *
+         * @throws std::runtime_error as for the constructor.
+         */
+        void refresh();
+
+      private:
+        const shm_object& mLive;
+        mode mMode;
+        unsigned mAttempts;
+        int mFile;
+        void* mMapping;
+        size_type mMappingSize;
+        const void* mPointer;
+        uint64_t mEpoch;
+
+        uint64_t quiet_epoch() const noexcept;
+        void take();
+        void release() noexcept;
+    };
+
+} // namespace pshm
+
+#endif // PSHM_SHM_SNAPSHOT__HPP
@@ -0,0 +1,309 @@
+#ifndef PSHM_SHM_TABLE__HPP
+#define PSHM_SHM_TABLE__HPP
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include <pshm/config.hpp>
+#include <pshm/shared_copy.hpp>
+#include <pshm/shm_object_native.hpp>
+#include <pshm/stdcpp.hpp>
+
+#include <array>
+#include <cstring>
+#include <tuple>
+
+namespace pshm
+{
+    /**
+     * @brief Control block at the start of a shm_table segment.
+     */
+    struct table_control {
+        /** Rows published so far. Written only by the writer, with release. */
+        std::atomic<uint64_t> rows;
+        uint8_t pad[56];
+    };
+
+    /**
+     * @brief Contiguous run of one column's values.
+     *
+     * A minimal std::span for C++14.
+     *
+     * @tparam T the element type, usually const.
+     */
+    template <class T>
+    class column_span
+    {
+      public:
+        using element_type = T;
+        using size_type = size_t;
+        using iterator = T*;
+
+        column_span(T* data, size_type size) noexcept
+            : mData(data)
+            , mSize(size)
+        {
+        }
+
+        T* data() const noexcept
+        {
+            return mData;
+        }
+
+        size_type size() const noexcept
+        {
+            return mSize;
+        }
+
+        bool empty() const noexcept
+        {
+            return mSize == 0;
+        }
+
+        iterator begin() const noexcept
+        {
+            return mData;
+        }
+
+        iterator end() const noexcept
+        {
+            return mData + mSize;
+        }
+
+        T& operator[](size_type i) const noexcept
+        {
+            return mData[i];
+        }
+
+      private:
+        T* mData;
+        size_type mSize;
+    };
+
+    /**
+     * @brief Append only table in shared memory stored column by column.
+     *
+     * Each column is one contiguous array starting on a cache line, so a
+     * reader scanning one field streams exactly that field's bytes and the
+     * compiler can vectorize loops over a column_span. Compare an array of
+     * structs, where a scan of one field drags every other field through the
+     * cache with it.
+     *
+     * The writer fills in a row's values and then publishes it by bumping the
+     * row count with a single release store. Readers load the count with
+     * acquire, so every row it covers is complete. There must be at most one
+     * writer at a time. Readers need no locks at all.
+     *
+     * @tparam Columns the type of each column. Must be trivially copyable and
+     * aligned to no more than a cache line.
+     */
+    template <class... Columns>
+    class shm_table
+    {
+      public:
+        static_assert(sizeof...(Columns) > 0, "shm_table needs at least one column");
+
+        using row_type = std::tuple<Columns...>;
+        using flags_type = shm_object::flags_type;
+        using size_type = shm_object::size_type;
+        using string_type = shm_object::string_type;
+
+        /** The type of column I. */
+        template <size_t I>
+        using column_type = std::tuple_element_t<I, row_type>;
+
+        /** Number of columns. */
+        static constexpr size_type COLUMNS = sizeof...(Columns);
+
+        /** Every column starts on a multiple of this. */
+        static constexpr size_type COLUMN_ALIGNMENT = 64;
+
+        /**
+         * @brief Open a table.
+         *
+         * @param name the shared memory object name.
+         *
+         * @param flags the file control flags, e.g. flags::RDWR |
+         * flags::CREAT. flags::HEADER is implied.
+         *
+         * @param capacity the maximum number of rows. Every process must use
+         * the same value.
+         *
+         * @throws std::runtime_error if the segment can't be opened or was
+         * created with a different layout.
+         */
+        shm_table(const string_type& name, flags_type flags, size_type capacity)
+            : mCapacity(capacity)
+        {
+            std::array<size_type, COLUMNS + 1> offsets = column_offsets(capacity);
+            segment_layout layout = make_layout(capacity, offsets[COLUMNS]);
+            mObject.reset(make_shm_object(name, flags | pshm::flags::HEADER, layout.size, 0, layout));
+
+            uint8_t* base = static_cast<uint8_t*>(mObject->get());
+            mControl = reinterpret_cast<table_control*>(base);
+            for (size_type i = 0; i < COLUMNS; ++i)
+                mColumns[i] = base + offsets[i];
+        }
+
+        /**
+         * @brief Append one row.
+         *
+         * @param values one value per column.
+         * @returns the index of the new row.
+         * @throws std::length_error if the table is full.
+         */
+        size_type append(const Columns&... values)
+        {
+            size_type row = reserve(1);
+            store_row(row, std::index_sequence_for<Columns...>(), values...);
+            publish(row + 1);
+            return row;
+        }
+
+        /**
+         * @brief Append many rows at once, a column at a time.
+         *
+         * @param count the number of rows.
+         * @param columns count values per column.
+         * @returns the index of the first new row.
+         * @throws std::length_error if they don't all fit.
+         */
+        size_type append_rows(size_type count, const Columns*... columns)
+        {
+            size_type row = reserve(count);
+            store_rows(row, count, std::index_sequence_for<Columns...>(), columns...);
+            publish(row + count);
+            return row;
+        }
+
+        /**
+         * @brief Drop every row.
+         *
+         * Spans readers already hold see their rows overwritten by later
+         * appends.
+         */
+        void clear() noexcept
+        {
+            mControl->rows.store(0, std::memory_order_release);
+        }
+
+        /**
+         * @brief Every published row of column I.
+         *
+         * @tparam I the column index.
+         * @returns the values. The first 64 bytes of data() share a cache
+         * line with nothing else.
+         */
+        template <size_t I>
+        column_span<const column_type<I>> column() const noexcept
+        {
+            return column_span<const column_type<I>>(column_data<I>(), size());
+        }
+
+        /**
+         * @brief Copy out one row.
+         *
+         * @param i the row index. Must be less than size().
+         * @returns the row's values.
+         */
+        row_type row(size_type i) const
+        {
+            return load_row(i, std::index_sequence_for<Columns...>());
+        }
+
+        /** @returns the number of published rows. */
+        size_type size() const noexcept
+        {
+            return static_cast<size_type>(mControl->rows.load(std::memory_order_acquire));
+        }
+
+        /** @returns the maximum number of rows. */
+        size_type capacity() const noexcept
+        {
+            return mCapacity;
+        }
+
+      private:
+        std::unique_ptr<shm_object> mObject;
+        table_control* mControl;
+        std::array<uint8_t*, COLUMNS> mColumns;
+        size_type mCapacity;
+
+        static constexpr size_type round_up(size_type n) noexcept
+        {
+            return (n + COLUMN_ALIGNMENT - 1) / COLUMN_ALIGNMENT * COLUMN_ALIGNMENT;
+        }
+
+        /**
+         * @returns where each column starts, and then the total size.
+         */
+        static std::array<size_type, COLUMNS + 1> column_offsets(size_type capacity) noexcept
+        {
+            const size_type sizes[] = {round_up(capacity * sizeof(Columns))...};
+            std::array<size_type, COLUMNS + 1> offsets;
+            offsets[0] = round_up(sizeof(table_control));
+            for (size_type i = 0; i < COLUMNS; ++i)
+                offsets[i + 1] = offsets[i] + sizes[i];
+            return offsets;
+        }
+
+        static segment_layout make_layout(size_type capacity, size_type size) noexcept
+        {
+            const uint64_t hashes[] = {layout_hash<Columns>()...};
+            uint64_t h = layout_hash<table_control>();
+            for (uint64_t c : hashes)
+                h = fnv1a_mix(h, c);
+            h = fnv1a_mix(h, capacity);
+            return segment_layout{size, COLUMN_ALIGNMENT, h};
+        }
+
+        template <size_t I>
+        column_type<I>* column_data() const noexcept
+        {
+            static_assert(std::is_trivially_copyable<column_type<I>>::value, "shm_table columns must be trivially copyable");
+            static_assert(alignof(column_type<I>) <= COLUMN_ALIGNMENT, "shm_table columns can't be over aligned");
+            return reinterpret_cast<column_type<I>*>(mColumns[I]);
+        }
+
+        size_type reserve(size_type count) const
+        {
+            size_type rows = static_cast<size_type>(mControl->rows.load(std::memory_order_relaxed));
+            if (count > mCapacity - rows)
+                throw std::length_error("shm_table is full");
+            return rows;
+        }
+
+        void publish(size_type rows) noexcept
+        {
+            mControl->rows.store(rows, std::memory_order_release);
+        }
+
+        template <size_t... I>
+        void store_row(size_type row, std::index_sequence<I...>, const Columns&... values) noexcept
+        {
+            using expand = int[];
+            (void)expand{0, (std::memcpy(column_data<I>() + row, &values, sizeof(values)), 0)...};
+        }
+
+        template <size_t... I>
+        void store_rows(size_type row, size_type count, std::index_sequence<I...>, const Columns*... columns) noexcept
+        {
+            using expand = int[];
+            (void)expand{0, (copy_to_shared(column_data<I>() + row, columns, count * sizeof(Columns)), 0)...};
+        }
+
+        template <size_t... I>
+        row_type load_row(size_type i, std::index_sequence<I...>) const
+        {
+            return row_type(column_data<I>()[i]...);
+        }
+    };
+
+    template <class... Columns>
+    constexpr typename shm_table<Columns...>::size_type shm_table<Columns...>::COLUMNS;
+
+    template <class... Columns>
+    constexpr typename shm_table<Columns...>::size_type shm_table<Columns...>::COLUMN_ALIGNMENT;
+
+} // namespace pshm
+
+#endif // PSHM_SHM_TABLE__HPP
@@ -0,0 +1,366 @@
+#ifndef PSHM_SHM_TASK_POOL__HPP
+#define PSHM_SHM_TASK_POOL__HPP
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include <pshm/config.hpp>
+#include <pshm/shm_doorbell.hpp>
+#include <pshm/shm_object_native.hpp>
+#include <pshm/stdcpp.hpp>
+#include <pshm/wait_strategy.hpp>
+
+#include <cstring>
+
+namespace pshm
+{
+    /**
+     * @brief Control block at the start of a shm_task_pool segment.
+     */
+    struct task_pool_control {
+        /** Set by stop(). */
+        std::atomic<uint32_t> stopping;
+        uint8_t pad0[60];
+
+        /** Rung by push() for workers asleep in next(). */
+        doorbell_state doorbell;
+    };
+
+    static_assert(sizeof(task_pool_control) == 128, "stopping and doorbell should be on their own cache lines");
+
+    /**
+     * @brief Ends of one worker's Chase-Lev deque.
+     *
+     * Tasks live at [top, bottom). The owner pushes and pops at the bottom,
+     * thieves take from the top. Both only ever grow, except for the owner
+     * briefly taking bottom back in pop().
+     */
+    struct work_deque_control {
+        /** Next task to steal. Moved by thieves, and by the owner taking the last task. */
+        std::atomic<int64_t> top;
+        uint8_t pad0[56];
+
+        /** One past the newest task. Only written by the owner. */
+        std::atomic<int64_t> bottom;
+        uint8_t pad1[56];
+    };
+
+    static_assert(sizeof(work_deque_control) == 128, "top and bottom should be on their own cache lines");
+
+    /**
+     * @brief Work stealing task pool for worker processes sharing a segment.
+     *
+     * Every worker owns a fixed capacity Chase-Lev deque in the segment. It
+     * pushes the tasks it creates onto its own deque and pops them back
+     * newest first, which keeps its working set hot and costs no atomic
+     * read-modify-write unless the deque is down to one task. Workers that
+     * run dry steal the oldest task from somebody else's deque with one
+     * compare-and-swap. Stolen tasks tend to be the biggest, so steals are
+     * rare once the pool is busy.
+     *
+     * Workers with nothing to run or steal sleep on the pool's doorbell, and
+     * push() wakes them. stop() wakes everyone and makes next() return false.
+     *
+     * Tasks are copied in and out with memcpy, so they should be small
+     * descriptors, e.g. an offset into a shared arena plus a few parameters.
+     * Each handle is one worker and must only be used by one thread at a
+     * time. A worker that dies takes the tasks in its deque with it unless
+     * somebody steals them.
+     *
+     * @tparam Task the task descriptor. Must be trivially copyable.
+     */
+    template <class Task>
+    class shm_task_pool
+    {
+      public:
+        static_assert(std::is_trivially_copyable<Task>::value, "shm_task_pool tasks must be trivially copyable");
+
+        using task_type = Task;
+        using flags_type = shm_object::flags_type;
+        using size_type = shm_object::size_type;
+        using string_type = shm_object::string_type;
+
+        /**
+         * @brief Join a task pool as one of its workers.
+         *
+         * @param name the shared memory object name.
+         *
+         * @param flags the file control flags, e.g. flags::RDWR |
+         * flags::CREAT. Must include flags::RDWR. flags::HEADER is implied.
+         *
+         * @param workers the number of deques. Every process must use the
+         * same value.
+         *
+         * @param capacity tasks per deque, rounded up to a power of two.
+         * Every process must use the same value.
+         *
+         * @param id this worker, in [0, workers). Picks the deque it owns.
+         *
+         * @throws std::invalid_argument if an argument is out of range or
+         * flags lacks flags::RDWR.
+         * @throws std::runtime_error if the segment can't be opened or was
+         * created with different sizes.
+         */
+        shm_task_pool(const string_type& name, flags_type flags, size_type workers, size_type capacity, size_type id)
+            : mWorkers(workers)
+            , mCapacity(round_capacity(capacity))
+            , mId(id)
+            , mVictim(id)
+            , mSteals(0)
+        {
+            if ((flags & pshm::flags::RDWR) == 0)
+                throw std::invalid_argument("a task pool requires flags::RDWR");
+            if (workers == 0 || id >= workers)
+                throw std::invalid_argument("task pool worker id " + std::to_string(id) + " is out of range");
+
+            segment_layout layout = make_layout(mWorkers, mCapacity);
+            mObject.reset(make_shm_object(name, flags | pshm::flags::HEADER, layout.size, 0, layout));
+
+            uint8_t* base = static_cast<uint8_t*>(mObject->get());
+            mControl = reinterpret_cast<task_pool_control*>(base);
+            mDeques = reinterpret_cast<work_deque_control*>(base + sizeof(task_pool_control));
+            mTasks = reinterpret_cast<Task*>(base + tasks_offset(mWorkers));
+            mDoorbell = shm_doorbell(&mControl->doorbell);
+        }
+
+        shm_task_pool(const shm_task_pool&) = delete;
+        shm_task_pool& operator=(const shm_task_pool&) = delete;
+
+        /**
+         * @brief Add a task to this worker's deque and wake a sleeper.
+         *
+         * @param task the task.
+         * @returns false if the deque is full. Run the task inline instead.
+         */
+        bool push(const Task& task)
+        {
+            work_deque_control& d = mDeques[mId];
+            int64_t b = d.bottom.load(std::memory_order_relaxed);
+            int64_t t = d.top.load(std::memory_order_acquire);
+            if (b - t >= static_cast<int64_t>(mCapacity))
+                return false;
+
+            std::memcpy(&slot(mId, b), &task, sizeof(Task));
+            /* Thieves must see the task before the new bottom. */
+            std::atomic_thread_fence(std::memory_order_release);
+            d.bottom.store(b + 1, std::memory_order_relaxed);
+            mDoorbell.ring();
+            return true;
+        }
+
+        /**
+         * @brief Take the newest task from this worker's deque.
+         *
+         * @param task set to the task.
+         * @returns false if the deque was empty or a thief got the last one.
+         */
+        bool pop(Task& task) noexcept
+        {
+            work_deque_control& d = mDeques[mId];
+            int64_t b = d.bottom.load(std::memory_order_relaxed) - 1;
+            d.bottom.store(b, std::memory_order_relaxed);
+            /* Thieves must see the smaller bottom before we look at top. */
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t t = d.top.load(std::memory_order_relaxed);
+
+            if (t > b) {
+                d.bottom.store(b + 1, std::memory_order_relaxed);
+                return false;
+            }
+            std::memcpy(&task, &slot(mId, b), sizeof(Task));
+            if (t == b) {
+                /* The last task: race the thieves for it. */
+                bool won = d.top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+                d.bottom.store(b + 1, std::memory_order_relaxed);
+                return won;
+            }
+            return true;
+        }
+
+        /**
+         * @brief Take the oldest task from another worker's deque.
+         *
+         * @param task set to the task.
+         * @param victim the worker to steal from.
+         * @returns false if its deque was empty or another thief won.
+         */
+        bool steal(Task& task, size_type victim) noexcept
+        {
+            work_deque_control& d = mDeques[victim];
+            int64_t t = d.top.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t b = d.bottom.load(std::memory_order_acquire);
+            if (t >= b)
+                return false;
+
+            /* May be overwritten by now, in which case the CAS fails. */
+            Task copy;
+            std::memcpy(&copy, &slot(victim, t), sizeof(Task));
+            if (!d.top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                return false;
+            task = copy;
+            return true;
+        }
+
+        /**
+         * @brief Pop a task, or steal one if this deque is empty.
+         *
+         * Victims are tried round robin, starting after the last one robbed.
+         *
+         * @param task set to the task.
+         * @returns false if no task was found.
+         */
+        bool try_next(Task& task) noexcept
+        {
+            if (pop(task))
+                return true;
+            for (size_type i = 1; i < mWorkers; ++i) {
+                size_type victim = (mVictim + i) % mWorkers;
+                if (victim == mId)
+                    continue;
+                if (steal(task, victim)) {
+                    mVictim = victim;
+                    mSteals++;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /**
+         * @brief Get a task, sleeping while there is none anywhere.
+         *
+         * @param task set to the task.
+         * @returns false once stop() has been called.
+         */
+        bool next(Task& task)
+        {
+            spin_park strategy;
+            return next(task, strategy);
+        }
+
+        /**
+         * @brief Get a task, waiting the way strategy does while there is none.
+         *
+         * @param task set to the task.
+         * @param strategy e.g. busy_spin or spin_park, see wait_strategy.hpp.
+         * @returns false once stop() has been called.
+         */
+        template <class WaitStrategy>
+        bool next(Task& task, WaitStrategy& strategy)
+        {
+            for (;;) {
+                if (stopped())
+                    return false;
+                if (try_next(task))
+                    return true;
+                strategy.wait(mDoorbell, [this] { return stopped() || available(); });
+            }
+        }
+
+        /**
+         * @brief Make next() return false in every worker, waking sleepers.
+         *
+         * Tasks still queued are left where they are.
+         */
+        void stop()
+        {
+            mControl->stopping.store(1, std::memory_order_release);
+            mDoorbell.ring();
+        }
+
+        /** @returns true once stop() has been called. */
+        bool stopped() const noexcept
+        {
+            return mControl->stopping.load(std::memory_order_acquire) != 0;
+        }
+
+        /** @returns true if any deque looks non-empty. */
+        bool available() const noexcept
+        {
+            for (size_type i = 0; i < mWorkers; ++i) {
+                if (size(i) != 0)
+                    return true;
+            }
+            return false;
+        }
+
+        /**
+         * @param worker whose deque.
+         * @returns roughly how many tasks it holds.
+         */
+        size_type size(size_type worker) const noexcept
+        {
+            int64_t b = mDeques[worker].bottom.load(std::memory_order_acquire);
+            int64_t t = mDeques[worker].top.load(std::memory_order_acquire);
+            return b > t ? static_cast<size_type>(b - t) : 0;
+        }
+
+        /** @returns the number of workers. */
+        size_type workers() const noexcept
+        {
+            return mWorkers;
+        }
+
+        /** @returns tasks per deque. */
+        size_type capacity() const noexcept
+        {
+            return mCapacity;
+        }
+
+        /** @returns this worker's id. */
+        size_type id() const noexcept
+        {
+            return mId;
+        }
+
+        /** @returns how many tasks this handle has stolen. */
+        uint64_t steals() const noexcept
+        {
+            return mSteals;
+        }
+
+      private:
+        std::unique_ptr<shm_object> mObject;
+        task_pool_control* mControl;
+        work_deque_control* mDeques;
+        Task* mTasks;
+        shm_doorbell mDoorbell;
+        size_type mWorkers;
+        size_type mCapacity;
+        size_type mId;
+        size_type mVictim;
+        uint64_t mSteals;
+
+        static size_type round_capacity(size_type capacity) noexcept
+        {
+            size_type n = 1;
+            while (n < capacity)
+                n <<= 1;
+            return n;
+        }
+
+        static constexpr size_type tasks_offset(size_type workers) noexcept
+        {
+            /* Tasks start on a cache line. */
+            return (sizeof(task_pool_control) + workers * sizeof(work_deque_control) + 63) / 64 * 64;
+        }
+
+        static segment_layout make_layout(size_type workers, size_type capacity) noexcept
+        {
+            uint64_t h = layout_hash<task_pool_control>();
+            h = fnv1a_mix(h, layout_hash<work_deque_control>());
+            h = fnv1a_mix(h, layout_hash<Task>());
+            h = fnv1a_mix(h, workers);
+            h = fnv1a_mix(h, capacity);
+            return segment_layout{tasks_offset(workers) + workers * capacity * sizeof(Task), 64, h};
+        }
+
+        Task& slot(size_type worker, int64_t index) const noexcept
+        {
+            return mTasks[worker * mCapacity + (static_cast<size_type>(index) & (mCapacity - 1))];
+        }
+    };
+
+} // namespace pshm
+
+#endif // PSHM_SHM_TASK_POOL__HPP
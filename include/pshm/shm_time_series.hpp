@@ -0,0 +1,358 @@
+#ifndef PSHM_SHM_TIME_SERIES__HPP
+#define PSHM_SHM_TIME_SERIES__HPP
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include <pshm/config.hpp>
+#include <pshm/shm_object_native.hpp>
+#include <pshm/stdcpp.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace pshm
+{
+    /**
+     * @brief Control block at the start of a shm_time_series segment.
+     */
+    struct time_series_control {
+        /** Samples ever appended. Written only by the writer, with release. */
+        std::atomic<uint64_t> head;
+        uint8_t pad[56];
+    };
+
+    /**
+     * @brief One timestamped value in a shm_time_series.
+     */
+    template <class T>
+    struct time_series_sample {
+        /** Nanoseconds since the system_clock epoch. */
+        int64_t timestamp;
+        T value;
+    };
+
+    /**
+     * @brief Aggregates of the samples in a window.
+     */
+    template <class T>
+    struct window_stats {
+        uint64_t count;
+        double sum;
+        T min;
+        T max;
+
+        /** @returns sum / count, or 0 for an empty window. */
+        double mean() const noexcept
+        {
+            return count == 0 ? 0.0 : sum / static_cast<double>(count);
+        }
+    };
+
+    /**
+     * @brief Fixed size history of timestamped samples in shared memory.
+     *
+     * A ring of the newest capacity() samples, e.g. an hour of once a second
+     * metrics. The writer stores a sample in its slot and publishes it by
+     * bumping the head with a single release store, so appending never
+     * blocks and never waits on readers.
+     *
+     * Readers aggregate a window of samples where they lie, newest first,
+     * then check the head again. If the writer lapped any slot they read,
+     * the pass is thrown away and repeated. With a ring holding minutes of
+     * history that practically never happens.
+     *
+     * There must be at most one writer at a time, and it must append samples
+     * in timestamp order.
+     *
+     * @tparam T the value type. Must be arithmetic.
+     */
+    template <class T = double>
+    class shm_time_series
+    {
+      public:
+        static_assert(std::is_arithmetic<T>::value, "shm_time_series values must be arithmetic");
+
+        using value_type = T;
+        using sample_type = time_series_sample<T>;
+        using stats_type = window_stats<T>;
+        using clock = std::chrono::system_clock;
+        using flags_type = shm_object::flags_type;
+        using size_type = shm_object::size_type;
+        using string_type = shm_object::string_type;
+
+        /**
+         * @brief Open a time series.
+         *
+         * @param name the shared memory object name.
+         *
+         * @param flags the file control flags, e.g. flags::RDWR |
+         * flags::CREAT. flags::HEADER is implied.
+         *
+         * @param capacity the number of samples kept. Rounded up to one less
+         * than a power of two, since readers stay off the slot the writer
+         * fills next. Every process must use the same value.
+         *
+         * @throws std::runtime_error if the segment can't be opened or was
+         * created with a different layout.
+         */
+        shm_time_series(const string_type& name, flags_type flags, size_type capacity)
+            : mSlots(round_slots(capacity + 1))
+        {
+            segment_layout layout = make_layout(mSlots);
+            mObject.reset(make_shm_object(name, flags | pshm::flags::HEADER, layout.size, 0, layout));
+
+            uint8_t* base = static_cast<uint8_t*>(mObject->get());
+            mControl = reinterpret_cast<time_series_control*>(base);
+            mSamples = reinterpret_cast<sample_type*>(base + sizeof(time_series_control));
+        }
+
+        /**
+         * @brief Append a sample.
+         *
+         * @param timestamp nanoseconds since the system_clock epoch. No
+         * earlier than the last sample's.
+         * @param value the value.
+         */
+        void append(int64_t timestamp, T value) noexcept
+        {
+            uint64_t head = mControl->head.load(std::memory_order_relaxed);
+            sample_type s{timestamp, value};
+            std::memcpy(&mSamples[head & (mSlots - 1)], &s, sizeof(s));
+            mControl->head.store(head + 1, std::memory_order_release);
+        }
+
+        /**
+         * @brief Append a sample taken now.
+         *
+         * @param value the value.
+         */
+        void append(T value) noexcept
+        {
+            append(now(), value);
+        }
+
+        /**
+         * @brief Get the newest sample.
+         *
+         * @param sample set to the newest sample.
+         * @returns false if there are no samples.
+         */
+        bool latest(sample_type& sample) const noexcept
+        {
+            struct last {
+                sample_type* out;
+                bool found;
+                bool add(const sample_type& s) noexcept
+                {
+                    *out = s;
+                    found = true;
+                    return false;
+                }
+            };
+            return scan(std::numeric_limits<int64_t>::min(), std::numeric_limits<int64_t>::max(), last{&sample, false}).found;
+        }
+
+        /**
+         * @brief Aggregate the samples in [from, to].
+         *
+         * @param from the oldest timestamp included.
+         * @param to the newest timestamp included.
+         * @returns the count, sum, min and max. min and max are 0 if the
+         * window is empty.
+         */
+        stats_type stats(int64_t from, int64_t to) const noexcept
+        {
+            struct aggregate {
+                stats_type st;
+                bool add(const sample_type& s) noexcept
+                {
+                    if (st.count == 0) {
+                        st.min = s.value;
+                        st.max = s.value;
+                    } else {
+                        st.min = std::min(st.min, s.value);
+                        st.max = std::max(st.max, s.value);
+                    }
+                    st.count++;
+                    st.sum += static_cast<double>(s.value);
+                    return true;
+                }
+            };
+            return scan(from, to, aggregate{stats_type{0, 0.0, T(), T()}}).st;
+        }
+
+        /**
+         * @brief Aggregate the samples in the last window before the newest.
+         *
+         * @param window how far back from the newest sample's timestamp.
+         * @returns as for stats(from, to).
+         */
+        stats_type stats(std::chrono::nanoseconds window) const noexcept
+        {
+            int64_t newest = newest_timestamp();
+            return stats(newest - window.count(), newest);
+        }
+
+        /**
+         * @brief Find a percentile of the samples in [from, to].
+         *
+         * Uses the nearest rank, so the result is always one of the samples.
+         * The values are copied out to be selected from, since shared memory
+         * can't be reordered.
+         *
+         * @param from the oldest timestamp included.
+         * @param to the newest timestamp included.
+         * @param p the percentile, from 0 to 100.
+         * @param value set to the percentile if there were any samples.
+         * @returns false if the window is empty.
+         * @throws std::invalid_argument if p is out of range.
+         */
+        bool percentile(int64_t from, int64_t to, double p, T& value) const
+        {
+            if (!(p >= 0.0 && p <= 100.0))
+                throw std::invalid_argument("percentile must be from 0 to 100");
+
+            std::vector<T> values;
+            copy_values(from, to, values);
+            if (values.empty())
+                return false;
+
+            size_type rank = static_cast<size_type>(std::ceil(p / 100.0 * static_cast<double>(values.size())));
+            size_type k = rank == 0 ? 0 : rank - 1;
+            std::nth_element(values.begin(), values.begin() + static_cast<std::ptrdiff_t>(k), values.end());
+            value = values[k];
+            return true;
+        }
+
+        /**
+         * @brief Copy out the samples in [from, to], oldest first.
+         *
+         * @param from the oldest timestamp included.
+         * @param to the newest timestamp included.
+         * @param samples replaced with the samples.
+         * @returns the number of samples.
+         */
+        size_type copy(int64_t from, int64_t to, std::vector<sample_type>& samples) const
+        {
+            struct collect {
+                std::vector<sample_type>* out;
+                bool add(const sample_type& s)
+                {
+                    out->push_back(s);
+                    return true;
+                }
+            };
+            samples.clear();
+            scan(from, to, collect{&samples}, [&samples]() { samples.clear(); });
+            std::reverse(samples.begin(), samples.end());
+            return samples.size();
+        }
+
+        /** @returns the number of samples kept, at most capacity(). */
+        size_type size() const noexcept
+        {
+            return static_cast<size_type>(std::min<uint64_t>(mControl->head.load(std::memory_order_acquire), capacity()));
+        }
+
+        /** @returns the number of samples kept once the ring is full. */
+        size_type capacity() const noexcept
+        {
+            return mSlots - 1;
+        }
+
+        /** @returns the timestamp append(value) would use now. */
+        static int64_t now() noexcept
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now().time_since_epoch()).count();
+        }
+
+      private:
+        std::unique_ptr<shm_object> mObject;
+        time_series_control* mControl;
+        sample_type* mSamples;
+        size_type mSlots;
+
+        static size_type round_slots(size_type capacity) noexcept
+        {
+            size_type c = 2;
+            while (c < capacity)
+                c <<= 1;
+            return c;
+        }
+
+        static segment_layout make_layout(size_type slots) noexcept
+        {
+            uint64_t h = layout_hash<time_series_control>();
+            h = fnv1a_mix(h, layout_hash<sample_type>());
+            h = fnv1a_mix(h, slots);
+            return segment_layout{sizeof(time_series_control) + slots * sizeof(sample_type), 64, h};
+        }
+
+        int64_t newest_timestamp() const noexcept
+        {
+            sample_type s;
+            return latest(s) ? s.timestamp : 0;
+        }
+
+        void copy_values(int64_t from, int64_t to, std::vector<T>& values) const
+        {
+            struct collect {
+                std::vector<T>* out;
+                bool add(const sample_type& s)
+                {
+                    out->push_back(s.value);
+                    return true;
+                }
+            };
+            scan(from, to, collect{&values}, [&values]() { values.clear(); });
+        }
+
+        template <class Acc>
+        Acc scan(int64_t from, int64_t to, Acc init) const
+        {
+            return scan(from, to, init, []() {});
+        }
+
+        /**
+         * @brief Feed the samples in [from, to] to acc.add(), newest first.
+         *
+         * acc.add() returns false to stop early. If the writer laps a slot
+         * that was read, reset() is called and the pass starts over from a
+         * fresh copy of init.
+         */
+        template <class Acc, class Reset>
+        Acc scan(int64_t from, int64_t to, Acc init, Reset reset) const
+        {
+            for (;;) {
+                Acc acc = init;
+                const uint64_t head = mControl->head.load(std::memory_order_acquire);
+                /* Leave out the slot the writer may be filling in right now. */
+                const uint64_t lowest = head >= mSlots ? head - mSlots + 1 : 0;
+                uint64_t oldest = head;
+
+                for (uint64_t i = head; i > lowest; --i) {
+                    sample_type s;
+                    std::memcpy(&s, &mSamples[(i - 1) & (mSlots - 1)], sizeof(s));
+                    oldest = i - 1;
+                    if (s.timestamp > to)
+                        continue;
+                    if (s.timestamp < from || !acc.add(s))
+                        break;
+                }
+
+                std::atomic_thread_fence(std::memory_order_acquire);
+                const uint64_t now_head = mControl->head.load(std::memory_order_relaxed);
+                /* The writer may be overwriting sample now_head - slots. */
+                if (oldest + mSlots > now_head)
+                    return acc;
+                reset();
+            }
+        }
+    };
+
+} // namespace pshm
+
+#endif // PSHM_SHM_TIME_SERIES__HPP
@@ -0,0 +1,184 @@
+#ifndef PSHM_SHM_TRIPLE_BUFFER__HPP
+#define PSHM_SHM_TRIPLE_BUFFER__HPP
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include <pshm/config.hpp>
+#include <pshm/shm_object_native.hpp>
+#include <pshm/stdcpp.hpp>
+
+namespace pshm
+{
+    /**
+     * @brief Control block of a shm_triple_buffer.
+     *
+     * The three slots are always split between the writer (back), the reader
+     * (front) and whoever gets to exchange middle next. back and front are
+     * stored XOR'd with their initial values so that a freshly truncated
+     * segment starts out as back = 1, middle = 0 and front = 2. Keeping them in
+     * the segment lets a restarted writer or reader carry on where it left
+     * off.
+     */
+    struct triple_buffer_control {
+        /** Set in middle when it holds a frame the reader hasn't seen. */
+        static constexpr uint32_t FRESH = 4;
+
+        /** Slot index, possibly with FRESH. */
+        std::atomic<uint32_t> middle;
+        uint8_t pad0[60];
+
+        /** Writer's slot XOR 1. Only touched by the writer. */
+        uint32_t back;
+        uint8_t pad1[60];
+
+        /** Reader's slot XOR 2. Only touched by the reader. */
+        uint32_t front;
+        uint8_t pad2[60];
+    };
+
+    /**
+     * @brief Latest value channel for large objects in shared memory.
+     *
+     * Three copies of T share one segment: the writer fills one, the reader
+     * holds another, and the third is handed between them with a single atomic
+     * exchange. The writer never blocks and the reader gets a reference to a
+     * complete frame that stays put until its next read(), so nothing is ever
+     * copied. Frames published between two reads are skipped: the reader only
+     * ever sees the newest.
+     *
+     * There must be at most one writer and one reader at a time.
+     *
+     * @tparam T the frame type. Must be a trivial type, see shm_ptr.
+     */
+    template <class T, typename std::enable_if_t<std::is_trivial<T>::value, T>* = nullptr>
+    class shm_triple_buffer
+    {
+      public:
+        using element_type = T;
+        using flags_type = shm_object::flags_type;
+        using size_type = shm_object::size_type;
+        using string_type = shm_object::string_type;
+        using shm_object_type = pshm::shm_object_native;
+
+        /**
+         * @brief Open a triple buffer.
+         *
+         * @param name two objects with the same name refer to the same object
+         * in shared memory. For portability this should begin with '/' on unix
+         * platforms.
+         *
+         * @param flags the file control flags. flags::HEADER is implied, so a
+         * T of the wrong size fails to attach.
+         *
+         * @see pshm::flags.
+         * @see pshm::shm_ptr.
+         */
+        shm_triple_buffer(const string_type& name, flags_type flags)
+            : mObject(make_shm_object(name, flags | pshm::flags::HEADER, layout().size, 0, layout()))
+        {
+            uint8_t* base = static_cast<uint8_t*>(mObject->get());
+            mControl = reinterpret_cast<triple_buffer_control*>(base);
+            mSlots = base + slots_offset();
+        }
+
+        /**
+         * @brief Open a triple buffer.
+         *
+         * Equivalent to shm_triple_buffer(name, flags) where flags is set to
+         * read, write, create.
+         *
+         * @param name two objects with the same name refer to the same object
+         * in shared memory. For portability this should begin with '/' on unix
+         * platforms.
+         */
+        explicit shm_triple_buffer(const string_type& name)
+            : shm_triple_buffer(name, flags::RDWR | flags::CREAT)
+        {
+        }
+
+        /**
+         * @brief The writer's frame.
+         *
+         * Fill this in then call publish(). The reader can't see it until then.
+         *
+         * @returns the writer's slot.
+         */
+        T& write_buffer() noexcept
+        {
+            return slot(mControl->back ^ 1);
+        }
+
+        /**
+         * @brief Hand the writer's frame over to the reader.
+         *
+         * Never blocks. Afterwards write_buffer() refers to a different slot
+         * with stale contents.
+         */
+        void publish() noexcept
+        {
+            uint32_t back = mControl->back ^ 1;
+            uint32_t old = mControl->middle.exchange(back | triple_buffer_control::FRESH, std::memory_order_acq_rel);
+            mControl->back = (old & 3) ^ 1;
+        }
+
+        /**
+         * @returns true if a frame newer than read_buffer() has been published.
+         */
+        bool fresh() const noexcept
+        {
+            return (mControl->middle.load(std::memory_order_acquire) & triple_buffer_control::FRESH) != 0;
+        }
+
+        /**
+         * @brief Get the newest frame.
+         *
+         * @returns the newest published frame, or the same frame as last time
+         * if nothing new has been published. The reference stays valid and
+         * unchanging until the next call to read().
+         */
+        const T& read() noexcept
+        {
+            if (fresh()) {
+                uint32_t front = mControl->front ^ 2;
+                uint32_t old = mControl->middle.exchange(front, std::memory_order_acq_rel);
+                mControl->front = (old & 3) ^ 2;
+            }
+            return read_buffer();
+        }
+
+        /**
+         * @returns the frame returned by the last read().
+         */
+        const T& read_buffer() const noexcept
+        {
+            return slot(mControl->front ^ 2);
+        }
+
+      private:
+        std::unique_ptr<shm_object> mObject;
+        triple_buffer_control* mControl;
+        uint8_t* mSlots;
+
+        /** Slots start on cache lines so the writer and reader don't share any. */
+        static constexpr size_type slot_alignment = alignof(T) > 64 ? alignof(T) : 64;
+        static constexpr size_type slot_stride = (sizeof(T) + slot_alignment - 1) / slot_alignment * slot_alignment;
+
+        static constexpr size_type slots_offset() noexcept
+        {
+            return (sizeof(triple_buffer_control) + slot_alignment - 1) / slot_alignment * slot_alignment;
+        }
+
+        static constexpr segment_layout layout() noexcept
+        {
+            return segment_layout{slots_offset() + 3 * slot_stride, slot_alignment, fnv1a_mix(layout_hash<T>(), layout_hash<triple_buffer_control>())};
+        }
+
+        T& slot(uint32_t i) const noexcept
+        {
+            return *reinterpret_cast<T*>(mSlots + i * slot_stride);
+        }
+    };
+
+} // namespace pshm
+
+#endif // PSHM_SHM_TRIPLE_BUFFER__HPP
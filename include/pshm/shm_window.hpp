@@ -0,0 +1,118 @@
+#ifndef PSHM_SHM_WINDOW__HPP
+#define PSHM_SHM_WINDOW__HPP
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include <pshm/config.hpp>
+#include <pshm/flags.hpp>
+#include <pshm/pshm_export.hpp>
+#include <pshm/stdcpp.hpp>
+
+namespace pshm
+{
+    /**
+     * @brief A fixed size view that slides over a large shared memory object.
+     *
+     * Only one window of the object is mapped at a time, so objects far
+     * larger than the address space or page table budget can be scanned.
+     * With prefetching on, a background thread maps the next window and
+     * populates its page tables while the current one is being read, then
+     * unmaps the old one after the slide. A sequential scan then never
+     * waits on mmap(), munmap() or page faults.
+     *
+     * At most two windows are mapped at once.
+     */
+    class PSHM_EXPORT shm_window
+    {
+      public:
+        using flags_type = pshm::flags_t;
+        using size_type = size_t;
+        using string_type = std::string;
+
+        /**
+         * @brief Open an existing object and map its first window.
+         *
+         * @param name the shared memory object name.
+         *
+         * @param flags flags::RDONLY or flags::RDWR.
+         *
+         * @param window_size bytes per window. Must be a multiple of the page
+         * size.
+         *
+         * @param prefetch map the next window in the background.
+         *
+         * @throws std::invalid_argument if window_size isn't a multiple of
+         * the page size.
+         * @throws std::runtime_error if the object can't be opened or mapped.
+         */
+        shm_window(const string_type& name, flags_type flags, size_type window_size, bool prefetch = true);
+
+        /**
+         * @brief Unmap the window and stop prefetching.
+         */
+        ~shm_window();
+
+        shm_window(const shm_window&) = delete;
+        shm_window& operator=(const shm_window&) = delete;
+
+        /**
+         * @brief Move the window to start at offset.
+         *
+         * @param offset where the window starts in the object. Must be a
+         * multiple of the page size.
+         * @returns false if offset is at or past the end of the object.
+         * @throws std::invalid_argument if offset isn't page aligned.
+         * @throws std::runtime_error if the window can't be mapped.
+         */
+        bool seek(uint64_t offset);
+
+        /**
+         * @brief Move to the next window.
+         *
+         * @returns false once the end of the object is reached.
+         * @throws std::runtime_error if the window can't be mapped.
+         */
+        bool advance();
+
+        /** @returns the window, or nullptr past the end. */
+        void* data() const noexcept;
+
+        /** @returns the bytes in this window. The last one may be short. */
+        size_type size() const noexcept;
+
+        /** @returns where the window starts in the object. */
+        uint64_t offset() const noexcept;
+
+        /** @returns the size of the object when it was opened. */
+        uint64_t object_size() const noexcept;
+
+        /** @returns the configured window size. */
+        size_type window_size() const noexcept;
+
+        /** @returns the name of the object. */
+        string_type name() const;
+
+      private:
+        struct mapping {
+            void* address;
+            size_type length;
+            uint64_t offset;
+        };
+
+        class prefetcher;
+
+        string_type mName;
+        int mFile;
+        int mProt;
+        uint64_t mObjectSize;
+        size_type mWindowSize;
+        mapping mCurrent;
+        std::unique_ptr<prefetcher> mPrefetcher;
+
+        mapping map_window(uint64_t offset) const;
+        void unmap_window(mapping& m) const noexcept;
+    };
+
+} // namespace pshm
+
+#endif // PSHM_SHM_WINDOW__HPP
@@ -7,6 +7,8 @@
  * Standard library headers suitable for use with pshm. C++ 14 required.
  */
 
+#include <atomic>
+#include <cstdint>
 #include <functional>
 #include <iomanip>
 #include <ios>
@@ -18,5 +20,6 @@
 #include <string>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
 #endif // PSHM_STDCPP__HPP
\ No newline at end of file
@@ -0,0 +1,285 @@
+#ifndef PSHM_WAIT_STRATEGY__HPP
+#define PSHM_WAIT_STRATEGY__HPP
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include <pshm/config.hpp>
+#include <pshm/cpu_relax.hpp>
+#include <pshm/futex.hpp>
+#include <pshm/shm_doorbell.hpp>
+#include <pshm/stdcpp.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+namespace pshm
+{
+    /**
+     * @brief What a wait strategy has done so far.
+     */
+    struct wait_stats {
+        /** Predicate checks separated by cpu_relax(). */
+        uint64_t spins;
+        /** Times the thread gave up its time slice. */
+        uint64_t yields;
+        /** Times the thread went to sleep, on a futex or a timer. */
+        uint64_t parks;
+    };
+
+    /**
+     * @brief Counters shared by the built in wait strategies.
+     *
+     * A strategy object belongs to one waiting thread, so the counters are
+     * plain integers. Read them with stats() to tune spin budgets.
+     *
+     * Every strategy provides:
+     *
+     *     static constexpr bool parks;   // sleeps on the doorbell
+     *     template <class Ready> void wait(shm_doorbell&, Ready);
+     *     template <class Ready> bool wait_for(shm_doorbell&, Ready, std::chrono::nanoseconds);
+     *
+     * Only strategies with parks set mark themselves asleep in the doorbell,
+     * so only they make producers do a system call, and only they need the
+     * channel opened with flags::RDWR.
+     */
+    class wait_strategy_base
+    {
+      public:
+        /** @returns the counters. */
+        wait_stats stats() const noexcept
+        {
+            return mStats;
+        }
+
+        /** @brief Zero the counters. */
+        void reset_stats() noexcept
+        {
+            mStats = wait_stats{0, 0, 0};
+        }
+
+      protected:
+        wait_stats mStats{0, 0, 0};
+
+        /** Only look at the clock this often while spinning. */
+        static constexpr uint32_t clock_interval = 64;
+    };
+
+    /**
+     * @brief Spin with cpu_relax() until ready. Never yields or sleeps.
+     *
+     * For threads pinned to their own cores where wake up latency matters
+     * more than CPU time.
+     */
+    class busy_spin : public wait_strategy_base
+    {
+      public:
+        static constexpr bool parks = false;
+
+        template <class Ready>
+        void wait(shm_doorbell&, Ready ready)
+        {
+            while (!ready()) {
+                cpu_relax();
+                mStats.spins++;
+            }
+        }
+
+        template <class Ready>
+        bool wait_for(shm_doorbell&, Ready ready, std::chrono::nanoseconds timeout)
+        {
+            auto deadline = std::chrono::steady_clock::now() + timeout;
+            for (uint32_t i = 1; !ready(); ++i) {
+                cpu_relax();
+                mStats.spins++;
+                if (i % clock_interval == 0 && std::chrono::steady_clock::now() >= deadline)
+                    return ready();
+            }
+            return true;
+        }
+    };
+
+    /**
+     * @brief Spin for a while, then keep yielding until ready.
+     *
+     * Frees the core for other runnable threads without ever sleeping.
+     */
+    class spin_yield : public wait_strategy_base
+    {
+      public:
+        static constexpr bool parks = false;
+
+        /**
+         * @param spin_budget predicate checks to spin for before yielding.
+         */
+        explicit spin_yield(uint32_t spin_budget = 100) noexcept
+            : mBudget(spin_budget)
+        {
+        }
+
+        template <class Ready>
+        void wait(shm_doorbell&, Ready ready)
+        {
+            for (uint32_t i = 0; !ready(); ++i)
+                pause(i);
+        }
+
+        template <class Ready>
+        bool wait_for(shm_doorbell&, Ready ready, std::chrono::nanoseconds timeout)
+        {
+            auto deadline = std::chrono::steady_clock::now() + timeout;
+            for (uint32_t i = 0; !ready(); ++i) {
+                pause(i);
+                if ((i >= mBudget || i % clock_interval == 0) && std::chrono::steady_clock::now() >= deadline)
+                    return ready();
+            }
+            return true;
+        }
+
+      private:
+        uint32_t mBudget;
+
+        void pause(uint32_t i) noexcept
+        {
+            if (i < mBudget) {
+                cpu_relax();
+                mStats.spins++;
+            } else {
+                std::this_thread::yield();
+                mStats.yields++;
+            }
+        }
+    };
+
+    /**
+     * @brief Spin for a while, then sleep on the doorbell's futex.
+     *
+     * The usual choice: cheap when the wait is short, and no CPU burned when
+     * it isn't. Producers only pay for a wake up once the budget runs out.
+     */
+    class spin_park : public wait_strategy_base
+    {
+      public:
+        static constexpr bool parks = true;
+
+        /**
+         * @param spin_budget predicate checks to spin for before parking.
+         */
+        explicit spin_park(uint32_t spin_budget = 1000) noexcept
+            : mBudget(spin_budget)
+        {
+        }
+
+        template <class Ready>
+        void wait(shm_doorbell& bell, Ready ready)
+        {
+            for (uint32_t i = 0; !ready(); ++i) {
+                if (i < mBudget) {
+                    cpu_relax();
+                    mStats.spins++;
+                    continue;
+                }
+                std::atomic<uint32_t>& word = bell.state()->sequence;
+                uint32_t seen = word.load(std::memory_order_acquire);
+                bell.prepare_sleep();
+                if (!ready()) {
+                    futex_wait(word, seen);
+                    mStats.parks++;
+                }
+                bell.finish_sleep();
+            }
+        }
+
+        template <class Ready>
+        bool wait_for(shm_doorbell& bell, Ready ready, std::chrono::nanoseconds timeout)
+        {
+            auto deadline = std::chrono::steady_clock::now() + timeout;
+            for (uint32_t i = 0; !ready(); ++i) {
+                if (i < mBudget) {
+                    cpu_relax();
+                    mStats.spins++;
+                    if (i % clock_interval == 0 && std::chrono::steady_clock::now() >= deadline)
+                        return ready();
+                    continue;
+                }
+                auto left = deadline - std::chrono::steady_clock::now();
+                if (left <= std::chrono::nanoseconds::zero())
+                    return ready();
+                std::atomic<uint32_t>& word = bell.state()->sequence;
+                uint32_t seen = word.load(std::memory_order_acquire);
+                bell.prepare_sleep();
+                if (!ready()) {
+                    futex_wait_for(word, seen, left);
+                    mStats.parks++;
+                }
+                bell.finish_sleep();
+            }
+            return true;
+        }
+
+      private:
+        uint32_t mBudget;
+    };
+
+    /**
+     * @brief Spin for a while, then poll with exponentially growing sleeps.
+     *
+     * Never touches the doorbell, so producers never make a system call on
+     * its behalf. Wake up latency is up to max_delay.
+     */
+    class timed_backoff : public wait_strategy_base
+    {
+      public:
+        static constexpr bool parks = false;
+
+        /**
+         * @param spin_budget predicate checks to spin for before sleeping.
+         * @param min_delay the first sleep.
+         * @param max_delay sleeps double up to this.
+         */
+        explicit timed_backoff(uint32_t spin_budget = 100,
+                               std::chrono::nanoseconds min_delay = std::chrono::microseconds(1),
+                               std::chrono::nanoseconds max_delay = std::chrono::milliseconds(1)) noexcept
+            : mBudget(spin_budget)
+            , mMinDelay(min_delay)
+            , mMaxDelay(max_delay)
+        {
+        }
+
+        template <class Ready>
+        void wait(shm_doorbell& bell, Ready ready)
+        {
+            wait_for(bell, ready, std::chrono::nanoseconds::max());
+        }
+
+        template <class Ready>
+        bool wait_for(shm_doorbell&, Ready ready, std::chrono::nanoseconds timeout)
+        {
+            auto start = std::chrono::steady_clock::now();
+            auto delay = mMinDelay;
+            for (uint32_t i = 0; !ready(); ++i) {
+                if (i < mBudget) {
+                    cpu_relax();
+                    mStats.spins++;
+                    continue;
+                }
+                auto elapsed = std::chrono::steady_clock::now() - start;
+                if (elapsed >= timeout)
+                    return ready();
+                std::this_thread::sleep_for(std::min<std::chrono::nanoseconds>(delay, timeout - elapsed));
+                mStats.parks++;
+                if (delay < mMaxDelay)
+                    delay = std::min(delay * 2, mMaxDelay);
+            }
+            return true;
+        }
+
+      private:
+        uint32_t mBudget;
+        std::chrono::nanoseconds mMinDelay;
+        std::chrono::nanoseconds mMaxDelay;
+    };
+
+} // namespace pshm
+
+#endif // PSHM_WAIT_STRATEGY__HPP
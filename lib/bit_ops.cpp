@@ -0,0 +1,195 @@
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include <pshm/bit_ops.hpp>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define PSHM_BIT_OPS_X86 1
+#else
+#define PSHM_BIT_OPS_X86 0
+#endif
+
+namespace
+{
+    using popcount_fn = size_t (*)(const uint64_t*, size_t);
+    /** Tells whether merging a chunk of words could change dst. */
+    using changes_fn = bool (*)(const uint64_t* dst, const uint64_t* src);
+
+    /** Words per chunk checked by a changes_fn. */
+    constexpr size_t chunk_words = 8;
+
+    struct kernels {
+        popcount_fn popcount;
+        changes_fn or_changes;
+        changes_fn and_changes;
+        const char* isa;
+    };
+
+    size_t popcount_generic(const uint64_t* words, size_t n)
+    {
+        size_t count = 0;
+        for (size_t i = 0; i < n; ++i) {
+            uint64_t w = words[i];
+            w = w - ((w >> 1) & 0x5555555555555555ull);
+            w = (w & 0x3333333333333333ull) + ((w >> 2) & 0x3333333333333333ull);
+            w = (w + (w >> 4)) & 0x0f0f0f0f0f0f0f0full;
+            count += static_cast<size_t>((w * 0x0101010101010101ull) >> 56);
+        }
+        return count;
+    }
+
+    bool or_changes_generic(const uint64_t* dst, const uint64_t* src)
+    {
+        uint64_t missing = 0;
+        for (size_t i = 0; i < chunk_words; ++i)
+            missing |= src[i] & ~dst[i];
+        return missing != 0;
+    }
+
+    bool and_changes_generic(const uint64_t* dst, const uint64_t* src)
+    {
+        uint64_t extra = 0;
+        for (size_t i = 0; i < chunk_words; ++i)
+            extra |= dst[i] & ~src[i];
+        return extra != 0;
+    }
+
+#if PSHM_BIT_OPS_X86
+    __attribute__((target("popcnt"))) size_t popcount_popcnt(const uint64_t* words, size_t n)
+    {
+        /* Independent sums so the popcnt latency overlaps. */
+        uint64_t c0 = 0, c1 = 0, c2 = 0, c3 = 0;
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            c0 += static_cast<uint64_t>(_mm_popcnt_u64(words[i]));
+            c1 += static_cast<uint64_t>(_mm_popcnt_u64(words[i + 1]));
+            c2 += static_cast<uint64_t>(_mm_popcnt_u64(words[i + 2]));
+            c3 += static_cast<uint64_t>(_mm_popcnt_u64(words[i + 3]));
+        }
+        for (; i < n; ++i)
+            c0 += static_cast<uint64_t>(_mm_popcnt_u64(words[i]));
+        return static_cast<size_t>(c0 + c1 + c2 + c3);
+    }
+
+    __attribute__((target("avx512f,avx512vpopcntdq"))) size_t popcount_avx512(const uint64_t* words, size_t n)
+    {
+        __m512i sum = _mm512_setzero_si512();
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+            sum = _mm512_add_epi64(sum, _mm512_popcnt_epi64(_mm512_loadu_si512(words + i)));
+        size_t count = static_cast<size_t>(_mm512_reduce_add_epi64(sum));
+        for (; i < n; ++i)
+            count += static_cast<size_t>(__builtin_popcountll(words[i]));
+        return count;
+    }
+
+    __attribute__((target("avx2"))) bool or_changes_avx2(const uint64_t* dst, const uint64_t* src)
+    {
+        const __m256i* d = reinterpret_cast<const __m256i*>(dst);
+        const __m256i* s = reinterpret_cast<const __m256i*>(src);
+        /* testc(a, b) is set when b has no bits outside a. */
+        return !(_mm256_testc_si256(_mm256_loadu_si256(d), _mm256_loadu_si256(s)) &
+                 _mm256_testc_si256(_mm256_loadu_si256(d + 1), _mm256_loadu_si256(s + 1)));
+    }
+
+    __attribute__((target("avx2"))) bool and_changes_avx2(const uint64_t* dst, const uint64_t* src)
+    {
+        const __m256i* d = reinterpret_cast<const __m256i*>(dst);
+        const __m256i* s = reinterpret_cast<const __m256i*>(src);
+        return !(_mm256_testc_si256(_mm256_loadu_si256(s), _mm256_loadu_si256(d)) &
+                 _mm256_testc_si256(_mm256_loadu_si256(s + 1), _mm256_loadu_si256(d + 1)));
+    }
+#endif
+
+    kernels select_kernels() noexcept
+    {
+        kernels k{popcount_generic, or_changes_generic, and_changes_generic, "generic"};
+#if PSHM_BIT_OPS_X86
+        __builtin_cpu_init();
+        /* isa names the widest instruction set in use. */
+        if (__builtin_cpu_supports("popcnt")) {
+            k.popcount = popcount_popcnt;
+            k.isa = "popcnt";
+        }
+        if (__builtin_cpu_supports("avx2")) {
+            k.or_changes = or_changes_avx2;
+            k.and_changes = and_changes_avx2;
+            k.isa = "avx2";
+        }
+        if (__builtin_cpu_supports("avx512vpopcntdq")) {
+            k.popcount = popcount_avx512;
+            k.isa = "avx512vpopcntdq";
+        }
+#endif
+        return k;
+    }
+
+    const kernels& selected() noexcept
+    {
+        static const kernels k = select_kernels();
+        return k;
+    }
+
+    /**
+     * @brief Shared body of atomic_or_words() and atomic_and_words().
+     */
+    template <class Apply>
+    size_t merge(std::atomic<uint64_t>* dst, const uint64_t* src, size_t n, changes_fn changes, Apply apply) noexcept
+    {
+        static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t), "words must be plain words");
+        /* A racy peek: the atomics below make the real change. */
+        const uint64_t* peek = reinterpret_cast<const uint64_t*>(dst);
+        size_t changed = 0;
+        size_t i = 0;
+        for (; i + chunk_words <= n; i += chunk_words) {
+            if (changes(peek + i, src + i))
+                changed += apply(dst + i, src + i, chunk_words);
+        }
+        return changed + apply(dst + i, src + i, n - i);
+    }
+} // namespace
+
+namespace pshm
+{
+    size_t popcount_words(const uint64_t* words, size_t n) noexcept
+    {
+        return selected().popcount(words, n);
+    }
+
+    size_t atomic_or_words(std::atomic<uint64_t>* dst, const uint64_t* src, size_t n) noexcept
+    {
+        return merge(dst, src, n, selected().or_changes, [](std::atomic<uint64_t>* d, const uint64_t* s, size_t count) {
+            size_t changed = 0;
+            for (size_t i = 0; i < count; ++i) {
+                if ((s[i] & ~d[i].load(std::memory_order_relaxed)) == 0)
+                    continue;
+                uint64_t old = d[i].fetch_or(s[i], std::memory_order_relaxed);
+                if ((s[i] & ~old) != 0)
+                    changed++;
+            }
+            return changed;
+        });
+    }
+
+    size_t atomic_and_words(std::atomic<uint64_t>* dst, const uint64_t* src, size_t n) noexcept
+    {
+        return merge(dst, src, n, selected().and_changes, [](std::atomic<uint64_t>* d, const uint64_t* s, size_t count) {
+            size_t changed = 0;
+            for (size_t i = 0; i < count; ++i) {
+                if ((d[i].load(std::memory_order_relaxed) & ~s[i]) == 0)
+                    continue;
+                uint64_t old = d[i].fetch_and(s[i], std::memory_order_relaxed);
+                if ((old & ~s[i]) != 0)
+                    changed++;
+            }
+            return changed;
+        });
+    }
+
+    const char* bit_ops_isa() noexcept
+    {
+        return selected().isa;
+    }
+
+} // namespace pshm
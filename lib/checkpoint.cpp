@@ -0,0 +1,339 @@
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include <pshm/checkpoint.hpp>
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <sys/sendfile.h>
+#endif
+
+using std::runtime_error;
+using std::string;
+
+namespace
+{
+    string make_error(const string& msg, const string& path, int error)
+    {
+        return msg + ": " + path + ": " + std::strerror(error);
+    }
+
+    constexpr uint64_t prime1 = 0x9e3779b185ebca87ull;
+    constexpr uint64_t prime2 = 0xc2b2ae3d27d4eb4full;
+    constexpr uint64_t prime3 = 0x165667b19e3779f9ull;
+    constexpr uint64_t prime4 = 0x85ebca77c2b2ae63ull;
+    constexpr uint64_t prime5 = 0x27d4eb2f165667c5ull;
+
+    constexpr uint64_t rotl(uint64_t x, int r) noexcept
+    {
+        return (x << r) | (x >> (64 - r));
+    }
+
+    inline uint64_t round(uint64_t acc, uint64_t input) noexcept
+    {
+        return rotl(acc + input * prime2, 31) * prime1;
+    }
+
+    inline uint64_t merge(uint64_t acc, uint64_t lane) noexcept
+    {
+        return (acc ^ round(0, lane)) * prime1 + prime4;
+    }
+
+    inline uint64_t load64(const uint8_t* p) noexcept
+    {
+        uint64_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    /** Chunks for the fallback copies. A multiple of any block size. */
+    constexpr size_t chunk_size = 8 * 1024 * 1024;
+
+    /** O_DIRECT needs the buffer, file offset and length block aligned. */
+    constexpr size_t direct_alignment = 4096;
+
+    /**
+     * @brief Is errno one that means "use something else" on the first call?
+     */
+    bool unsupported(int error)
+    {
+        return error == EXDEV || error == EINVAL || error == ENOSYS || error == EOPNOTSUPP;
+    }
+
+    /**
+     * @brief Copy between two descriptors without going through user space.
+     *
+     * @returns false if the kernel can't do it for these files and nothing
+     * was copied.
+     * @throws runtime_error on other errors.
+     */
+    bool kernel_copy(const string& path, int in, uint64_t in_offset, int out, uint64_t out_offset, size_t length)
+    {
+#if defined(__linux__)
+        loff_t i = static_cast<loff_t>(in_offset);
+        loff_t o = static_cast<loff_t>(out_offset);
+        size_t left = length;
+        while (left > 0) {
+            ssize_t n = ::copy_file_range(in, &i, out, &o, left, 0);
+            if (n > 0) {
+                left -= static_cast<size_t>(n);
+                continue;
+            }
+            if (n == 0)
+                throw runtime_error("copy_file_range() ran out of data: " + path);
+            if (errno == EINTR)
+                continue;
+            if (left == length && unsupported(errno))
+                break;
+            throw runtime_error(make_error("copy_file_range() failed", path, errno));
+        }
+        if (left == 0)
+            return true;
+
+        if (::lseek(out, static_cast<off_t>(out_offset), SEEK_SET) == -1)
+            throw runtime_error(make_error("lseek() failed", path, errno));
+        off_t s = static_cast<off_t>(in_offset);
+        while (left > 0) {
+            ssize_t n = ::sendfile(out, in, &s, std::min<size_t>(left, 0x7ffff000));
+            if (n > 0) {
+                left -= static_cast<size_t>(n);
+                continue;
+            }
+            if (n == 0)
+                throw runtime_error("sendfile() ran out of data: " + path);
+            if (errno == EINTR)
+                continue;
+            if (left == length && unsupported(errno))
+                return false;
+            throw runtime_error(make_error("sendfile() failed", path, errno));
+        }
+        return true;
+#else
+        (void)path;
+        (void)in;
+        (void)in_offset;
+        (void)out;
+        (void)out_offset;
+        (void)length;
+        return false;
+#endif
+    }
+
+    /**
+     * @brief Open path again with O_DIRECT if buffer allows it.
+     *
+     * @returns the descriptor or -1.
+     */
+    int open_direct(const string& path, int flags, const void* buffer)
+    {
+#if defined(O_DIRECT)
+        if (reinterpret_cast<uintptr_t>(buffer) % direct_alignment == 0)
+            return ::open(path.c_str(), flags | O_DIRECT | O_CLOEXEC);
+#else
+        (void)path;
+        (void)flags;
+        (void)buffer;
+#endif
+        return -1;
+    }
+
+    /**
+     * @brief pwrite() or pread() the whole range, a chunk at a time.
+     *
+     * The block aligned part goes through direct if it's open, the rest
+     * through fd.
+     */
+    template <class IO>
+    void chunked(const string& path, const char* what, IO io, int fd, int direct, uint8_t* buffer, uint64_t offset, size_t length)
+    {
+        size_t done = 0;
+        size_t aligned = direct == -1 ? 0 : length / direct_alignment * direct_alignment;
+        while (done < length) {
+            int target = done < aligned ? direct : fd;
+            size_t want = std::min(chunk_size, (done < aligned ? aligned : length) - done);
+            ssize_t n = io(target, buffer + done, want, static_cast<off_t>(offset + done));
+            if (n > 0) {
+                done += static_cast<size_t>(n);
+                continue;
+            }
+            if (n == -1 && errno == EINTR)
+                continue;
+            throw runtime_error(make_error(string(what) + " failed", path, n == 0 ? EIO : errno));
+        }
+    }
+
+    /**
+     * @brief Close fd when leaving scope.
+     */
+    struct fd_closer {
+        int fd;
+        ~fd_closer()
+        {
+            if (fd != -1)
+                ::close(fd);
+        }
+    };
+
+    /**
+     * @brief Checksum a checkpoint's data without touching the object.
+     *
+     * Maps the file read only so a corrupt checkpoint is caught before
+     * anything is copied out of it.
+     */
+    uint64_t file_checksum(const string& path, int fd, uint64_t data_offset, size_t length)
+    {
+        if (length == 0)
+            return pshm::checksum64(nullptr, 0);
+
+        size_t size = static_cast<size_t>(data_offset) + length;
+        void* p = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED)
+            throw runtime_error(make_error("mmap() failed", path, errno));
+        ::madvise(p, size, MADV_SEQUENTIAL);
+        uint64_t sum = pshm::checksum64(static_cast<const uint8_t*>(p) + data_offset, length);
+        ::munmap(p, size);
+        return sum;
+    }
+
+    /**
+     * @brief Flush the directory entry of path, so a rename() survives a crash.
+     */
+    void sync_directory(const string& path)
+    {
+        size_t slash = path.find_last_of('/');
+        string dir = slash == string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+        fd_closer d{::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC)};
+        if (d.fd == -1)
+            throw runtime_error(make_error("open() failed", dir, errno));
+        if (::fsync(d.fd) != 0)
+            throw runtime_error(make_error("fsync() failed", dir, errno));
+    }
+} // namespace
+
+namespace pshm
+{
+    constexpr uint32_t checkpoint_header::MAGIC;
+    constexpr uint32_t checkpoint_header::VERSION;
+    constexpr uint64_t checkpoint_header::DATA_OFFSET;
+
+    uint64_t checksum64(const void* data, size_t length) noexcept
+    {
+        /* XXH64's structure, seeded with 0. */
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        const uint8_t* end = p + length;
+        uint64_t h;
+
+        if (length >= 32) {
+            uint64_t v1 = prime1 + prime2;
+            uint64_t v2 = prime2;
+            uint64_t v3 = 0;
+            uint64_t v4 = 0 - prime1;
+            const uint8_t* limit = end - 32;
+            do {
+                v1 = round(v1, load64(p));
+                v2 = round(v2, load64(p + 8));
+                v3 = round(v3, load64(p + 16));
+                v4 = round(v4, load64(p + 24));
+                p += 32;
+            } while (p <= limit);
+            h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+            h = merge(h, v1);
+            h = merge(h, v2);
+            h = merge(h, v3);
+            h = merge(h, v4);
+        } else {
+            h = prime5;
+        }
+
+        h += length;
+        for (; p + 8 <= end; p += 8)
+            h = rotl(h ^ round(0, load64(p)), 27) * prime1 + prime4;
+        for (; p < end; ++p)
+            h = rotl(h ^ (*p * prime5), 11) * prime1;
+
+        h ^= h >> 33;
+        h *= prime2;
+        h ^= h >> 29;
+        h *= prime3;
+        h ^= h >> 32;
+        return h;
+    }
+
+    void write_checkpoint(const string& path, int fd, uint64_t fd_offset, const void* data, size_t length, uint64_t layout_hash)
+    {
+        /* Unique, so concurrent checkpoints to path never rename each other's file. */
+        string tmp = path + ".XXXXXX";
+        fd_closer out{::mkstemp(&tmp[0])};
+        if (out.fd == -1)
+            throw runtime_error(make_error("mkstemp() failed", tmp, errno));
+        ::fcntl(out.fd, F_SETFD, FD_CLOEXEC);
+
+        try {
+            checkpoint_header h;
+            std::memset(&h, 0, sizeof(h));
+            h.magic = checkpoint_header::MAGIC;
+            h.version = checkpoint_header::VERSION;
+            h.data_offset = checkpoint_header::DATA_OFFSET;
+            h.length = length;
+            h.checksum = checksum64(data, length);
+            h.layout_hash = layout_hash;
+
+            if (!kernel_copy(tmp, fd, fd_offset, out.fd, h.data_offset, length)) {
+                fd_closer direct{open_direct(tmp, O_WRONLY, data)};
+                chunked(tmp, "pwrite()", ::pwrite, out.fd, direct.fd, static_cast<uint8_t*>(const_cast<void*>(data)), h.data_offset, length);
+            }
+
+            if (::pwrite(out.fd, &h, sizeof(h), 0) != static_cast<ssize_t>(sizeof(h)))
+                throw runtime_error(make_error("pwrite() failed", tmp, errno));
+            if (::fsync(out.fd) != 0)
+                throw runtime_error(make_error("fsync() failed", tmp, errno));
+            if (::rename(tmp.c_str(), path.c_str()) != 0)
+                throw runtime_error(make_error("rename() failed", path, errno));
+        } catch (...) {
+            ::unlink(tmp.c_str());
+            throw;
+        }
+        sync_directory(path);
+    }
+
+    void read_checkpoint(const string& path, int fd, uint64_t fd_offset, void* data, size_t length, uint64_t layout_hash)
+    {
+        fd_closer in{::open(path.c_str(), O_RDONLY | O_CLOEXEC)};
+        if (in.fd == -1)
+            throw runtime_error(make_error("open() failed", path, errno));
+
+        checkpoint_header h;
+        if (::pread(in.fd, &h, sizeof(h), 0) != static_cast<ssize_t>(sizeof(h)))
+            throw runtime_error("checkpoint is too small to have a header: " + path);
+
+        string problem;
+        struct stat st;
+        if (h.magic != checkpoint_header::MAGIC)
+            problem = "bad checkpoint_header::magic";
+        else if (h.version != checkpoint_header::VERSION)
+            problem = "checkpoint_header::version is " + std::to_string(h.version) + " but " + std::to_string(checkpoint_header::VERSION) + " was expected";
+        else if (h.length != length)
+            problem = "checkpoint holds " + std::to_string(h.length) + " bytes but the object has " + std::to_string(length);
+        else if (h.layout_hash != layout_hash)
+            problem = "layout hash doesn't match";
+        else if (::fstat(in.fd, &st) != 0 || static_cast<uint64_t>(st.st_size) < h.data_offset + h.length)
+            problem = "checkpoint is truncated";
+        else if (file_checksum(path, in.fd, h.data_offset, length) != h.checksum)
+            problem = "checkpoint checksum doesn't match";
+        if (!problem.empty())
+            throw runtime_error(problem + ": " + path);
+
+        if (!kernel_copy(path, in.fd, h.data_offset, fd, fd_offset, length)) {
+            fd_closer direct{h.data_offset % direct_alignment == 0 ? open_direct(path, O_RDONLY, data) : -1};
+            chunked(path, "pread()", ::pread, in.fd, direct.fd, static_cast<uint8_t*>(data), h.data_offset, length);
+        }
+    }
+
+} // namespace pshm
@@ -0,0 +1,16 @@
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include <pshm/control_group.hpp>
+
+namespace pshm
+{
+    /* C++14 requires these to exist like this. C++17 is happy enough with the header. */
+
+    constexpr size_t control_group::WIDTH;
+    constexpr uint8_t control_group::EMPTY;
+    constexpr uint8_t control_group::BUSY;
+    constexpr uint8_t control_group::DELETED;
+    constexpr uint8_t control_group::FULL;
+
+} // namespace pshm
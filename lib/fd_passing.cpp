@@ -0,0 +1,132 @@
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include <pshm/fd_passing.hpp>
+
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+
+using std::runtime_error;
+using std::string;
+
+namespace
+{
+    string make_error(const string& msg, int error)
+    {
+        return msg + ": " + std::strerror(error);
+    }
+} // namespace
+
+namespace pshm
+{
+    void send_fd(int socket, int fd)
+    {
+        char byte = 0;
+        struct iovec iov;
+        iov.iov_base = &byte;
+        iov.iov_len = 1;
+
+        union {
+            struct cmsghdr align;
+            char buf[CMSG_SPACE(sizeof(int))];
+        } control;
+        std::memset(&control, 0, sizeof(control));
+
+        struct msghdr msg;
+        std::memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control.buf;
+        msg.msg_controllen = sizeof(control.buf);
+
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        std::memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+        ssize_t n;
+        do {
+            n = ::sendmsg(socket, &msg, 0);
+        } while (n == -1 && errno == EINTR);
+        if (n == -1)
+            throw runtime_error(make_error("sendmsg() failed", errno));
+    }
+
+    int receive_fd(int socket)
+    {
+        char byte;
+        struct iovec iov;
+        iov.iov_base = &byte;
+        iov.iov_len = 1;
+
+        union {
+            struct cmsghdr align;
+            char buf[CMSG_SPACE(sizeof(int))];
+        } control;
+
+        struct msghdr msg;
+        std::memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control.buf;
+        msg.msg_controllen = sizeof(control.buf);
+
+        int flags = 0;
+#if defined(MSG_CMSG_CLOEXEC)
+        flags |= MSG_CMSG_CLOEXEC;
+#endif
+        ssize_t n;
+        do {
+            n = ::recvmsg(socket, &msg, flags);
+        } while (n == -1 && errno == EINTR);
+        if (n == -1)
+            throw runtime_error(make_error("recvmsg() failed", errno));
+
+        for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+                int fd;
+                std::memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+#if !defined(MSG_CMSG_CLOEXEC)
+                ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+#endif
+                return fd;
+            }
+        }
+        throw runtime_error("recvmsg() returned no file descriptor");
+    }
+
+    int duplicate_fd(int pid, int fd)
+    {
+#if defined(__linux__) && defined(SYS_pidfd_open) && defined(SYS_pidfd_getfd)
+        int pidfd = static_cast<int>(::syscall(SYS_pidfd_open, pid, 0));
+        if (pidfd != -1) {
+            int copy = static_cast<int>(::syscall(SYS_pidfd_getfd, pidfd, fd, 0));
+            int error = errno;
+            ::close(pidfd);
+            if (copy != -1)
+                return copy;
+            if (error != ENOSYS)
+                throw std::system_error(error, std::generic_category(), "pidfd_getfd() failed for fd " + std::to_string(fd) + " of pid " + std::to_string(pid));
+        } else if (errno != ENOSYS) {
+            throw std::system_error(errno, std::generic_category(), "pidfd_open() failed for pid " + std::to_string(pid));
+        }
+#endif
+        string path = "/proc/" + std::to_string(pid) + "/fd/" + std::to_string(fd);
+        int copy = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+        if (copy == -1)
+            throw std::system_error(errno, std::generic_category(), "open() failed: " + path);
+        return copy;
+    }
+
+} // namespace pshm
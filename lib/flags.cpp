@@ -12,5 +12,9 @@ namespace pshm
     constexpr flags_t flags::CREAT;
     constexpr flags_t flags::EXCL;
     constexpr flags_t flags::TRUNC;
+    constexpr flags_t flags::HEADER;
+    constexpr flags_t flags::UNLINK_OWNER;
+    constexpr flags_t flags::UNLINK_LAST;
+    constexpr flags_t flags::PERSISTENT;
 
 } // namespace pshm
@@ -0,0 +1,78 @@
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include <pshm/futex.hpp>
+
+#include <climits>
+#include <thread>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex words must be plain 32-bit words");
+
+namespace
+{
+#if defined(__linux__)
+    long futex(std::atomic<uint32_t>& word, int op, uint32_t val, const struct timespec* timeout) noexcept
+    {
+        return ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), op, val, timeout, nullptr, 0);
+    }
+#endif
+} // namespace
+
+namespace pshm
+{
+    void futex_wait(std::atomic<uint32_t>& word, uint32_t expected) noexcept
+    {
+#if defined(__linux__)
+        futex(word, FUTEX_WAIT, expected, nullptr);
+#else
+        while (word.load(std::memory_order_acquire) == expected)
+            std::this_thread::yield();
+#endif
+    }
+
+    bool futex_wait_for(std::atomic<uint32_t>& word, uint32_t expected, std::chrono::nanoseconds timeout) noexcept
+    {
+#if defined(__linux__)
+        if (timeout.count() <= 0)
+            return word.load(std::memory_order_acquire) != expected;
+
+        struct timespec ts;
+        ts.tv_sec = static_cast<time_t>(timeout.count() / 1000000000);
+        ts.tv_nsec = static_cast<long>(timeout.count() % 1000000000);
+        if (futex(word, FUTEX_WAIT, expected, &ts) == -1 && errno == ETIMEDOUT)
+            return false;
+        return true;
+#else
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (word.load(std::memory_order_acquire) == expected) {
+            if (std::chrono::steady_clock::now() >= deadline)
+                return false;
+            std::this_thread::yield();
+        }
+        return true;
+#endif
+    }
+
+    void futex_wake(std::atomic<uint32_t>& word, int count) noexcept
+    {
+#if defined(__linux__)
+        futex(word, FUTEX_WAKE, static_cast<uint32_t>(count), nullptr);
+#else
+        (void)word;
+        (void)count;
+#endif
+    }
+
+    void futex_wake_all(std::atomic<uint32_t>& word) noexcept
+    {
+        futex_wake(word, INT_MAX);
+    }
+
+} // namespace pshm
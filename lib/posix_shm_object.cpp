@@ -3,6 +3,13 @@
 
 #include <pshm/posix_shm_object.hpp>
 
+#include <pshm/checkpoint.hpp>
+#include <pshm/residency.hpp>
+
+#include <chrono>
+#include <cstring>
+#include <thread>
+
 #include <fcntl.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
@@ -26,6 +33,52 @@ namespace
 
     string make_name(const string& name);
 
+    /**
+     * @brief Convert an advice to madvise() advice.
+     *
+     * @returns the MADV_ constant, or -1 if this system doesn't have it.
+     */
+    int to_madvise(pshm::shm_object::advice hint);
+
+    /**
+     * @brief How long attachers wait on a creator still setting up the header.
+     */
+    constexpr std::chrono::seconds header_timeout(1);
+
+    /**
+     * @brief Poll until ready() or header_timeout passes.
+     *
+     * @param ready predicate to poll.
+     * @returns the last value of ready().
+     */
+    template <class Predicate>
+    bool wait_for_header(Predicate ready);
+
+    /**
+     * @brief Translate flags to mmap() protection bits.
+     */
+    int to_prot(int fcntl_flags);
+
+    /**
+     * @brief Validate the lifetime flags.
+     *
+     * @throws invalid_argument if more than one is set, UNLINK_LAST is set
+     * without HEADER and RDWR, or PERSISTENT without HEADER.
+     */
+    void check_lifetime(pshm::posix_shm_object::flags_type f, const string& name);
+
+    /**
+     * @returns the segment_header::lifetime value for the lifetime flags.
+     */
+    uint8_t lifetime_of(pshm::posix_shm_object::flags_type f) noexcept;
+
+    /**
+     * @brief Count another UNLINK_LAST handle, unless the count already hit 0.
+     *
+     * @returns false if the last handle is unlinking the object.
+     */
+    bool attach(std::atomic<uint32_t>& attached) noexcept;
+
     int to_fcntl(pshm::posix_shm_object::flags_type i)
     {
         int o = 0;
@@ -54,6 +107,96 @@ namespace
 
         return "/" + name;
     }
+
+    template <class Predicate>
+    bool wait_for_header(Predicate ready)
+    {
+        auto deadline = std::chrono::steady_clock::now() + header_timeout;
+
+        for (int spins = 0; !ready(); ++spins) {
+            if (std::chrono::steady_clock::now() >= deadline)
+                return ready();
+            if (spins < 100)
+                std::this_thread::yield();
+            else
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return true;
+    }
+
+    int to_prot(int fcntl_flags)
+    {
+        /* O_RDONLY is 0 on most platforms so it can't be tested as a bit. */
+        int prot = PROT_READ;
+        if (fcntl_flags & O_RDWR)
+            prot |= PROT_WRITE;
+        return prot;
+    }
+
+    void check_lifetime(pshm::posix_shm_object::flags_type f, const string& name)
+    {
+        using pshm::flags;
+        int modes = !!(f & flags::UNLINK_OWNER) + !!(f & flags::UNLINK_LAST) + !!(f & flags::PERSISTENT);
+        if (modes > 1)
+            throw invalid_argument("only one of flags::UNLINK_OWNER, flags::UNLINK_LAST and flags::PERSISTENT may be set: " + name);
+        if ((f & flags::UNLINK_LAST) && ((f & flags::HEADER) == 0 || (f & flags::RDWR) == 0))
+            throw invalid_argument("flags::UNLINK_LAST requires flags::HEADER and flags::RDWR: " + name);
+        if ((f & flags::PERSISTENT) && (f & flags::HEADER) == 0)
+            throw invalid_argument("flags::PERSISTENT requires flags::HEADER: " + name);
+    }
+
+    uint8_t lifetime_of(pshm::posix_shm_object::flags_type f) noexcept
+    {
+        if (f & pshm::flags::UNLINK_LAST)
+            return pshm::segment_header::LIFETIME_LAST;
+        if (f & pshm::flags::PERSISTENT)
+            return pshm::segment_header::LIFETIME_PERSISTENT;
+        return pshm::segment_header::LIFETIME_OWNER;
+    }
+
+    bool attach(std::atomic<uint32_t>& attached) noexcept
+    {
+        uint32_t n = attached.load(std::memory_order_relaxed);
+        do {
+            if (n == 0)
+                return false;
+        } while (!attached.compare_exchange_weak(n, n + 1, std::memory_order_acq_rel, std::memory_order_relaxed));
+        return true;
+    }
+
+    int to_madvise(pshm::shm_object::advice hint)
+    {
+        using advice = pshm::shm_object::advice;
+
+        switch (hint) {
+            case advice::normal:
+                return MADV_NORMAL;
+            case advice::sequential:
+                return MADV_SEQUENTIAL;
+            case advice::random:
+                return MADV_RANDOM;
+            case advice::will_need:
+                return MADV_WILLNEED;
+            case advice::dont_need:
+                return MADV_DONTNEED;
+#if defined(MADV_HUGEPAGE)
+            case advice::hugepage:
+                return MADV_HUGEPAGE;
+            case advice::no_hugepage:
+                return MADV_NOHUGEPAGE;
+#endif
+#if defined(MADV_COLD)
+            case advice::cold:
+                return MADV_COLD;
+#endif
+#if defined(MADV_PAGEOUT)
+            case advice::pageout:
+                return MADV_PAGEOUT;
+#endif
+            default:
+                return -1;
+        }
+    }
 } // namespace
 
 namespace pshm
@@ -61,64 +204,295 @@ namespace pshm
     PSHM_DEFINE_ALLOCATION_TRACER(posix_shm_object);
 
     posix_shm_object::posix_shm_object(const string_type& name, flags_type flags, size_type length, offset_type offset)
+        : posix_shm_object(name, flags, length, offset, segment_layout{length, 1, 0})
+    {
+    }
+
+    posix_shm_object::posix_shm_object(const string_type& name, flags_type flags, size_type length, offset_type offset, const segment_layout& layout)
+        : posix_shm_object(name, flags, length, offset, layout, initializer_type())
+    {
+    }
+
+    posix_shm_object::posix_shm_object(const string_type& name, flags_type flags, size_type length, offset_type offset, const segment_layout& layout, initializer_type init)
         : shm_object(make_name(name), flags, length, offset)
         , mPointer(nullptr)
+        , mMapping(nullptr)
+        , mMappingSize(0)
         , mFile(-1)
+        , mCreator(false)
+    {
+        check_lifetime(this->flags(), this->name());
+        try {
+            if ((this->flags() & pshm::flags::HEADER) == 0)
+                open_plain();
+            else if (!wait_for_header([&]() { return open_with_header(layout, init); }))
+                throw runtime_error(make_error("timed out waiting for the last handle to unlink: " + this->name()));
+        } catch (...) {
+            /* The destructor won't run for us. */
+            if (mMapping != nullptr)
+                ::munmap(mMapping, mMappingSize);
+            if (mFile != -1)
+                ::close(mFile);
+            throw;
+        }
+        register_mapping(this->name(), mMapping, mMappingSize);
+    }
+
+    void posix_shm_object::open_plain()
     {
         string_type n = this->name();
+        if (this->offset() < 0 || static_cast<size_type>(this->offset()) % page_size() != 0)
+            throw invalid_argument(make_error("offset must be a multiple of the page size: " + n));
+
         int f = to_fcntl(this->flags());
-        mFile = shm_open(n.c_str(), f, default_mode);
+        if ((f & O_CREAT) && (f & O_EXCL) == 0) {
+            /* Only the creator may unlink by default, so find out if that's us. */
+            mFile = shm_open(n.c_str(), f | O_EXCL, default_mode);
+            if (mFile != -1)
+                mCreator = true;
+            else if (errno == EEXIST)
+                mFile = shm_open(n.c_str(), f & ~O_CREAT, default_mode);
+        } else {
+            mFile = shm_open(n.c_str(), f, default_mode);
+            mCreator = mFile != -1 && (f & O_CREAT);
+        }
 
         if (mFile == -1)
             throw runtime_error(make_error("shm_open() failed", n, errno));
 
         if (f & O_RDWR) {
-            if (ftruncate(mFile, size()) != 0) {
+            /* The mapping must not run past the end or touching it raises SIGBUS. */
+            if (ftruncate(mFile, static_cast<off_t>(this->offset()) + static_cast<off_t>(size())) != 0) {
                 throw runtime_error(make_error("ftruncate() failed", n, errno));
             }
         }
 
-        int prot = PROT_NONE;
-        if (f & O_RDONLY)
-            prot |= PROT_READ;
-        if (f & O_RDWR)
-            prot |= PROT_WRITE;
+        int prot = to_prot(f);
 
         off_t off = static_cast<off_t>(this->offset());
         mPointer = ::mmap(nullptr, size(), prot, MAP_SHARED, mFile, off);
 
-        if (mPointer == nullptr)
+        if (mPointer == MAP_FAILED) {
+            mPointer = nullptr;
             throw runtime_error(make_error("mmap() failed", n, errno));
+        }
+        mMapping = mPointer;
+        mMappingSize = size();
         PSHM_ALLOCATION_TRACER_NOTE_POINTER("mmap() returned", mPointer);
     }
 
+    bool posix_shm_object::open_with_header(const segment_layout& layout, const initializer_type& init)
+    {
+        string_type n = this->name();
+        int f = to_fcntl(this->flags());
+
+        if (this->offset() != 0)
+            throw invalid_argument(make_error("flags::HEADER requires an offset of 0: " + n));
+        if (layout.size != size())
+            throw invalid_argument(make_error("segment_layout::size doesn't match the length: " + n));
+        if (layout.alignment == 0 || (layout.alignment & (layout.alignment - 1)) != 0)
+            throw invalid_argument(make_error("segment_layout::alignment must be a power of 2: " + n));
+
+        uint64_t payload_offset = segment_payload_offset(layout.alignment);
+        size_type mapping_size = static_cast<size_type>(payload_offset + layout.size);
+
+        /*
+         * O_EXCL tells us whether we are the creator. Truncating is pointless:
+         * a new object is empty and an existing one belongs to the creator.
+         */
+        bool creator = false;
+        f &= ~O_TRUNC;
+        if (f & O_CREAT) {
+            if ((f & O_RDWR) == 0)
+                throw invalid_argument(make_error("flags::HEADER with flags::CREAT requires flags::RDWR: " + n));
+            mFile = shm_open(n.c_str(), f | O_EXCL, default_mode);
+            if (mFile != -1)
+                creator = true;
+            else if (errno == EEXIST && (f & O_EXCL) == 0)
+                mFile = shm_open(n.c_str(), f & ~O_CREAT, default_mode);
+        } else {
+            mFile = shm_open(n.c_str(), f, default_mode);
+        }
+
+        if (mFile == -1)
+            throw runtime_error(make_error("shm_open() failed", n, errno));
+
+        if (creator) {
+            if (ftruncate(mFile, mapping_size) != 0) {
+                int error = errno;
+                shm_unlink(n.c_str());
+                throw runtime_error(make_error("ftruncate() failed", n, error));
+            }
+        } else {
+            /* The creator may not have gotten around to ftruncate() yet. */
+            struct stat st;
+            bool sized = wait_for_header([&]() {
+                return fstat(mFile, &st) == 0 && st.st_size > 0;
+            });
+            if (!sized || static_cast<size_t>(st.st_size) < sizeof(segment_header))
+                throw runtime_error(make_error("object is too small to have a segment_header: " + n));
+
+            void* p = ::mmap(nullptr, sizeof(segment_header), PROT_READ, MAP_SHARED, mFile, 0);
+            if (p == MAP_FAILED)
+                throw runtime_error(make_error("mmap() failed", n, errno));
+            const segment_header* h = static_cast<const segment_header*>(p);
+
+            bool ready = wait_for_header([h]() {
+                return h->state.load(std::memory_order_acquire) == segment_header::READY;
+            });
+
+            string_type problem;
+            if (!ready)
+                problem = "timed out waiting for the segment_header to be ready";
+            else if (h->magic != segment_header::MAGIC)
+                problem = "bad segment_header::magic";
+            else if (h->version != segment_header::VERSION)
+                problem = "segment_header::version is " + std::to_string(h->version) + " but " + std::to_string(segment_header::VERSION) + " was expected";
+            else if (h->payload_size != layout.size)
+                problem = "payload size is " + std::to_string(h->payload_size) + " but " + std::to_string(layout.size) + " was expected";
+            else if (h->alignment != layout.alignment)
+                problem = "payload alignment is " + std::to_string(h->alignment) + " but " + std::to_string(layout.alignment) + " was expected";
+            else if (h->layout_hash != layout.hash)
+                problem = "layout hash doesn't match";
+            else if (h->lifetime != lifetime_of(this->flags()))
+                problem = "lifetime flags don't match the creator's";
+            else if (h->payload_offset != payload_offset || static_cast<size_t>(st.st_size) < mapping_size)
+                problem = "object is smaller than the segment_header describes";
+            ::munmap(p, sizeof(segment_header));
+
+            if (!problem.empty())
+                throw runtime_error(make_error(problem + ": " + n));
+        }
+
+        mMapping = ::mmap(nullptr, mapping_size, to_prot(f), MAP_SHARED, mFile, 0);
+        if (mMapping == MAP_FAILED) {
+            int error = errno;
+            mMapping = nullptr;
+            if (creator)
+                shm_unlink(n.c_str());
+            throw runtime_error(make_error("mmap() failed", n, error));
+        }
+        mMappingSize = mapping_size;
+        mPointer = static_cast<char*>(mMapping) + payload_offset;
+        PSHM_ALLOCATION_TRACER_NOTE_POINTER("mmap() returned", mMapping);
+
+        if (creator) {
+            segment_header* h = static_cast<segment_header*>(mMapping);
+            h->state.store(segment_header::INITIALIZING, std::memory_order_relaxed);
+            h->magic = segment_header::MAGIC;
+            h->version = segment_header::VERSION;
+            h->library_version = PSHM_VERSION_CODE;
+            h->payload_size = layout.size;
+            h->payload_offset = payload_offset;
+            h->alignment = layout.alignment;
+            h->layout_hash = layout.hash;
+            h->lifetime = lifetime_of(this->flags());
+            if (this->flags() & pshm::flags::UNLINK_LAST)
+                h->attached.store(1, std::memory_order_relaxed);
+
+            if (init) {
+                try {
+                    init(mPointer);
+                } catch (...) {
+                    shm_unlink(n.c_str());
+                    throw;
+                }
+            }
+            h->state.store(segment_header::READY, std::memory_order_release);
+        } else if (this->flags() & pshm::flags::UNLINK_LAST) {
+            if (!attach(static_cast<segment_header*>(mMapping)->attached)) {
+                /* Opened just before the last handle unlinks it: wait for the name to go. */
+                ::munmap(mMapping, mMappingSize);
+                ::close(mFile);
+                mMapping = nullptr;
+                mPointer = nullptr;
+                mMappingSize = 0;
+                mFile = -1;
+                return false;
+            }
+        }
+        mCreator = creator;
+        return true;
+    }
+
     posix_shm_object::~posix_shm_object()
     {
-        if (mPointer != nullptr) {
-            ::munmap(mPointer, size());
+        release();
+    }
+
+    void posix_shm_object::release() noexcept
+    {
+        bool last = false;
+        if (flags() & pshm::flags::UNLINK_LAST) {
+            /* Nobody attaches once this hits 0, so the name is ours to unlink. */
+            const segment_header* h = header();
+            last = h != nullptr && const_cast<segment_header*>(h)->attached.fetch_sub(1, std::memory_order_acq_rel) == 1;
+        } else if ((flags() & pshm::flags::PERSISTENT) == 0) {
+            last = mCreator;
+        }
+
+        if (mMapping != nullptr) {
+            unregister_mapping(mMapping);
+            ::munmap(mMapping, mMappingSize);
         }
-        if (mFile > 0) {
-            shm_unlink(name().c_str());
+        if (mFile != -1) {
+            if (last)
+                shm_unlink(name().c_str());
+            ::close(mFile);
         }
+        mPointer = nullptr;
+        mMapping = nullptr;
+        mMappingSize = 0;
+        mFile = -1;
+        mCreator = false;
+    }
+
+    bool posix_shm_object::unlink(const string_type& name)
+    {
+        string_type n = make_name(name);
+        if (shm_unlink(n.c_str()) == 0)
+            return true;
+        if (errno == ENOENT)
+            return false;
+        throw runtime_error(std::string("shm_unlink() failed: ") + n + ": " + std::strerror(errno));
+    }
+
+    bool posix_shm_object::created() const noexcept
+    {
+        return mCreator;
     }
 
     posix_shm_object::posix_shm_object(posix_shm_object&& r) noexcept
         : shm_object(std::move(r))
         , mPointer(std::move(r.mPointer))
+        , mMapping(std::move(r.mMapping))
+        , mMappingSize(std::move(r.mMappingSize))
         , mFile(std::move(r.mFile))
+        , mCreator(r.mCreator)
     {
         r.mPointer = nullptr;
+        r.mMapping = nullptr;
+        r.mMappingSize = 0;
         r.mFile = -1;
+        r.mCreator = false;
     }
 
     posix_shm_object& posix_shm_object::operator=(posix_shm_object&& r) noexcept
     {
         if (this != &r) {
+            /* Before the base class takes over the name and flags release() needs. */
+            release();
             shm_object::operator=(std::move(r));
             mPointer = std::move(r.mPointer);
+            mMapping = std::move(r.mMapping);
+            mMappingSize = std::move(r.mMappingSize);
             mFile = std::move(r.mFile);
+            mCreator = r.mCreator;
             r.mPointer = nullptr;
+            r.mMapping = nullptr;
+            r.mMappingSize = 0;
             r.mFile = -1;
+            r.mCreator = false;
         }
         return *this;
     }
@@ -128,4 +502,67 @@ namespace pshm
         return mPointer;
     }
 
+    const segment_header* posix_shm_object::header() const noexcept
+    {
+        if (mMapping == mPointer)
+            return nullptr;
+        return static_cast<const segment_header*>(mMapping);
+    }
+
+    void posix_shm_object::advise(size_type offset, size_type length, advice hint)
+    {
+        if (offset > size() || length > size() - offset)
+            throw invalid_argument(make_error("advise() range is outside the object: " + name()));
+        if (mPointer == nullptr)
+            throw runtime_error(make_error("advise() on an object that isn't mapped: " + name()));
+
+        int native = to_madvise(hint);
+        if (native == -1)
+            throw runtime_error(make_error("advise() hint isn't supported on this system: " + name()));
+        if (length == 0)
+            return;
+
+        uintptr_t page = static_cast<uintptr_t>(::sysconf(_SC_PAGESIZE));
+        uintptr_t start = reinterpret_cast<uintptr_t>(mPointer) + offset;
+        uintptr_t aligned = start & ~(page - 1);
+        if (::madvise(reinterpret_cast<void*>(aligned), length + (start - aligned), native) == -1)
+            throw runtime_error(make_error("madvise() failed", name(), errno));
+    }
+
+    posix_shm_object::size_type posix_shm_object::resident_bytes() const
+    {
+        if (mPointer == nullptr)
+            return 0;
+        return pshm::resident_bytes(mPointer, size());
+    }
+
+    std::vector<bool> posix_shm_object::residency(size_type offset, size_type length) const
+    {
+        if (offset > size() || length > size() - offset)
+            throw invalid_argument(make_error("residency() range is outside the object: " + name()));
+        if (mPointer == nullptr)
+            return std::vector<bool>();
+        return residency_map(static_cast<const uint8_t*>(mPointer) + offset, length);
+    }
+
+    void posix_shm_object::checkpoint(const string_type& path) const
+    {
+        if (mPointer == nullptr)
+            throw runtime_error(make_error("checkpoint() on an object that isn't mapped: " + name()));
+        const segment_header* h = header();
+        uint64_t file_offset = h ? h->payload_offset : static_cast<uint64_t>(offset());
+        write_checkpoint(path, mFile, file_offset, mPointer, size(), h ? h->layout_hash : 0);
+    }
+
+    void posix_shm_object::restore(const string_type& path)
+    {
+        if (mPointer == nullptr)
+            throw runtime_error(make_error("restore() on an object that isn't mapped: " + name()));
+        if ((flags() & flags::RDWR) == 0)
+            throw runtime_error(make_error("restore() requires flags::RDWR: " + name()));
+        const segment_header* h = header();
+        uint64_t file_offset = h ? h->payload_offset : static_cast<uint64_t>(offset());
+        read_checkpoint(path, mFile, file_offset, mPointer, size(), h ? h->layout_hash : 0);
+    }
+
 } // namespace pshm
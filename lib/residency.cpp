@@ -0,0 +1,123 @@
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include <pshm/residency.hpp>
+
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+using std::runtime_error;
+
+namespace
+{
+    struct registered_mapping {
+        std::string name;
+        size_t length;
+    };
+
+    /**
+     * @brief The registry, created on first use so it outlives static objects.
+     */
+    struct registry {
+        std::mutex mutex;
+        std::map<const void*, registered_mapping> mappings;
+    };
+
+    registry& get_registry()
+    {
+        static registry* r = new registry();
+        return *r;
+    }
+
+    /**
+     * @brief Call mincore() over a range.
+     *
+     * @returns one byte per page as filled in by mincore().
+     */
+    std::vector<unsigned char> query(const void* address, size_t length)
+    {
+        if (length == 0)
+            return std::vector<unsigned char>();
+
+        uintptr_t page = pshm::page_size();
+        uintptr_t start = reinterpret_cast<uintptr_t>(address);
+        uintptr_t aligned = start & ~(page - 1);
+        size_t span = length + (start - aligned);
+
+        std::vector<unsigned char> vec((span + page - 1) / page);
+        if (::mincore(reinterpret_cast<void*>(aligned), span, vec.data()) != 0)
+            throw runtime_error(std::string("mincore() failed: ") + std::strerror(errno));
+        return vec;
+    }
+} // namespace
+
+namespace pshm
+{
+    size_t page_size() noexcept
+    {
+        static const size_t size = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        return size;
+    }
+
+    std::vector<bool> residency_map(const void* address, size_t length)
+    {
+        std::vector<unsigned char> vec = query(address, length);
+        std::vector<bool> map(vec.size());
+        for (size_t i = 0; i < vec.size(); ++i)
+            map[i] = (vec[i] & 1) != 0;
+        return map;
+    }
+
+    size_t resident_bytes(const void* address, size_t length)
+    {
+        std::vector<unsigned char> vec = query(address, length);
+        size_t pages = 0;
+        for (unsigned char c : vec)
+            pages += (c & 1);
+        return pages * page_size();
+    }
+
+    mapping_summary summarize_mappings()
+    {
+        mapping_summary summary{std::vector<mapping_info>(), 0, 0};
+        registry& r = get_registry();
+        {
+            std::lock_guard<std::mutex> lock(r.mutex);
+            summary.mappings.reserve(r.mappings.size());
+            for (const auto& m : r.mappings)
+                summary.mappings.push_back(mapping_info{m.second.name, m.first, m.second.length, 0});
+        }
+
+        /* Outside the lock: mincore() can be slow for big mappings. */
+        for (auto& m : summary.mappings) {
+            try {
+                m.resident = resident_bytes(m.address, m.length);
+            } catch (runtime_error&) {
+                /* Unmapped since the lock was dropped. */
+                m.resident = 0;
+            }
+            summary.mapped_bytes += m.length;
+            summary.resident_bytes += m.resident;
+        }
+        return summary;
+    }
+
+    void register_mapping(const std::string& name, const void* address, size_t length)
+    {
+        registry& r = get_registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.mappings[address] = registered_mapping{name, length};
+    }
+
+    void unregister_mapping(const void* address) noexcept
+    {
+        registry& r = get_registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.mappings.erase(address);
+    }
+
+} // namespace pshm
@@ -0,0 +1,13 @@
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include <pshm/segment_header.hpp>
+
+namespace pshm
+{
+    /* C++14 requires these to exist like this. C++17 is happy enough with the header. */
+
+    constexpr uint32_t segment_header::MAGIC;
+    constexpr uint32_t segment_header::VERSION;
+
+} // namespace pshm
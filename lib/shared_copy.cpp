@@ -0,0 +1,142 @@
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include <pshm/shared_copy.hpp>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define PSHM_SHARED_COPY_X86 1
+#else
+#define PSHM_SHARED_COPY_X86 0
+#endif
+
+namespace
+{
+    using copy_fn = void (*)(uint8_t*, const uint8_t*, size_t);
+
+    struct kernel {
+        copy_fn copy;
+        /** Store width, also the destination alignment. */
+        size_t width;
+        const char* isa;
+    };
+
+    void copy_memcpy(uint8_t* dst, const uint8_t* src, size_t n)
+    {
+        std::memcpy(dst, src, n);
+    }
+
+#if PSHM_SHARED_COPY_X86
+    /*
+     * Each kernel gets an aligned dst and a multiple of its width. Loads are
+     * unaligned since src can be anywhere. Four stores per iteration keeps a
+     * whole line in flight at a time for the narrower kernels.
+     */
+
+    __attribute__((target("sse2"))) void copy_sse2(uint8_t* dst, const uint8_t* src, size_t n)
+    {
+        size_t i = 0;
+        for (; i + 64 <= n; i += 64) {
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 16));
+            __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 32));
+            __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 48));
+            _mm_stream_si128(reinterpret_cast<__m128i*>(dst + i), a);
+            _mm_stream_si128(reinterpret_cast<__m128i*>(dst + i + 16), b);
+            _mm_stream_si128(reinterpret_cast<__m128i*>(dst + i + 32), c);
+            _mm_stream_si128(reinterpret_cast<__m128i*>(dst + i + 48), d);
+        }
+        for (; i < n; i += 16)
+            _mm_stream_si128(reinterpret_cast<__m128i*>(dst + i), _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+    }
+
+    __attribute__((target("avx"))) void copy_avx(uint8_t* dst, const uint8_t* src, size_t n)
+    {
+        size_t i = 0;
+        for (; i + 128 <= n; i += 128) {
+            __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+            __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i + 32));
+            __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i + 64));
+            __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i + 96));
+            _mm256_stream_si256(reinterpret_cast<__m256i*>(dst + i), a);
+            _mm256_stream_si256(reinterpret_cast<__m256i*>(dst + i + 32), b);
+            _mm256_stream_si256(reinterpret_cast<__m256i*>(dst + i + 64), c);
+            _mm256_stream_si256(reinterpret_cast<__m256i*>(dst + i + 96), d);
+        }
+        for (; i < n; i += 32)
+            _mm256_stream_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i)));
+        _mm256_zeroupper();
+    }
+
+    __attribute__((target("avx512f"))) void copy_avx512(uint8_t* dst, const uint8_t* src, size_t n)
+    {
+        size_t i = 0;
+        for (; i + 256 <= n; i += 256) {
+            __m512i a = _mm512_loadu_si512(src + i);
+            __m512i b = _mm512_loadu_si512(src + i + 64);
+            __m512i c = _mm512_loadu_si512(src + i + 128);
+            __m512i d = _mm512_loadu_si512(src + i + 192);
+            _mm512_stream_si512(reinterpret_cast<__m512i*>(dst + i), a);
+            _mm512_stream_si512(reinterpret_cast<__m512i*>(dst + i + 64), b);
+            _mm512_stream_si512(reinterpret_cast<__m512i*>(dst + i + 128), c);
+            _mm512_stream_si512(reinterpret_cast<__m512i*>(dst + i + 192), d);
+        }
+        for (; i < n; i += 64)
+            _mm512_stream_si512(reinterpret_cast<__m512i*>(dst + i), _mm512_loadu_si512(src + i));
+        _mm256_zeroupper();
+    }
+#endif
+
+    kernel select_kernel() noexcept
+    {
+#if PSHM_SHARED_COPY_X86
+        __builtin_cpu_init();
+        /* These also check that the OS saves the wider registers. */
+        if (__builtin_cpu_supports("avx512f"))
+            return kernel{copy_avx512, 64, "avx512f"};
+        if (__builtin_cpu_supports("avx"))
+            return kernel{copy_avx, 32, "avx"};
+        if (__builtin_cpu_supports("sse2"))
+            return kernel{copy_sse2, 16, "sse2"};
+#endif
+        return kernel{copy_memcpy, 1, "memcpy"};
+    }
+
+    const kernel& selected() noexcept
+    {
+        static const kernel k = select_kernel();
+        return k;
+    }
+} // namespace
+
+namespace pshm
+{
+    void* streaming_copy(void* dst, const void* src, size_t n) noexcept
+    {
+        const kernel& k = selected();
+        uint8_t* d = static_cast<uint8_t*>(dst);
+        const uint8_t* s = static_cast<const uint8_t*>(src);
+
+        if (k.width == 1 || n < 2 * k.width)
+            return std::memcpy(dst, src, n);
+
+        /* Plain copies for the unaligned head and the tail. */
+        size_t head = (k.width - (reinterpret_cast<uintptr_t>(d) & (k.width - 1))) & (k.width - 1);
+        std::memcpy(d, s, head);
+        size_t body = (n - head) & ~(k.width - 1);
+        k.copy(d + head, s + head, body);
+        std::memcpy(d + head + body, s + head + body, n - head - body);
+
+#if PSHM_SHARED_COPY_X86
+        /* Streaming stores aren't ordered with later stores without this. */
+        _mm_sfence();
+#endif
+        return dst;
+    }
+
+    const char* streaming_copy_isa() noexcept
+    {
+        return selected().isa;
+    }
+
+} // namespace pshm
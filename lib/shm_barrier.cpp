@@ -0,0 +1,159 @@
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include <pshm/shm_barrier.hpp>
+
+#include <limits>
+
+using std::invalid_argument;
+
+namespace
+{
+    using pshm::barrier_control;
+    using pshm::barrier_node;
+    using size_type = pshm::shm_object::size_type;
+
+    /**
+     * @brief Validate the arguments every barrier shares.
+     *
+     * @throws invalid_argument if they're out of range.
+     */
+    size_type check_participants(pshm::flags_t flags, size_type participants)
+    {
+        if ((flags & pshm::flags::RDWR) == 0)
+            throw invalid_argument("a barrier requires flags::RDWR");
+        if (participants == 0 || participants > std::numeric_limits<uint32_t>::max())
+            throw invalid_argument("a barrier needs between 1 and 2^32 - 1 participants");
+        return participants;
+    }
+
+    /**
+     * @brief Children per level of a combining tree, leaves first.
+     *
+     * Level i has ceil(children[i] / fan_in) nodes. Whatever is left over
+     * after the last level, at most fan_in, arrives at the root.
+     */
+    std::vector<size_type> tree_levels(size_type participants, size_type fan_in)
+    {
+        if (fan_in < 2)
+            throw invalid_argument("a tree barrier needs a fan in of at least 2");
+
+        std::vector<size_type> children;
+        for (size_type c = participants; c > fan_in; c = (c + fan_in - 1) / fan_in)
+            children.push_back(c);
+        return children;
+    }
+
+    size_type tree_nodes(size_type participants, size_type fan_in)
+    {
+        size_type n = 0;
+        for (size_type c : tree_levels(participants, fan_in))
+            n += (c + fan_in - 1) / fan_in;
+        return n;
+    }
+
+    std::unique_ptr<pshm::shm_object> open_barrier(const std::string& name, pshm::flags_t flags, size_type participants, size_type nodes, size_type fan_in)
+    {
+        uint64_t hash = pshm::layout_hash<barrier_control>();
+        hash = pshm::fnv1a_mix(hash, pshm::layout_hash<barrier_node>());
+        hash = pshm::fnv1a_mix(hash, participants);
+        hash = pshm::fnv1a_mix(hash, fan_in);
+        pshm::segment_layout layout{sizeof(barrier_control) + nodes * sizeof(barrier_node), alignof(barrier_control), hash};
+        return std::unique_ptr<pshm::shm_object>(
+            pshm::make_shm_object(name, flags | pshm::flags::HEADER, layout.size, 0, layout));
+    }
+} // namespace
+
+namespace pshm
+{
+    shm_barrier_base::shm_barrier_base(const string_type& name, flags_type flags, size_type participants, size_type nodes, size_type fan_in)
+        : mObject(open_barrier(name, flags, check_participants(flags, participants), nodes, fan_in))
+        , mControl(static_cast<barrier_control*>(mObject->get()))
+        , mNodes(reinterpret_cast<barrier_node*>(mControl + 1))
+        , mDoorbell(&mControl->doorbell)
+        , mParticipants(participants)
+    {
+    }
+
+    uint32_t shm_barrier_base::phase() const noexcept
+    {
+        return mControl->phase.load(std::memory_order_acquire);
+    }
+
+    shm_barrier_base::size_type shm_barrier_base::participants() const noexcept
+    {
+        return mParticipants;
+    }
+
+    bool shm_barrier_base::completed(uint32_t phase) const noexcept
+    {
+        return mControl->phase.load(std::memory_order_acquire) != phase;
+    }
+
+    void shm_barrier_base::arrive_at_root(uint32_t expected)
+    {
+        if (mControl->arrived.fetch_add(1, std::memory_order_acq_rel) + 1 != expected)
+            return;
+        /* Nobody arrives again until they see the new phase, which orders this first. */
+        mControl->arrived.store(0, std::memory_order_relaxed);
+        mControl->phase.fetch_add(1, std::memory_order_release);
+        mDoorbell.ring();
+    }
+
+    shm_barrier::shm_barrier(const string_type& name, flags_type flags, size_type participants)
+        : shm_barrier_base(name, flags, participants, 0, 0)
+    {
+    }
+
+    uint32_t shm_barrier::arrive()
+    {
+        uint32_t p = phase();
+        arrive_at_root(static_cast<uint32_t>(mParticipants));
+        return p;
+    }
+
+    shm_tree_barrier::shm_tree_barrier(const string_type& name, flags_type flags, size_type participants, size_type id, size_type fan_in)
+        : shm_barrier_base(name, flags, participants, tree_nodes(participants, fan_in), fan_in)
+        , mId(id)
+    {
+        if (id >= participants)
+            throw invalid_argument("tree barrier participant id " + std::to_string(id) + " is out of range");
+
+        size_type index = id;
+        size_type base = 0;
+        size_type top = participants;
+        for (size_type children : tree_levels(participants, fan_in)) {
+            size_type j = index / fan_in;
+            size_type below = children - j * fan_in;
+            mPath.push_back(step{mNodes + base + j, static_cast<uint32_t>(below < fan_in ? below : fan_in)});
+            base += (children + fan_in - 1) / fan_in;
+            index = j;
+            top = (children + fan_in - 1) / fan_in;
+        }
+        mRootExpected = static_cast<uint32_t>(top);
+    }
+
+    uint32_t shm_tree_barrier::arrive()
+    {
+        uint32_t p = phase();
+        for (const step& s : mPath) {
+            if (s.node->arrived.fetch_add(1, std::memory_order_acq_rel) + 1 != s.expected)
+                return p;
+            /* The last of the group carries everyone's arrival up. */
+            s.node->arrived.store(0, std::memory_order_relaxed);
+        }
+        arrive_at_root(mRootExpected);
+        return p;
+    }
+
+    shm_tree_barrier::size_type shm_tree_barrier::id() const noexcept
+    {
+        return mId;
+    }
+
+    shm_tree_barrier::size_type shm_tree_barrier::depth() const noexcept
+    {
+        return mPath.size();
+    }
+
+} // namespace pshm
@@ -0,0 +1,141 @@
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include <pshm/shm_bitset.hpp>
+
+using std::invalid_argument;
+using std::out_of_range;
+
+namespace
+{
+    using size_type = pshm::shm_bitset::size_type;
+    using word_type = pshm::shm_bitset::word_type;
+
+    pshm::segment_layout bitset_layout(size_type words, uint64_t layout_tag)
+    {
+        uint64_t hash = pshm::layout_hash<std::atomic<word_type>>();
+        hash = pshm::fnv1a_mix(hash, words);
+        hash = pshm::fnv1a_mix(hash, layout_tag);
+        return pshm::segment_layout{words * sizeof(word_type), 64, hash};
+    }
+
+    std::unique_ptr<pshm::shm_object> open_bitset(const std::string& name, pshm::flags_t flags, size_type words, uint64_t layout_tag)
+    {
+        pshm::segment_layout layout = bitset_layout(words, layout_tag);
+        return std::unique_ptr<pshm::shm_object>(
+            pshm::make_shm_object(name, flags | pshm::flags::HEADER, layout.size, 0, layout));
+    }
+
+    constexpr word_type mask(size_type pos)
+    {
+        return word_type(1) << (pos % pshm::shm_bitset::WORD_BITS);
+    }
+} // namespace
+
+namespace pshm
+{
+    constexpr shm_bitset::size_type shm_bitset::WORD_BITS;
+    constexpr shm_bitset::size_type shm_bitset::BLOCK_BITS;
+
+    shm_bitset::shm_bitset(const string_type& name, flags_type flags, size_type bits, uint64_t layout_tag)
+        : mObject(open_bitset(name, flags, round_bits(bits) / WORD_BITS, layout_tag))
+        , mWords(static_cast<std::atomic<word_type>*>(mObject->get()))
+        , mWordCount(round_bits(bits) / WORD_BITS)
+    {
+    }
+
+    bool shm_bitset::set(size_type pos)
+    {
+        check_position(pos);
+        std::atomic<word_type>& w = mWords[pos / WORD_BITS];
+        /* Skip the write when the bit's already there to keep the line shared. */
+        if (w.load(std::memory_order_relaxed) & mask(pos))
+            return false;
+        return (w.fetch_or(mask(pos), std::memory_order_acq_rel) & mask(pos)) == 0;
+    }
+
+    bool shm_bitset::reset(size_type pos)
+    {
+        check_position(pos);
+        std::atomic<word_type>& w = mWords[pos / WORD_BITS];
+        if ((w.load(std::memory_order_relaxed) & mask(pos)) == 0)
+            return false;
+        return (w.fetch_and(~mask(pos), std::memory_order_acq_rel) & mask(pos)) != 0;
+    }
+
+    bool shm_bitset::test(size_type pos) const
+    {
+        check_position(pos);
+        return (mWords[pos / WORD_BITS].load(std::memory_order_acquire) & mask(pos)) != 0;
+    }
+
+    void shm_bitset::clear() noexcept
+    {
+        for (size_type i = 0; i < mWordCount; ++i)
+            mWords[i].store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    shm_bitset::size_type shm_bitset::count() const noexcept
+    {
+        return popcount_words(reinterpret_cast<const word_type*>(mWords), mWordCount);
+    }
+
+    shm_bitset::size_type shm_bitset::merge_or(const word_type* words, size_type n)
+    {
+        check_words(n);
+        size_type changed = atomic_or_words(mWords, words, n);
+        std::atomic_thread_fence(std::memory_order_release);
+        return changed;
+    }
+
+    shm_bitset::size_type shm_bitset::merge_and(const word_type* words, size_type n)
+    {
+        check_words(n);
+        size_type changed = atomic_and_words(mWords, words, n);
+        std::atomic_thread_fence(std::memory_order_release);
+        return changed;
+    }
+
+    void shm_bitset::copy_to(word_type* words, size_type n) const
+    {
+        check_words(n);
+        for (size_type i = 0; i < n; ++i)
+            words[i] = mWords[i].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+    }
+
+    shm_bitset::size_type shm_bitset::size() const noexcept
+    {
+        return mWordCount * WORD_BITS;
+    }
+
+    shm_bitset::size_type shm_bitset::word_count() const noexcept
+    {
+        return mWordCount;
+    }
+
+    const std::atomic<shm_bitset::word_type>* shm_bitset::words() const noexcept
+    {
+        return mWords;
+    }
+
+    shm_bitset::size_type shm_bitset::round_bits(size_type bits) noexcept
+    {
+        size_type blocks = (bits + BLOCK_BITS - 1) / BLOCK_BITS;
+        return (blocks == 0 ? 1 : blocks) * BLOCK_BITS;
+    }
+
+    void shm_bitset::check_position(size_type pos) const
+    {
+        if (pos >= size())
+            throw out_of_range("bit " + std::to_string(pos) + " is past the end of the shm_bitset");
+    }
+
+    void shm_bitset::check_words(size_type n) const
+    {
+        if (n != mWordCount)
+            throw invalid_argument("expected " + std::to_string(mWordCount) + " words but got " + std::to_string(n));
+    }
+
+} // namespace pshm
@@ -0,0 +1,254 @@
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include <pshm/shm_broadcast_ring.hpp>
+
+#include <pshm/shared_copy.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+using std::invalid_argument;
+using std::runtime_error;
+
+namespace
+{
+    using pshm::broadcast_record_header;
+    using pshm::broadcast_ring_control;
+    using size_type = pshm::shm_object::size_type;
+
+    /** Records start on multiples of this, so a PAD header always fits. */
+    constexpr size_type record_alignment = sizeof(broadcast_record_header);
+
+    /**
+     * @brief Bytes taken up by a record with a payload of length bytes.
+     */
+    constexpr size_type record_size(size_type length)
+    {
+        return (sizeof(broadcast_record_header) + length + record_alignment - 1) & ~(record_alignment - 1);
+    }
+
+    /**
+     * @brief Validate the capacity.
+     *
+     * @throws invalid_argument if capacity isn't a power of two >= 64.
+     */
+    size_type check_capacity(size_type capacity)
+    {
+        if (capacity < 64 || (capacity & (capacity - 1)) != 0)
+            throw invalid_argument("broadcast ring capacity must be a power of two and at least 64");
+        return capacity;
+    }
+
+    /**
+     * @brief Layout of a broadcast ring segment with the given capacity.
+     */
+    pshm::segment_layout ring_layout(size_type capacity)
+    {
+        uint64_t hash = pshm::layout_hash<broadcast_ring_control>();
+        hash = pshm::fnv1a_mix(hash, pshm::layout_hash<broadcast_record_header>());
+        hash = pshm::fnv1a_mix(hash, capacity);
+        return pshm::segment_layout{sizeof(broadcast_ring_control) + capacity, alignof(broadcast_ring_control), hash};
+    }
+
+    std::unique_ptr<pshm::shm_object> open_ring(const std::string& name, pshm::flags_t flags, size_type capacity)
+    {
+        pshm::segment_layout layout = ring_layout(check_capacity(capacity));
+        return std::unique_ptr<pshm::shm_object>(
+            pshm::make_shm_object(name, flags | pshm::flags::HEADER, layout.size, 0, layout));
+    }
+} // namespace
+
+namespace pshm
+{
+    constexpr uint32_t broadcast_record_header::PAD;
+
+    shm_broadcast_ring::shm_broadcast_ring(const string_type& name, flags_type flags, size_type capacity)
+        : mObject(open_ring(name, flags, capacity))
+        , mControl(static_cast<broadcast_ring_control*>(mObject->get()))
+        , mDoorbell(&mControl->doorbell)
+        , mData(static_cast<uint8_t*>(mObject->get()) + sizeof(broadcast_ring_control))
+        , mCapacity(capacity)
+    {
+        /* Pick up where a previous writer left off. */
+        mHead = mControl->head.load(std::memory_order_acquire);
+        mTail = mControl->tail.load(std::memory_order_relaxed);
+        mSequence = mControl->next_sequence;
+    }
+
+    uint64_t shm_broadcast_ring::publish(const void* data, size_type length)
+    {
+        if (length > max_record_size())
+            throw invalid_argument("record of " + std::to_string(length) + " bytes is larger than the broadcast ring allows");
+
+        const uint64_t mask = mCapacity - 1;
+        const size_type need = record_size(length);
+        const uint64_t pos = mHead;
+        const uint64_t off = pos & mask;
+        /* Records never wrap: skip the rest of the lap if this doesn't fit. */
+        const uint64_t pad = (mCapacity - off < need) ? mCapacity - off : 0;
+        const uint64_t end = pos + pad + need;
+
+        /* Move the tail past every record we're about to overwrite. */
+        if (end > mCapacity) {
+            const uint64_t limit = end - mCapacity;
+            uint64_t t = mTail;
+            while (t < limit) {
+                if (t == pos) {
+                    t += pad;
+                    continue;
+                }
+                broadcast_record_header h;
+                std::memcpy(&h, mData + (t & mask), sizeof(h));
+                if (h.flags & broadcast_record_header::PAD)
+                    t += mCapacity - (t & mask);
+                else
+                    t += record_size(h.length);
+            }
+            if (t != mTail) {
+                mTail = t;
+                mControl->tail.store(t, std::memory_order_relaxed);
+                /* Subscribers must see the new tail before any overwritten bytes. */
+                std::atomic_thread_fence(std::memory_order_release);
+            }
+        }
+
+        if (pad != 0) {
+            broadcast_record_header h{0, broadcast_record_header::PAD, 0};
+            std::memcpy(mData + off, &h, sizeof(h));
+        }
+
+        uint8_t* p = mData + ((pos + pad) & mask);
+        broadcast_record_header h{static_cast<uint32_t>(length), 0, mSequence};
+        std::memcpy(p, &h, sizeof(h));
+        copy_to_shared(p + sizeof(h), data, length);
+
+        mControl->next_sequence = mSequence + 1;
+        mHead = end;
+        mControl->head.store(end, std::memory_order_release);
+        mDoorbell.ring();
+        return mSequence++;
+    }
+
+    shm_broadcast_ring::size_type shm_broadcast_ring::capacity() const noexcept
+    {
+        return mCapacity;
+    }
+
+    shm_broadcast_ring::size_type shm_broadcast_ring::max_record_size() const noexcept
+    {
+        /* Record headers keep the length in 32 bits. */
+        return std::min<size_type>(mCapacity - sizeof(broadcast_record_header), UINT32_MAX);
+    }
+
+    shm_doorbell& shm_broadcast_ring::doorbell() noexcept
+    {
+        return mDoorbell;
+    }
+
+    shm_broadcast_subscriber::shm_broadcast_subscriber(const string_type& name, flags_type flags, size_type capacity)
+        : mObject(open_ring(name, flags, capacity))
+        , mControl(static_cast<const broadcast_ring_control*>(mObject->get()))
+        , mDoorbell(const_cast<doorbell_state*>(&mControl->doorbell))
+        , mWritable((flags & flags::RDWR) != 0)
+        , mData(static_cast<const uint8_t*>(mObject->get()) + sizeof(broadcast_ring_control))
+        , mCapacity(capacity)
+        , mCursor(0)
+        , mExpected(0)
+        , mSynced(false)
+        , mDropped(0)
+    {
+        seek_newest();
+    }
+
+    shm_broadcast_subscriber::status shm_broadcast_subscriber::next(record& rec)
+    {
+        const uint64_t mask = mCapacity - 1;
+
+        for (;;) {
+            uint64_t head = mControl->head.load(std::memory_order_acquire);
+            if (mCursor == head)
+                return status::empty;
+
+            uint64_t off = mCursor & mask;
+            broadcast_record_header h;
+            std::memcpy(&h, mData + off, sizeof(h));
+
+            /* Only trust h if the writer hasn't moved the tail past it. */
+            std::atomic_thread_fence(std::memory_order_acquire);
+            uint64_t tail = mControl->tail.load(std::memory_order_relaxed);
+            if (tail > mCursor) {
+                mCursor = tail;
+                return status::overrun;
+            }
+
+            if (h.flags & broadcast_record_header::PAD) {
+                mCursor += mCapacity - off;
+                continue;
+            }
+
+            if (mSynced && h.sequence > mExpected)
+                mDropped += h.sequence - mExpected;
+            mSynced = true;
+            mExpected = h.sequence + 1;
+
+            rec.data = mData + off + sizeof(h);
+            rec.length = h.length;
+            rec.sequence = h.sequence;
+            rec.position = mCursor;
+            mCursor += record_size(h.length);
+            return status::ok;
+        }
+    }
+
+    bool shm_broadcast_subscriber::valid(const record& rec) const noexcept
+    {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return mControl->tail.load(std::memory_order_relaxed) <= rec.position;
+    }
+
+    void shm_broadcast_subscriber::seek_oldest() noexcept
+    {
+        mCursor = mControl->tail.load(std::memory_order_acquire);
+        mSynced = false;
+    }
+
+    void shm_broadcast_subscriber::seek_newest() noexcept
+    {
+        mCursor = mControl->head.load(std::memory_order_acquire);
+        mSynced = false;
+    }
+
+    uint64_t shm_broadcast_subscriber::dropped() const noexcept
+    {
+        return mDropped;
+    }
+
+    bool shm_broadcast_subscriber::pending() const noexcept
+    {
+        return mCursor != mControl->head.load(std::memory_order_acquire);
+    }
+
+    void shm_broadcast_subscriber::wait()
+    {
+        doorbell().wait([this] { return pending(); });
+    }
+
+    bool shm_broadcast_subscriber::wait_for(std::chrono::nanoseconds timeout)
+    {
+        return doorbell().wait_for([this] { return pending(); }, timeout);
+    }
+
+    shm_doorbell& shm_broadcast_subscriber::doorbell()
+    {
+        if (!mWritable)
+            throw runtime_error("waiting on a broadcast ring requires flags::RDWR");
+        return mDoorbell;
+    }
+
+    shm_doorbell& shm_broadcast_subscriber::doorbell_for(bool parks)
+    {
+        return parks ? doorbell() : mDoorbell;
+    }
+
+} // namespace pshm
@@ -0,0 +1,298 @@
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include <pshm/shm_doorbell.hpp>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#if defined(__linux__)
+#include <pshm/fd_passing.hpp>
+
+#include <signal.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+using std::runtime_error;
+
+namespace
+{
+#if defined(__linux__)
+    uint64_t make_registration(int fd) noexcept
+    {
+        return (static_cast<uint64_t>(::getpid()) << 32) | static_cast<uint32_t>(fd);
+    }
+
+    /**
+     * @returns true if fd is an eventfd, and not whatever took over the
+     * number after the consumer closed it.
+     */
+    bool is_eventfd(int fd) noexcept
+    {
+        const char expected[] = "anon_inode:[eventfd]";
+        char path[64];
+        char target[sizeof(expected)];
+        std::snprintf(path, sizeof(path), "/proc/self/fd/%d", fd);
+        ssize_t n = ::readlink(path, target, sizeof(target));
+        return n == static_cast<ssize_t>(sizeof(expected) - 1) && std::memcmp(target, expected, sizeof(expected) - 1) == 0;
+    }
+
+    /** @returns true if the process that made registration no longer exists. */
+    bool registrant_gone(uint64_t registration) noexcept
+    {
+        return ::kill(static_cast<pid_t>(registration >> 32), 0) == -1 && errno == ESRCH;
+    }
+
+    void signal_eventfd(int fd) noexcept
+    {
+        uint64_t one = 1;
+        while (::write(fd, &one, sizeof(one)) == -1 && errno == EINTR) {
+        }
+    }
+#endif
+} // namespace
+
+namespace pshm
+{
+    shm_doorbell::shm_doorbell(doorbell_state* state) noexcept
+        : mState(state)
+        , mRegistered(0)
+        , mOwnedFd(-1)
+        , mNotifyFd(-1)
+    {
+        for (auto& cached : mCached)
+            cached = cached_eventfd{0, -1, false};
+    }
+
+    shm_doorbell::~shm_doorbell()
+    {
+        release();
+    }
+
+    shm_doorbell::shm_doorbell(shm_doorbell&& other) noexcept
+        : mState(other.mState)
+        , mRegistered(other.mRegistered)
+        , mOwnedFd(other.mOwnedFd)
+        , mNotifyFd(other.mNotifyFd)
+    {
+        for (size_t i = 0; i < doorbell_state::EVENTFDS; ++i) {
+            mCached[i] = other.mCached[i];
+            other.mCached[i] = cached_eventfd{0, -1, false};
+        }
+        other.mState = nullptr;
+        other.mRegistered = 0;
+        other.mOwnedFd = -1;
+        other.mNotifyFd = -1;
+    }
+
+    shm_doorbell& shm_doorbell::operator=(shm_doorbell&& other) noexcept
+    {
+        if (this != &other) {
+            release();
+            mState = other.mState;
+            mRegistered = other.mRegistered;
+            mOwnedFd = other.mOwnedFd;
+            mNotifyFd = other.mNotifyFd;
+            for (size_t i = 0; i < doorbell_state::EVENTFDS; ++i) {
+                mCached[i] = other.mCached[i];
+                other.mCached[i] = cached_eventfd{0, -1, false};
+            }
+
+            other.mState = nullptr;
+            other.mRegistered = 0;
+            other.mOwnedFd = -1;
+            other.mNotifyFd = -1;
+        }
+        return *this;
+    }
+
+    void shm_doorbell::ring() noexcept
+    {
+        if (mState == nullptr)
+            return;
+
+        /*
+         * Pairs with the RMW in prepare_sleep(): either we see the sleeper, or
+         * the sleeper sees what was published before this call.
+         */
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (mState->sleepers.load(std::memory_order_acquire) == 0)
+            return;
+
+        mState->sequence.fetch_add(1, std::memory_order_release);
+        futex_wake_all(mState->sequence);
+
+#if defined(__linux__)
+        if (mNotifyFd != -1)
+            signal_eventfd(mNotifyFd);
+        for (size_t i = 0; i < doorbell_state::EVENTFDS; ++i) {
+            uint64_t registration = mState->eventfds[i].load(std::memory_order_acquire);
+            if (registration == 0)
+                continue;
+            int fd = registered_fd(i, registration);
+            if (fd != -1)
+                signal_eventfd(fd);
+        }
+#endif
+    }
+
+    void shm_doorbell::prepare_sleep() noexcept
+    {
+        if (mState != nullptr)
+            mState->sleepers.fetch_add(1, std::memory_order_seq_cst);
+    }
+
+    void shm_doorbell::finish_sleep() noexcept
+    {
+        if (mState != nullptr)
+            mState->sleepers.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    int shm_doorbell::make_eventfd()
+    {
+#if defined(__linux__)
+        int fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (fd == -1)
+            throw runtime_error(std::string("eventfd() failed: ") + std::strerror(errno));
+        use_eventfd(fd);
+        if (mOwnedFd != -1)
+            ::close(mOwnedFd);
+        mOwnedFd = fd;
+        return fd;
+#else
+        throw runtime_error("eventfd() is not supported on this platform");
+#endif
+    }
+
+    bool shm_doorbell::use_eventfd(int fd) noexcept
+    {
+#if defined(__linux__)
+        if (mState == nullptr)
+            return false;
+        uint64_t registration = (fd == -1) ? 0 : make_registration(fd);
+        if (mRegistered != 0 && mRegistered != registration) {
+            /* Only drop the registration if it's still ours. */
+            for (auto& slot : mState->eventfds) {
+                uint64_t expected = mRegistered;
+                slot.compare_exchange_strong(expected, 0, std::memory_order_acq_rel);
+            }
+        }
+        mRegistered = registration;
+        if (fd == -1)
+            return true;
+
+        for (auto& slot : mState->eventfds) {
+            if (slot.load(std::memory_order_acquire) == registration)
+                return true;
+        }
+        for (auto& slot : mState->eventfds) {
+            uint64_t expected = 0;
+            if (slot.compare_exchange_strong(expected, registration, std::memory_order_acq_rel))
+                return true;
+        }
+        /* Full: take the slot of a consumer that died without unregistering. */
+        for (auto& slot : mState->eventfds) {
+            uint64_t expected = slot.load(std::memory_order_acquire);
+            if (registrant_gone(expected) && slot.compare_exchange_strong(expected, registration, std::memory_order_acq_rel))
+                return true;
+        }
+        return false;
+#else
+        (void)fd;
+        return false;
+#endif
+    }
+
+    void shm_doorbell::notify_eventfd(int fd) noexcept
+    {
+        mNotifyFd = fd;
+    }
+
+    doorbell_state* shm_doorbell::state() const noexcept
+    {
+        return mState;
+    }
+
+    int shm_doorbell::registered_fd(size_t slot, uint64_t registration) noexcept
+    {
+#if defined(__linux__)
+        cached_eventfd& cached = mCached[slot];
+        if (registration == cached.registration)
+            return cached.fd;
+
+        int pid = static_cast<int>(registration >> 32);
+        int fd = static_cast<int>(registration & 0xffffffff);
+        int copy = fd;
+        bool owned = false;
+        if (pid != ::getpid()) {
+            bool stale = false;
+            try {
+                copy = duplicate_fd(pid, fd);
+                owned = true;
+            } catch (const std::system_error& ex) {
+                int error = ex.code().value();
+                stale = (error == ESRCH || error == EBADF || error == ENOENT);
+                copy = -1;
+            } catch (...) {
+                copy = -1;
+            }
+            if (copy != -1 && !is_eventfd(copy)) {
+                ::close(copy);
+                copy = -1;
+                owned = false;
+                stale = true;
+            }
+            if (stale) {
+                /* The consumer died or closed it. The futex wake still reaches everyone else. */
+                mState->eventfds[slot].compare_exchange_strong(registration, 0, std::memory_order_acq_rel);
+                return -1;
+            }
+            /*
+             * Otherwise the consumer is alive but we may not take its
+             * descriptor, e.g. EPERM under Yama ptrace_scope. Keep the
+             * registration and remember the failure, so later rings don't
+             * retry until it changes.
+             */
+        }
+
+        if (cached.owned)
+            ::close(cached.fd);
+        cached = cached_eventfd{registration, copy, owned};
+        return copy;
+#else
+        (void)slot;
+        (void)registration;
+        return -1;
+#endif
+    }
+
+    void shm_doorbell::release() noexcept
+    {
+        use_eventfd(-1);
+#if defined(__linux__)
+        if (mOwnedFd != -1)
+            ::close(mOwnedFd);
+        for (auto& cached : mCached) {
+            if (cached.owned)
+                ::close(cached.fd);
+        }
+#endif
+        mOwnedFd = -1;
+        for (auto& cached : mCached)
+            cached = cached_eventfd{0, -1, false};
+    }
+
+    void drain_eventfd(int fd) noexcept
+    {
+#if defined(__linux__)
+        uint64_t count;
+        while (::read(fd, &count, sizeof(count)) == -1 && errno == EINTR) {
+        }
+#else
+        (void)fd;
+#endif
+    }
+
+} // namespace pshm
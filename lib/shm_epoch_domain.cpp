@@ -0,0 +1,231 @@
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include <pshm/shm_epoch_domain.hpp>
+
+#include <cerrno>
+
+#include <signal.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+using std::invalid_argument;
+using std::runtime_error;
+
+namespace
+{
+    using pshm::epoch_domain_control;
+    using pshm::epoch_slot;
+    using pshm::retired_entry;
+    using size_type = pshm::shm_object::size_type;
+
+    size_type round_capacity(size_type capacity) noexcept
+    {
+        size_type n = 1;
+        while (n < capacity)
+            n <<= 1;
+        return n;
+    }
+
+    std::unique_ptr<pshm::shm_object> open_domain(const std::string& name, pshm::flags_t flags, size_type slots, size_type capacity)
+    {
+        if ((flags & pshm::flags::RDWR) == 0)
+            throw invalid_argument("an epoch domain requires flags::RDWR");
+        if (slots == 0 || capacity == 0)
+            throw invalid_argument("an epoch domain needs at least one participant and one retire entry each");
+
+        uint64_t hash = pshm::layout_hash<epoch_domain_control>();
+        hash = pshm::fnv1a_mix(hash, pshm::layout_hash<epoch_slot>());
+        hash = pshm::fnv1a_mix(hash, pshm::layout_hash<retired_entry>());
+        hash = pshm::fnv1a_mix(hash, slots);
+        hash = pshm::fnv1a_mix(hash, capacity);
+        size_type size = sizeof(epoch_domain_control) + slots * sizeof(epoch_slot) + slots * capacity * sizeof(retired_entry);
+        pshm::segment_layout layout{size, 64, hash};
+        return std::unique_ptr<pshm::shm_object>(
+            pshm::make_shm_object(name, flags | pshm::flags::HEADER, layout.size, 0, layout));
+    }
+
+    /**
+     * @returns false only if pid certainly doesn't exist. EPERM means it
+     * does, just not as ours to signal.
+     */
+    bool alive(uint64_t pid) noexcept
+    {
+        return ::kill(static_cast<pid_t>(pid), 0) == 0 || errno != ESRCH;
+    }
+
+    constexpr size_type none = ~size_type(0);
+} // namespace
+
+namespace pshm
+{
+    shm_epoch_domain::shm_epoch_domain(const string_type& name, flags_type flags, size_type participants, size_type retire_capacity, reclaim_function reclaim)
+        : mObject(open_domain(name, flags, participants, round_capacity(retire_capacity)))
+        , mControl(static_cast<epoch_domain_control*>(mObject->get()))
+        , mSlots(reinterpret_cast<epoch_slot*>(mControl + 1))
+        , mEntries(reinterpret_cast<retired_entry*>(mSlots + participants))
+        , mSlotCount(participants)
+        , mCapacity(round_capacity(retire_capacity))
+        , mReclaim(std::move(reclaim))
+        , mPid(static_cast<uint64_t>(::getpid()))
+        , mSlot(none)
+        , mDepth(0)
+    {
+        for (size_type i = 0; i < mSlotCount && mSlot == none; ++i) {
+            uint64_t free = 0;
+            if (mSlots[i].owner.compare_exchange_strong(free, mPid, std::memory_order_acquire))
+                mSlot = i;
+        }
+        if (mSlot == none && recover() != 0) {
+            /* Take over a dead participant's slot, retire list and all. */
+            mSlot = mAdopted.back();
+            mAdopted.pop_back();
+        }
+        if (mSlot == none)
+            throw runtime_error("every slot of epoch domain " + name + " is taken");
+    }
+
+    shm_epoch_domain::~shm_epoch_domain()
+    {
+        mDepth = 0;
+        mSlots[mSlot].epoch.store(0, std::memory_order_release);
+        reclaim();
+        for (size_type i : mAdopted)
+            mSlots[i].owner.store(0, std::memory_order_release);
+        mSlots[mSlot].owner.store(0, std::memory_order_release);
+    }
+
+    void shm_epoch_domain::enter() noexcept
+    {
+        if (mDepth++ != 0)
+            return;
+        uint64_t e = mControl->epoch.load(std::memory_order_relaxed);
+        mSlots[mSlot].epoch.store(e << 1 | 1, std::memory_order_relaxed);
+        /* The announcement must be visible before we read anything it protects. */
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+
+    void shm_epoch_domain::leave() noexcept
+    {
+        if (--mDepth == 0)
+            mSlots[mSlot].epoch.store(0, std::memory_order_release);
+    }
+
+    bool shm_epoch_domain::active() const noexcept
+    {
+        return mDepth != 0;
+    }
+
+    void shm_epoch_domain::retire(uint64_t offset)
+    {
+        epoch_slot& s = mSlots[mSlot];
+        /* Reclaiming a node takes two advances after it was retired. */
+        for (int attempt = 0; s.tail - s.head == mCapacity && attempt < 3; ++attempt)
+            reclaim();
+        if (s.tail - s.head == mCapacity)
+            throw std::length_error("epoch domain retire list is full: a participant is holding the epoch back");
+
+        retired_entry& r = mEntries[mSlot * mCapacity + (s.tail & (mCapacity - 1))];
+        r.offset = offset;
+        r.epoch = mControl->epoch.load(std::memory_order_seq_cst);
+        s.tail++;
+    }
+
+    shm_epoch_domain::size_type shm_epoch_domain::reclaim()
+    {
+        try_advance();
+
+        size_type n = collect(mSlot);
+        for (auto it = mAdopted.begin(); it != mAdopted.end();) {
+            n += collect(*it);
+            epoch_slot& s = mSlots[*it];
+            if (s.head == s.tail) {
+                s.owner.store(0, std::memory_order_release);
+                it = mAdopted.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        return n;
+    }
+
+    shm_epoch_domain::size_type shm_epoch_domain::recover()
+    {
+        size_type n = 0;
+        for (size_type i = 0; i < mSlotCount; ++i) {
+            uint64_t owner = mSlots[i].owner.load(std::memory_order_acquire);
+            if (owner != 0 && owner != mPid && !alive(owner) && adopt(i, owner))
+                n++;
+        }
+        return n;
+    }
+
+    uint64_t shm_epoch_domain::epoch() const noexcept
+    {
+        return mControl->epoch.load(std::memory_order_acquire);
+    }
+
+    shm_epoch_domain::size_type shm_epoch_domain::pending() const noexcept
+    {
+        size_type n = mSlots[mSlot].tail - mSlots[mSlot].head;
+        for (size_type i : mAdopted)
+            n += mSlots[i].tail - mSlots[i].head;
+        return n;
+    }
+
+    shm_epoch_domain::size_type shm_epoch_domain::slot() const noexcept
+    {
+        return mSlot;
+    }
+
+    bool shm_epoch_domain::try_advance()
+    {
+        /* Pairs with the fence in enter(). */
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        uint64_t e = mControl->epoch.load(std::memory_order_relaxed);
+
+        for (size_type i = 0; i < mSlotCount; ++i) {
+            uint64_t owner = mSlots[i].owner.load(std::memory_order_acquire);
+            if (owner == 0)
+                continue;
+            uint64_t announced = mSlots[i].epoch.load(std::memory_order_relaxed);
+            if ((announced & 1) == 0 || (announced >> 1) == e)
+                continue;
+            /* Only now is it worth a system call: this one is holding us up. */
+            if (owner != mPid && !alive(owner) && adopt(i, owner))
+                continue;
+            return false;
+        }
+
+        mControl->epoch.compare_exchange_strong(e, e + 1, std::memory_order_acq_rel);
+        return true;
+    }
+
+    bool shm_epoch_domain::adopt(size_type i, uint64_t owner)
+    {
+        if (!mSlots[i].owner.compare_exchange_strong(owner, mPid, std::memory_order_acquire))
+            return false;
+        mSlots[i].epoch.store(0, std::memory_order_release);
+        mAdopted.push_back(i);
+        return true;
+    }
+
+    shm_epoch_domain::size_type shm_epoch_domain::collect(size_type i)
+    {
+        const uint64_t e = mControl->epoch.load(std::memory_order_acquire);
+        epoch_slot& s = mSlots[i];
+        size_type n = 0;
+        while (s.head != s.tail) {
+            const retired_entry& r = mEntries[i * mCapacity + (s.head & (mCapacity - 1))];
+            if (r.epoch + 2 > e)
+                break;
+            uint64_t offset = r.offset;
+            /* Pop first: dying here leaks one node rather than freeing it twice. */
+            s.head++;
+            mReclaim(offset);
+            n++;
+        }
+        return n;
+    }
+
+} // namespace pshm
@@ -0,0 +1,60 @@
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include <pshm/shm_latch.hpp>
+
+using std::invalid_argument;
+
+namespace
+{
+    using pshm::latch_control;
+
+    std::unique_ptr<pshm::shm_object> open_latch(const std::string& name, pshm::flags_t flags, uint64_t count)
+    {
+        if ((flags & pshm::flags::RDWR) == 0)
+            throw invalid_argument("a latch requires flags::RDWR");
+
+        uint64_t hash = pshm::fnv1a_mix(pshm::layout_hash<latch_control>(), count);
+        pshm::segment_layout layout{sizeof(latch_control), alignof(latch_control), hash};
+        return std::unique_ptr<pshm::shm_object>(
+            pshm::make_shm_object(name, flags | pshm::flags::HEADER, layout.size, 0, layout));
+    }
+} // namespace
+
+namespace pshm
+{
+    shm_latch::shm_latch(const string_type& name, flags_type flags, uint64_t count)
+        : mObject(open_latch(name, flags, count))
+        , mControl(static_cast<latch_control*>(mObject->get()))
+        , mDoorbell(&mControl->doorbell)
+        , mCount(count)
+    {
+    }
+
+    void shm_latch::count_down(uint64_t n)
+    {
+        if (n == 0)
+            return;
+        uint64_t before = mControl->arrived.fetch_add(n, std::memory_order_acq_rel);
+        /* Only the one that crosses the count has anybody to wake. */
+        if (before < mCount && before + n >= mCount)
+            mDoorbell.ring();
+    }
+
+    bool shm_latch::try_wait() const noexcept
+    {
+        return mControl->arrived.load(std::memory_order_acquire) >= mCount;
+    }
+
+    uint64_t shm_latch::remaining() const noexcept
+    {
+        uint64_t arrived = mControl->arrived.load(std::memory_order_acquire);
+        return arrived >= mCount ? 0 : mCount - arrived;
+    }
+
+    uint64_t shm_latch::count() const noexcept
+    {
+        return mCount;
+    }
+
+} // namespace pshm
@@ -44,6 +44,11 @@ namespace pshm
         return mOffset;
     }
 
+    void shm_object::advise(advice hint)
+    {
+        advise(0, size(), hint);
+    }
+
     shm_object::string_type shm_object::make_error(const string_type& msg) const
     {
         string_type s;
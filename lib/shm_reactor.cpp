@@ -0,0 +1,147 @@
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include <pshm/shm_reactor.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+using std::runtime_error;
+using std::string;
+
+namespace
+{
+    /**
+     * Longest epoll_wait() in ms. Ends the sleep when a producer rang but
+     * couldn't signal the eventfd, e.g. because it may not duplicate it.
+     */
+    constexpr int POLL_INTERVAL = 100;
+
+    /** Same when a doorbell had no slot left for the eventfd. */
+    constexpr int UNREGISTERED_POLL_INTERVAL = 5;
+} // namespace
+
+namespace pshm
+{
+    shm_reactor::shm_reactor(scheduler_type scheduler)
+        : mScheduler(std::move(scheduler))
+        , mEventFd(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+        , mEpollFd(-1)
+        , mStopping(false)
+    {
+        if (mEventFd == -1)
+            throw runtime_error(string("eventfd() failed: ") + std::strerror(errno));
+
+        mEpollFd = ::epoll_create1(EPOLL_CLOEXEC);
+        if (mEpollFd == -1) {
+            int error = errno;
+            ::close(mEventFd);
+            throw runtime_error(string("epoll_create1() failed: ") + std::strerror(error));
+        }
+
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.fd = mEventFd;
+        if (::epoll_ctl(mEpollFd, EPOLL_CTL_ADD, mEventFd, &ev) == -1) {
+            int error = errno;
+            ::close(mEpollFd);
+            ::close(mEventFd);
+            throw runtime_error(string("epoll_ctl() failed: ") + std::strerror(error));
+        }
+
+        mThread = std::thread(&shm_reactor::run, this);
+    }
+
+    shm_reactor::~shm_reactor()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStopping = true;
+        }
+        uint64_t one = 1;
+        while (::write(mEventFd, &one, sizeof(one)) == -1 && errno == EINTR) {
+        }
+        mThread.join();
+        ::close(mEpollFd);
+        ::close(mEventFd);
+    }
+
+    void shm_reactor::watch(shm_doorbell& bell, predicate_type ready, std::coroutine_handle<> handle)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mIncoming.push_back(waiter{&bell, std::move(ready), handle});
+        }
+        uint64_t one = 1;
+        while (::write(mEventFd, &one, sizeof(one)) == -1 && errno == EINTR) {
+        }
+    }
+
+    int shm_reactor::eventfd() const noexcept
+    {
+        return mEventFd;
+    }
+
+    void shm_reactor::run()
+    {
+        std::vector<waiter> waiting;
+        std::vector<std::coroutine_handle<>> runnable;
+
+        for (;;) {
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                if (mStopping)
+                    return;
+                std::move(mIncoming.begin(), mIncoming.end(), std::back_inserter(waiting));
+                mIncoming.clear();
+            }
+
+            /*
+             * Register before announcing the sleep, and announce it before
+             * checking, so nothing rung after the check is lost. Registering
+             * again puts back whatever a producer dropped.
+             */
+            int timeout = waiting.empty() ? -1 : POLL_INTERVAL;
+            for (auto& w : waiting) {
+                if (!w.bell->use_eventfd(mEventFd))
+                    timeout = UNREGISTERED_POLL_INTERVAL;
+                w.bell->prepare_sleep();
+            }
+
+            auto ready = std::stable_partition(waiting.begin(), waiting.end(), [](waiter& w) { return !w.ready(); });
+            bool idle = (ready == waiting.end());
+            if (idle) {
+                struct epoll_event ev;
+                while (::epoll_wait(mEpollFd, &ev, 1, timeout) == -1 && errno == EINTR) {
+                }
+            }
+
+            for (auto& w : waiting)
+                w.bell->finish_sleep();
+            drain_eventfd(mEventFd);
+
+            if (!idle) {
+                for (auto it = ready; it != waiting.end(); ++it)
+                    runnable.push_back(it->handle);
+                waiting.erase(ready, waiting.end());
+                for (auto h : runnable)
+                    resume(h);
+                runnable.clear();
+            }
+        }
+    }
+
+    void shm_reactor::resume(std::coroutine_handle<> handle)
+    {
+        if (mScheduler)
+            mScheduler(handle);
+        else
+            handle.resume();
+    }
+
+} // namespace pshm
@@ -0,0 +1,15 @@
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include <pshm/shm_rpc_channel.hpp>
+
+namespace pshm
+{
+    constexpr uint32_t rpc_slot_header::FREE;
+    constexpr uint32_t rpc_slot_header::CLAIMED;
+    constexpr uint32_t rpc_slot_header::REQUEST;
+    constexpr uint32_t rpc_slot_header::SERVING;
+    constexpr uint32_t rpc_slot_header::RESPONSE;
+    constexpr uint32_t rpc_slot_header::FAILED;
+
+} // namespace pshm
@@ -0,0 +1,188 @@
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include <pshm/shm_shared_mutex.hpp>
+
+#include <pshm/cpu_relax.hpp>
+#include <pshm/futex.hpp>
+
+using std::invalid_argument;
+
+namespace
+{
+    using pshm::shared_mutex_control;
+    using pshm::shared_mutex_slot;
+    using size_type = pshm::shm_object::size_type;
+
+    /** Checks to spin for before sleeping on a futex. */
+    constexpr uint32_t spin_budget = 100;
+
+    /** Writer word values. */
+    constexpr uint32_t FREE = 0;
+    constexpr uint32_t HELD = 1;
+    constexpr uint32_t SLEEPERS = 2;
+
+    size_type round_slots(size_type slots) noexcept
+    {
+        size_type n = 1;
+        while (n < slots)
+            n <<= 1;
+        return n;
+    }
+
+    std::unique_ptr<pshm::shm_object> open_mutex(const std::string& name, pshm::flags_t flags, size_type slots)
+    {
+        if ((flags & pshm::flags::RDWR) == 0)
+            throw invalid_argument("a shared mutex requires flags::RDWR");
+
+        uint64_t hash = pshm::layout_hash<shared_mutex_control>();
+        hash = pshm::fnv1a_mix(hash, pshm::layout_hash<shared_mutex_slot>());
+        hash = pshm::fnv1a_mix(hash, slots);
+        pshm::segment_layout layout{sizeof(shared_mutex_control) + slots * sizeof(shared_mutex_slot), 64, hash};
+        return std::unique_ptr<pshm::shm_object>(
+            pshm::make_shm_object(name, flags | pshm::flags::HEADER, layout.size, 0, layout));
+    }
+
+    /**
+     * @brief Small per thread number, so threads sharing a handle use
+     * different slots.
+     */
+    uint32_t thread_ordinal() noexcept
+    {
+        static std::atomic<uint32_t> next{0};
+        thread_local uint32_t mine = next.fetch_add(1, std::memory_order_relaxed);
+        return mine;
+    }
+} // namespace
+
+namespace pshm
+{
+    shm_shared_mutex::shm_shared_mutex(const string_type& name, flags_type flags, size_type slots)
+        : mObject(open_mutex(name, flags, round_slots(slots)))
+        , mControl(static_cast<shared_mutex_control*>(mObject->get()))
+        , mSlots(reinterpret_cast<shared_mutex_slot*>(mControl + 1))
+        , mSlotCount(round_slots(slots))
+        , mBase(mControl->next_slot.fetch_add(1, std::memory_order_relaxed))
+    {
+    }
+
+    void shm_shared_mutex::lock()
+    {
+        uint32_t c = FREE;
+        bool held = mControl->writer.compare_exchange_strong(c, HELD);
+        for (uint32_t i = 0; !held && i < spin_budget; ++i) {
+            cpu_relax();
+            c = FREE;
+            if (mControl->writer.load(std::memory_order_relaxed) == FREE)
+                held = mControl->writer.compare_exchange_strong(c, HELD);
+        }
+        if (!held) {
+            /* Somebody could be asleep from here on, so claim it as SLEEPERS. */
+            c = mControl->writer.exchange(SLEEPERS);
+            while (c != FREE) {
+                futex_wait(mControl->writer, SLEEPERS);
+                c = mControl->writer.exchange(SLEEPERS);
+            }
+        }
+
+        /* The writer word is ours, so no new readers get in. Wait out the old ones. */
+        for (size_type i = 0; i < mSlotCount; ++i)
+            wait_for_readers(mSlots[i]);
+    }
+
+    bool shm_shared_mutex::try_lock() noexcept
+    {
+        uint32_t c = FREE;
+        if (!mControl->writer.compare_exchange_strong(c, HELD))
+            return false;
+        for (size_type i = 0; i < mSlotCount; ++i) {
+            if (mSlots[i].readers.load() != 0) {
+                unlock();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void shm_shared_mutex::unlock() noexcept
+    {
+        /* Readers and writers both sleep on the writer word. */
+        if (mControl->writer.exchange(FREE) == SLEEPERS)
+            futex_wake_all(mControl->writer);
+    }
+
+    void shm_shared_mutex::lock_shared()
+    {
+        shared_mutex_slot& slot = my_slot();
+        for (;;) {
+            /* Pairs with the writer claiming the word then reading the slots. */
+            slot.readers.fetch_add(1);
+            if (mControl->writer.load() == FREE)
+                return;
+            leave(slot);
+            wait_for_writer();
+        }
+    }
+
+    bool shm_shared_mutex::try_lock_shared() noexcept
+    {
+        shared_mutex_slot& slot = my_slot();
+        slot.readers.fetch_add(1);
+        if (mControl->writer.load() == FREE)
+            return true;
+        leave(slot);
+        return false;
+    }
+
+    void shm_shared_mutex::unlock_shared() noexcept
+    {
+        leave(my_slot());
+    }
+
+    shm_shared_mutex::size_type shm_shared_mutex::slots() const noexcept
+    {
+        return mSlotCount;
+    }
+
+    shared_mutex_slot& shm_shared_mutex::my_slot() const noexcept
+    {
+        return mSlots[(mBase + thread_ordinal()) & (mSlotCount - 1)];
+    }
+
+    void shm_shared_mutex::leave(shared_mutex_slot& slot) noexcept
+    {
+        /* Only the reader that empties the slot can be the one a writer waits on. */
+        if (slot.readers.fetch_sub(1) == 1 && mControl->writer.load() != FREE)
+            futex_wake_all(slot.readers);
+    }
+
+    void shm_shared_mutex::wait_for_writer() noexcept
+    {
+        for (uint32_t i = 0;; ++i) {
+            uint32_t c = mControl->writer.load(std::memory_order_acquire);
+            if (c == FREE)
+                return;
+            if (i < spin_budget) {
+                cpu_relax();
+                continue;
+            }
+            if (c == HELD && !mControl->writer.compare_exchange_weak(c, SLEEPERS))
+                continue;
+            futex_wait(mControl->writer, SLEEPERS);
+        }
+    }
+
+    void shm_shared_mutex::wait_for_readers(shared_mutex_slot& slot) noexcept
+    {
+        for (uint32_t i = 0;; ++i) {
+            uint32_t n = slot.readers.load();
+            if (n == 0)
+                return;
+            if (i < spin_budget)
+                cpu_relax();
+            else
+                futex_wait(slot.readers, n);
+        }
+    }
+
+} // namespace pshm
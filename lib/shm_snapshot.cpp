@@ -0,0 +1,169 @@
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include <pshm/shm_snapshot.hpp>
+
+#include <pshm/residency.hpp>
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using std::invalid_argument;
+using std::runtime_error;
+using std::string;
+
+namespace
+{
+    string make_error(const string& msg, const string& name, int error)
+    {
+        return msg + ": " + name + ": " + std::strerror(error);
+    }
+
+    constexpr uint64_t writers_mask = 0xffffffffull;
+
+    /**
+     * @brief Give each page of a private mapping its own copy.
+     */
+    void break_cow(void* address, size_t length) noexcept
+    {
+#if defined(MADV_POPULATE_WRITE)
+        if (::madvise(address, length, MADV_POPULATE_WRITE) == 0)
+            return;
+#endif
+        /* Older kernels: write every page to itself. */
+        const size_t page = pshm::page_size();
+        volatile uint8_t* p = static_cast<volatile uint8_t*>(address);
+        for (size_t i = 0; i < length; i += page)
+            p[i] = p[i];
+    }
+} // namespace
+
+namespace pshm
+{
+    shm_snapshot::shm_snapshot(const shm_object& live, mode m, unsigned attempts)
+        : mLive(live)
+        , mMode(m)
+        , mAttempts(attempts == 0 ? 1 : attempts)
+        , mFile(-1)
+        , mMapping(nullptr)
+        , mMappingSize(0)
+        , mPointer(nullptr)
+        , mEpoch(0)
+    {
+        if (live.header() == nullptr)
+            throw invalid_argument("shm_snapshot requires flags::HEADER: " + live.name());
+        mMappingSize = static_cast<size_type>(live.header()->payload_offset + live.size());
+
+        mFile = ::shm_open(mLive.name().c_str(), O_RDONLY | O_CLOEXEC, 0);
+        if (mFile == -1)
+            throw runtime_error(make_error("shm_open() failed", mLive.name(), errno));
+        try {
+            take();
+        } catch (...) {
+            ::close(mFile);
+            throw;
+        }
+    }
+
+    shm_snapshot::~shm_snapshot()
+    {
+        release();
+        ::close(mFile);
+    }
+
+    const void* shm_snapshot::get() const noexcept
+    {
+        return mPointer;
+    }
+
+    shm_snapshot::size_type shm_snapshot::size() const noexcept
+    {
+        return mLive.size();
+    }
+
+    uint64_t shm_snapshot::epoch() const noexcept
+    {
+        return mEpoch;
+    }
+
+    shm_snapshot::mode shm_snapshot::snapshot_mode() const noexcept
+    {
+        return mMode;
+    }
+
+    bool shm_snapshot::valid() const noexcept
+    {
+        if (mMode == mode::frozen)
+            return true;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return mLive.header()->write_epoch.load(std::memory_order_relaxed) == mEpoch;
+    }
+
+    void shm_snapshot::refresh()
+    {
+        release();
+        take();
+    }
+
+    uint64_t shm_snapshot::quiet_epoch() const noexcept
+    {
+        const std::atomic<uint64_t>& epoch = mLive.header()->write_epoch;
+        uint64_t e = epoch.load(std::memory_order_acquire);
+        for (int spins = 0; (e & writers_mask) != 0 && spins < 1000; ++spins) {
+            std::this_thread::yield();
+            e = epoch.load(std::memory_order_acquire);
+        }
+        return e;
+    }
+
+    void shm_snapshot::take()
+    {
+        const string_type n = mLive.name();
+        const uint64_t payload_offset = mLive.header()->payload_offset;
+        const int prot = mMode == mode::frozen ? PROT_READ | PROT_WRITE : PROT_READ;
+
+        for (unsigned attempt = 0; attempt < mAttempts; ++attempt) {
+            uint64_t before = quiet_epoch();
+            if ((before & writers_mask) != 0)
+                continue;
+
+            void* p = ::mmap(nullptr, mMappingSize, prot, MAP_PRIVATE, mFile, 0);
+            if (p == MAP_FAILED)
+                throw runtime_error(make_error("mmap() failed", n, errno));
+
+            if (mMode == mode::frozen) {
+                break_cow(p, mMappingSize);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (mLive.header()->write_epoch.load(std::memory_order_relaxed) != before) {
+                    ::munmap(p, mMappingSize);
+                    continue;
+                }
+                ::mprotect(p, mMappingSize, PROT_READ);
+            }
+
+            mMapping = p;
+            mPointer = static_cast<const uint8_t*>(p) + payload_offset;
+            mEpoch = before;
+            register_mapping(n, mMapping, mMappingSize);
+            return;
+        }
+        throw runtime_error("writes kept overlapping the snapshot: " + n);
+    }
+
+    void shm_snapshot::release() noexcept
+    {
+        if (mMapping == nullptr)
+            return;
+        unregister_mapping(mMapping);
+        ::munmap(mMapping, mMappingSize);
+        mMapping = nullptr;
+        mPointer = nullptr;
+    }
+
+} // namespace pshm
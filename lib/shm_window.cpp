@@ -0,0 +1,319 @@
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include <pshm/shm_window.hpp>
+
+#include <pshm/residency.hpp>
+
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using std::invalid_argument;
+using std::runtime_error;
+using std::string;
+
+namespace
+{
+    string make_error(const string& msg, const string& name, int error)
+    {
+        return msg + ": " + name + ": " + std::strerror(error);
+    }
+
+    /**
+     * @brief Fault in the page tables of a mapping without touching it.
+     */
+    void populate(void* address, size_t length) noexcept
+    {
+#if defined(MADV_POPULATE_READ)
+        if (::madvise(address, length, MADV_POPULATE_READ) == 0)
+            return;
+#endif
+        ::madvise(address, length, MADV_WILLNEED);
+    }
+} // namespace
+
+namespace pshm
+{
+    /**
+     * @brief Maps the next window and unmaps the last one off the reader's
+     * thread.
+     */
+    class shm_window::prefetcher
+    {
+      public:
+        explicit prefetcher(const shm_window& window)
+            : mWindow(window)
+            , mWanted(false)
+            , mReady(false)
+            , mStopping(false)
+            , mHaveRetired(false)
+            , mThread(&prefetcher::run, this)
+        {
+            mNext.address = nullptr;
+            mRetired.address = nullptr;
+        }
+
+        ~prefetcher()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mStopping = true;
+            }
+            mWake.notify_one();
+            mThread.join();
+            mWindow.unmap_window(mNext);
+            mWindow.unmap_window(mRetired);
+        }
+
+        /**
+         * @brief Start mapping the window at offset. Discards any other.
+         */
+        void request(uint64_t offset)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                /* A seek went somewhere else: the last prefetch is wasted. */
+                mWindow.unmap_window(mNext);
+                mWantedOffset = offset;
+                mWanted = true;
+                mReady = false;
+            }
+            mWake.notify_one();
+        }
+
+        /**
+         * @brief Take the window at offset if it was requested.
+         *
+         * @returns true and sets m if it was, waiting for it if needed.
+         */
+        bool take(uint64_t offset, mapping& m)
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            if (!mWanted || mWantedOffset != offset)
+                return false;
+            mDone.wait(lock, [this] { return mReady; });
+            mWanted = false;
+            mReady = false;
+            if (mNext.address == nullptr) {
+                /* Map it synchronously and report the error from there. */
+                return false;
+            }
+            m = mNext;
+            mNext.address = nullptr;
+            return true;
+        }
+
+        /**
+         * @brief Unmap m in the background.
+         */
+        void retire(mapping& m)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                if (mHaveRetired)
+                    mWindow.unmap_window(mRetired);
+                mRetired = m;
+                mHaveRetired = true;
+            }
+            m.address = nullptr;
+            mWake.notify_one();
+        }
+
+      private:
+        const shm_window& mWindow;
+        std::mutex mMutex;
+        std::condition_variable mWake;
+        std::condition_variable mDone;
+        uint64_t mWantedOffset;
+        bool mWanted;
+        bool mReady;
+        bool mStopping;
+        mapping mNext;
+        mapping mRetired;
+        bool mHaveRetired;
+        std::thread mThread;
+
+        void run()
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            for (;;) {
+                mWake.wait(lock, [this] { return mStopping || mHaveRetired || (mWanted && !mReady); });
+                if (mStopping)
+                    return;
+
+                if (mHaveRetired) {
+                    mapping old = mRetired;
+                    mHaveRetired = false;
+                    mRetired.address = nullptr;
+                    lock.unlock();
+                    mWindow.unmap_window(old);
+                    lock.lock();
+                    continue;
+                }
+
+                uint64_t offset = mWantedOffset;
+                lock.unlock();
+                mapping m{nullptr, 0, offset};
+                try {
+                    m = mWindow.map_window(offset);
+                    populate(m.address, m.length);
+                } catch (std::exception&) {
+                    /* Escaping would terminate: take() maps it again and reports the error. */
+                    m.address = nullptr;
+                }
+                lock.lock();
+
+                if (mWanted && mWantedOffset == offset && !mReady) {
+                    mNext = m;
+                    mReady = true;
+                    mDone.notify_all();
+                } else {
+                    /* Superseded by a seek while we were mapping. */
+                    mWindow.unmap_window(m);
+                }
+            }
+        }
+    };
+
+    shm_window::shm_window(const string_type& name, flags_type flags, size_type window_size, bool prefetch)
+        : mName(name.empty() || name.front() == '/' ? name : "/" + name)
+        , mFile(-1)
+        , mProt(PROT_READ)
+        , mObjectSize(0)
+        , mWindowSize(window_size)
+        , mCurrent{nullptr, 0, 0}
+    {
+        if (name.empty())
+            throw invalid_argument("shared memory object requires a name");
+        if (window_size == 0 || window_size % page_size() != 0)
+            throw invalid_argument("shm_window size must be a multiple of the page size: " + mName);
+
+        int f = O_RDONLY;
+        if (flags & flags::RDWR) {
+            f = O_RDWR;
+            mProt |= PROT_WRITE;
+        }
+        mFile = ::shm_open(mName.c_str(), f | O_CLOEXEC, 0600);
+        if (mFile == -1)
+            throw runtime_error(make_error("shm_open() failed", mName, errno));
+
+        struct stat st;
+        if (::fstat(mFile, &st) != 0) {
+            int error = errno;
+            ::close(mFile);
+            throw runtime_error(make_error("fstat() failed", mName, error));
+        }
+        mObjectSize = static_cast<uint64_t>(st.st_size);
+
+        if (prefetch)
+            mPrefetcher.reset(new prefetcher(*this));
+
+        try {
+            seek(0);
+        } catch (...) {
+            mPrefetcher.reset();
+            ::close(mFile);
+            throw;
+        }
+    }
+
+    shm_window::~shm_window()
+    {
+        mPrefetcher.reset();
+        unmap_window(mCurrent);
+        if (mFile != -1)
+            ::close(mFile);
+    }
+
+    bool shm_window::seek(uint64_t offset)
+    {
+        if (offset % page_size() != 0)
+            throw invalid_argument("shm_window offset must be a multiple of the page size: " + mName);
+
+        mapping next{nullptr, 0, offset};
+        if (offset < mObjectSize) {
+            if (!mPrefetcher || !mPrefetcher->take(offset, next))
+                next = map_window(offset);
+        }
+
+        if (mPrefetcher)
+            mPrefetcher->retire(mCurrent);
+        else
+            unmap_window(mCurrent);
+        mCurrent = next;
+
+        if (mCurrent.address == nullptr)
+            return false;
+        if (mPrefetcher && offset + mWindowSize < mObjectSize)
+            mPrefetcher->request(offset + mWindowSize);
+        return true;
+    }
+
+    bool shm_window::advance()
+    {
+        return seek(mCurrent.offset + mWindowSize);
+    }
+
+    void* shm_window::data() const noexcept
+    {
+        return mCurrent.address;
+    }
+
+    shm_window::size_type shm_window::size() const noexcept
+    {
+        return mCurrent.address == nullptr ? 0 : mCurrent.length;
+    }
+
+    uint64_t shm_window::offset() const noexcept
+    {
+        return mCurrent.offset;
+    }
+
+    uint64_t shm_window::object_size() const noexcept
+    {
+        return mObjectSize;
+    }
+
+    shm_window::size_type shm_window::window_size() const noexcept
+    {
+        return mWindowSize;
+    }
+
+    shm_window::string_type shm_window::name() const
+    {
+        return mName;
+    }
+
+    shm_window::mapping shm_window::map_window(uint64_t offset) const
+    {
+        size_type length = static_cast<size_type>(std::min<uint64_t>(mWindowSize, mObjectSize - offset));
+        void* p = ::mmap(nullptr, length, mProt, MAP_SHARED, mFile, static_cast<off_t>(offset));
+        if (p == MAP_FAILED)
+            throw runtime_error(make_error("mmap() failed", mName, errno));
+        try {
+            register_mapping(mName, p, length);
+        } catch (...) {
+            ::munmap(p, length);
+            throw;
+        }
+        return mapping{p, length, offset};
+    }
+
+    void shm_window::unmap_window(mapping& m) const noexcept
+    {
+        if (m.address == nullptr)
+            return;
+        unregister_mapping(m.address);
+        ::munmap(m.address, m.length);
+        m.address = nullptr;
+    }
+
+} // namespace pshm
@@ -0,0 +1,100 @@
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include "./testing.hpp"
+
+#include <pshm/shared_segment.hpp>
+
+#include <chrono>
+#include <thread>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace
+{
+    /** Not trivial: has to be built by its constructor. */
+    struct config_block {
+        std::atomic<uint32_t> readers;
+        uint32_t version;
+        char label[16];
+        uint32_t done;
+
+        config_block(uint32_t v, const char* l)
+            : readers(0)
+            , version(v)
+            , label{}
+            , done(0)
+        {
+            std::strncpy(label, l, sizeof(label) - 1);
+            /* Give a racing attacher the chance to see a half built object. */
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            done = 0xd0d0;
+        }
+    };
+
+    struct throws_block {
+        uint32_t value;
+
+        explicit throws_block(bool fail)
+            : value(1)
+        {
+            if (fail)
+                throw runtime_error("constructor failed");
+        }
+    };
+
+    void check(const string& name, const pshm::shared_segment<config_block>& seg)
+    {
+        if (seg->done != 0xd0d0 || seg->version != 7 || string(seg->label) != "pricing")
+            throw TestFailure(name, "attached to a half built object");
+    }
+} // namespace
+
+void run_test(const string& name)
+{
+    pid_t kid = fork();
+    if (kid == -1)
+        throw runtime_error(string("fork() failed: ") + strerror(errno));
+
+    if (kid == 0) {
+        auto seg = pshm::make_shared_segment<config_block>(name, 7u, "pricing");
+        bool ok = seg->done == 0xd0d0 && seg->version == 7;
+        seg->readers.fetch_add(1);
+        _exit(ok ? (seg.created() ? 10 : 20) : EXIT_FAILURE);
+    }
+
+    auto seg = pshm::make_shared_segment<config_block>(name, 7u, "pricing");
+    check(name, seg);
+    seg->readers.fetch_add(1);
+
+    int wstatus;
+    if (waitpid(kid, &wstatus, 0) != kid || !WIFEXITED(wstatus))
+        throw TestFailure(name, "child failed");
+    int code = WEXITSTATUS(wstatus);
+    if (code != 10 && code != 20)
+        throw TestFailure(name, "child attached to a half built object");
+
+    bool child_created = (code == 10);
+    cout << "parent created " << seg.created() << ", child created " << child_created << endl;
+    if (seg.created() == child_created)
+        throw TestFailure(name, "the object must be constructed exactly once");
+    if (seg->readers.load() != 2)
+        throw TestFailure(name, "both processes should share one object");
+    /* Only the creator unlinks, and the child _exit()ed without destructors. */
+    if (child_created)
+        pshm::shm_object_native::unlink(name);
+
+    /* A constructor that throws leaves nothing behind. */
+    string failing = name + "_throws";
+    try {
+        pshm::make_shared_segment<throws_block>(failing, true);
+        throw TestFailure(name, "constructor exception was swallowed");
+    } catch (runtime_error& ex) {
+        cout << "expected: " << ex.what() << endl;
+    }
+    auto again = pshm::make_shared_segment<throws_block>(failing, false);
+    if (!again.created() || again->value != 1)
+        throw TestFailure(name, "segment wasn't recreated after a failed constructor");
+}
@@ -0,0 +1,54 @@
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include "./testing.hpp"
+
+#include <pshm/shared_copy.hpp>
+
+namespace
+{
+    /**
+     * @brief Copy n bytes between the given misalignments and check every byte,
+     * including the guard bytes around the destination.
+     */
+    void check_copy(const string& name, size_t n, size_t src_offset, size_t dst_offset)
+    {
+        vector<uint8_t> src(n + 64);
+        vector<uint8_t> dst(n + 128, 0xee);
+        for (size_t i = 0; i < src.size(); ++i)
+            src[i] = static_cast<uint8_t>(i * 131 + 7);
+
+        pshm::streaming_copy(dst.data() + 64 + dst_offset, src.data() + src_offset, n);
+
+        for (size_t i = 0; i < dst.size(); ++i) {
+            bool inside = i >= 64 + dst_offset && i < 64 + dst_offset + n;
+            uint8_t want = inside ? src[i - 64 - dst_offset + src_offset] : 0xee;
+            if (dst[i] != want)
+                throw TestFailure(name, "copying " + to_string(n) + " bytes from +" + to_string(src_offset)
+                                            + " to +" + to_string(dst_offset) + " is wrong at byte " + to_string(i));
+        }
+    }
+} // namespace
+
+void run_test(const string& name)
+{
+    cout << "streaming_copy uses " << pshm::streaming_copy_isa() << endl;
+
+    const size_t sizes[] = {0, 1, 15, 16, 63, 64, 127, 128, 129, 255, 256, 1000, 4096, 65537};
+    for (size_t n : sizes) {
+        for (size_t src_offset : {0, 1, 8, 33})
+            for (size_t dst_offset : {0, 1, 16, 63})
+                check_copy(name, n, src_offset, dst_offset);
+    }
+
+    /* Both sides of the threshold through the public entry points. */
+    for (size_t n : {pshm::streaming_copy_threshold - 1, pshm::streaming_copy_threshold + 3}) {
+        vector<uint8_t> src(n), shared(n), back(n);
+        for (size_t i = 0; i < n; ++i)
+            src[i] = static_cast<uint8_t>(i ^ (i >> 8));
+        pshm::copy_to_shared(shared.data() + 0, src.data(), n);
+        pshm::copy_from_shared(back.data(), shared.data(), n);
+        if (back != src)
+            throw TestFailure(name, "round trip of " + to_string(n) + " bytes doesn't match");
+    }
+}
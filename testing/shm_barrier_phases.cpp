@@ -0,0 +1,120 @@
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include "./testing.hpp"
+
+#include <pshm/shm_barrier.hpp>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace
+{
+    constexpr size_t participants = 5;
+    constexpr uint32_t phases = 200;
+
+    /**
+     * @brief Count into each phase's slot, then check everyone else did too
+     * before moving on.
+     *
+     * @returns the number of phases that were left early.
+     */
+    template <class Barrier>
+    uint32_t run_phases(Barrier& barrier, std::atomic<uint32_t>* counts)
+    {
+        uint32_t early = 0;
+        for (uint32_t p = 0; p < phases; ++p) {
+            counts[p].fetch_add(1, std::memory_order_relaxed);
+            barrier.arrive_and_wait();
+            if (counts[p].load(std::memory_order_relaxed) != participants)
+                early++;
+        }
+        return early;
+    }
+
+    /**
+     * @brief Run the phases in participants processes, the parent being id 0.
+     *
+     * @param open makes the barrier for a participant id.
+     */
+    template <class Open>
+    void in_processes(const string& name, const string& what, Open open)
+    {
+        using pshm::flags;
+
+        cout << what << endl;
+        shm_object_unique_ptr counts_object(pshm::make_shm_object(name + "_counts", flags::RDWR | flags::CREAT, phases * sizeof(uint32_t), 0));
+        auto* counts = static_cast<std::atomic<uint32_t>*>(counts_object->get());
+        std::fill(counts, counts + phases, 0);
+
+        auto barrier = open(0);
+        std::vector<pid_t> kids;
+        for (size_t id = 1; id < participants; ++id) {
+            pid_t kid = fork();
+            if (kid == -1)
+                throw runtime_error(string("fork() failed: ") + strerror(errno));
+            if (kid == 0) {
+                auto mine = open(id);
+                _exit(run_phases(*mine, counts) == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+            }
+            kids.push_back(kid);
+        }
+
+        uint32_t early = run_phases(*barrier, counts);
+        for (pid_t kid : kids) {
+            int wstatus;
+            if (waitpid(kid, &wstatus, 0) != kid || !WIFEXITED(wstatus) || WEXITSTATUS(wstatus) != 0)
+                throw TestFailure(name, what + ": a child left a phase early or failed");
+        }
+        if (early != 0)
+            throw TestFailure(name, what + ": the parent left " + to_string(early) + " phases early");
+        if (barrier->phase() != phases)
+            throw TestFailure(name, what + ": phase() is " + to_string(barrier->phase()));
+    }
+} // namespace
+
+void run_test(const string& name)
+{
+    using pshm::flags;
+
+    in_processes(name, "Flat barrier", [&name](size_t) {
+        return std::make_unique<pshm::shm_barrier>(name, flags::RDWR | flags::CREAT, participants);
+    });
+    in_processes(name + "_tree", "Tree barrier", [&name](size_t id) {
+        return std::make_unique<pshm::shm_tree_barrier>(name + "_tree", flags::RDWR | flags::CREAT, participants, id, 2);
+    });
+
+    cout << "Split arrive and wait" << endl;
+    pshm::shm_tree_barrier first(name + "_split", flags::RDWR | flags::CREAT, 2, 0, 2);
+    pshm::shm_tree_barrier second(name + "_split", flags::RDWR, 2, 1, 2);
+    if (first.depth() != 0)
+        throw TestFailure(name, "Two participants shouldn't need any inner nodes");
+    uint32_t phase = first.arrive();
+    pshm::spin_park park(10);
+    if (first.wait_for(phase, park, std::chrono::milliseconds(10)) || first.completed(phase))
+        throw TestFailure(name, "A phase completed with one of two arrived");
+    second.arrive();
+    if (!first.wait_for(phase, park, std::chrono::seconds(5)) || first.phase() != phase + 1)
+        throw TestFailure(name, "The last arrival didn't complete the phase");
+
+    pshm::shm_tree_barrier deep(name + "_deep", flags::RDWR | flags::CREAT, 100, 99, 4);
+    if (deep.depth() != 3)
+        throw TestFailure(name, "100 participants with a fan in of 4 should be 3 levels deep, not " + to_string(deep.depth()));
+
+    try {
+        pshm::shm_tree_barrier wrong(name + "_split", flags::RDWR, 3, 1, 2);
+        throw TestFailure(name, "Attaching with another participant count should fail");
+    } catch (runtime_error&) {
+    }
+    try {
+        pshm::shm_tree_barrier bad_id(name + "_split", flags::RDWR, 2, 2, 2);
+        throw TestFailure(name, "An out of range id should fail");
+    } catch (std::invalid_argument&) {
+    }
+    try {
+        pshm::shm_barrier read_only(name, flags::RDONLY, participants);
+        throw TestFailure(name, "A read only barrier should fail");
+    } catch (std::invalid_argument&) {
+    }
+}
@@ -0,0 +1,69 @@
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include "./testing.hpp"
+
+#include <pshm/shm_bitset.hpp>
+
+void run_test(const string& name)
+{
+    using pshm::flags;
+    using word = pshm::shm_bitset::word_type;
+
+    cout << "Bit operations use " << pshm::bit_ops_isa() << endl;
+
+    pshm::shm_bitset bits(name, flags::RDWR | flags::CREAT, 5000);
+    pshm::shm_bitset other(name, flags::RDWR, 5000);
+    if (bits.size() != 5120 || bits.word_count() != 80)
+        throw TestFailure(name, "5000 bits should round up to 5120");
+
+    if (!bits.set(3) || bits.set(3) || !other.test(3))
+        throw TestFailure(name, "set() should change the bit once, visibly");
+    if (!other.reset(3) || other.reset(3) || bits.test(3))
+        throw TestFailure(name, "reset() should change the bit once, visibly");
+    try {
+        bits.set(bits.size());
+        throw TestFailure(name, "set() past the end should fail");
+    } catch (std::out_of_range&) {
+    }
+
+    cout << "Counting" << endl;
+    for (size_t i = 0; i < bits.size(); i += 3)
+        bits.set(i);
+    size_t expected = (bits.size() + 2) / 3;
+    if (bits.count() != expected || pshm::popcount_words(reinterpret_cast<const word*>(other.words()), other.word_count()) != expected)
+        throw TestFailure(name, "count() is " + to_string(bits.count()) + " but expected " + to_string(expected));
+
+    cout << "Merging" << endl;
+    std::vector<word> local(bits.word_count(), 0);
+    /* Already set bits only: nothing should change. */
+    local[0] = 1 | (1 << 3);
+    if (bits.merge_or(local.data(), local.size()) != 0)
+        throw TestFailure(name, "merge_or() of bits already set changed something");
+    /* One new bit in word 0 and one in the last chunk. */
+    local[0] |= 2;
+    local[79] = word(1) << 63;
+    if (bits.merge_or(local.data(), local.size()) != 2)
+        throw TestFailure(name, "merge_or() should change exactly two words");
+    if (!other.test(1) || !other.test(bits.size() - 1) || bits.count() != expected + 2)
+        throw TestFailure(name, "merge_or() lost bits");
+
+    std::vector<word> snapshot(bits.word_count());
+    other.copy_to(snapshot.data(), snapshot.size());
+    if (bits.merge_and(snapshot.data(), snapshot.size()) != 0)
+        throw TestFailure(name, "merge_and() with itself changed something");
+    if (bits.merge_and(local.data(), local.size()) != bits.word_count())
+        throw TestFailure(name, "merge_and() should change every word");
+    if (bits.count() != 4 || !bits.test(0) || !bits.test(1) || !bits.test(3) || bits.test(6))
+        throw TestFailure(name, "merge_and() left the wrong bits");
+
+    try {
+        bits.merge_or(local.data(), local.size() - 1);
+        throw TestFailure(name, "merge_or() of the wrong size should fail");
+    } catch (std::invalid_argument&) {
+    }
+
+    bits.clear();
+    if (other.count() != 0)
+        throw TestFailure(name, "clear() left bits set");
+}
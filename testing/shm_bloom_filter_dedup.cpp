@@ -0,0 +1,65 @@
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include "./testing.hpp"
+
+#include <pshm/shm_bloom_filter.hpp>
+
+void run_test(const string& name)
+{
+    using pshm::flags;
+    using filter = pshm::shm_bloom_filter<uint64_t>;
+    const size_t keys = 10000;
+
+    filter seen(name, flags::RDWR | flags::CREAT, keys * 10);
+    filter other(name, flags::RDONLY, keys * 10);
+
+    cout << "Inserting one at a time" << endl;
+    /* A false positive makes a first insert look like a duplicate. */
+    size_t duplicates = 0;
+    for (uint64_t id = 0; id < keys; ++id)
+        duplicates += !seen.insert(id);
+    if (duplicates > keys / 100)
+        throw TestFailure(name, "Too many first inserts reported duplicates: " + to_string(duplicates));
+    for (uint64_t id = 0; id < keys; ++id) {
+        if (seen.insert(id) || !other.contains(id))
+            throw TestFailure(name, "Inserted key " + to_string(id) + " went missing");
+    }
+
+    size_t false_positives = 0;
+    for (uint64_t id = keys; id < 2 * keys; ++id)
+        false_positives += other.contains(id);
+    cout << "False positives: " << false_positives << " in " << keys << endl;
+    if (false_positives > keys / 50)
+        throw TestFailure(name, "Too many false positives: " + to_string(false_positives));
+
+    double estimate = other.estimated_size();
+    if (estimate < keys * 0.9 || estimate > keys * 1.1)
+        throw TestFailure(name, "estimated_size() is " + to_string(estimate));
+
+    cout << "Merging a local filter" << endl;
+    filter::local_type local(keys * 10);
+    for (uint64_t id = 2 * keys; id < 3 * keys; ++id)
+        local.insert(id);
+    if (!local.contains(2 * keys))
+        throw TestFailure(name, "Local filter doesn't hold its keys");
+    if (seen.merge(local) == 0)
+        throw TestFailure(name, "merge() changed nothing");
+    for (uint64_t id = 2 * keys; id < 3 * keys; ++id) {
+        if (!other.contains(id))
+            throw TestFailure(name, "Merged key " + to_string(id) + " is missing");
+    }
+    if (seen.merge(local) != 0)
+        throw TestFailure(name, "Merging twice changed something");
+
+    try {
+        seen.merge(filter::local_type(keys));
+        throw TestFailure(name, "Merging a filter of another size should fail");
+    } catch (std::invalid_argument&) {
+    }
+    try {
+        filter fewer(name, flags::RDONLY, keys * 10, 3);
+        throw TestFailure(name, "Opening with different hashes should fail");
+    } catch (runtime_error&) {
+    }
+}
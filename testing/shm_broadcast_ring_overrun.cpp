@@ -0,0 +1,52 @@
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include "./testing.hpp"
+
+#include <pshm/shm_broadcast_ring.hpp>
+
+using status = pshm::shm_broadcast_subscriber::status;
+
+void run_test(const string& name)
+{
+    using pshm::flags;
+    constexpr size_t capacity = 256;
+    constexpr uint64_t count = 64;
+
+    pshm::shm_broadcast_ring ring(name, flags::RDWR | flags::CREAT, capacity);
+    pshm::shm_broadcast_subscriber slow(name, flags::RDONLY, capacity);
+
+    uint64_t value = 0;
+    ring.publish(&value, sizeof(value));
+
+    pshm::shm_broadcast_subscriber::record first;
+    if (slow.next(first) != status::ok)
+        throw TestFailure(name, "first record missing");
+
+    cout << "Publishing " << count << " records without reading them" << endl;
+    for (value = 1; value <= count; ++value)
+        ring.publish(&value, sizeof(value));
+
+    if (slow.valid(first))
+        throw TestFailure(name, "first record has been overwritten but valid() returned true");
+
+    pshm::shm_broadcast_subscriber::record rec;
+    if (slow.next(rec) != status::overrun)
+        throw TestFailure(name, "slow subscriber should see status::overrun");
+
+    cout << "Reading what is left after the overrun" << endl;
+    uint64_t last = 0;
+    uint64_t seen = 0;
+    while (slow.next(rec) == status::ok) {
+        if (rec.length != sizeof(uint64_t))
+            throw TestFailure(name, "record has length " + to_string(rec.length));
+        memcpy(&last, rec.data, sizeof(last));
+        seen++;
+    }
+
+    if (last != count)
+        throw TestFailure(name, "last value is " + to_string(last) + " but " + to_string(count) + " was expected");
+    if (slow.dropped() + seen != count)
+        throw TestFailure(name, "dropped() is " + to_string(slow.dropped()) + " and " + to_string(seen) + " records were read, but " + to_string(count) + " were published");
+    cout << "Dropped " << slow.dropped() << " and read " << seen << endl;
+}
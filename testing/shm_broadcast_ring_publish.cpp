@@ -0,0 +1,99 @@
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include "./testing.hpp"
+
+#include <pshm/shm_broadcast_ring.hpp>
+
+using status = pshm::shm_broadcast_subscriber::status;
+
+/**
+ * @brief Read every pending record and compare them against expected.
+ */
+void check_records(const string& name, pshm::shm_broadcast_subscriber& sub, const vector<string>& expected)
+{
+    pshm::shm_broadcast_subscriber::record rec;
+
+    for (size_t i = 0; i < expected.size(); ++i) {
+        status st = sub.next(rec);
+        if (st != status::ok)
+            throw TestFailure(name, "record " + to_string(i) + ": next() didn't return status::ok");
+        string got(static_cast<const char*>(rec.data), rec.length);
+        if (got != expected[i])
+            throw TestFailure(name, "record " + to_string(i) + " is \"" + got + "\" but \"" + expected[i] + "\" was expected");
+        if (rec.sequence != i)
+            throw TestFailure(name, "record " + to_string(i) + " has sequence " + to_string(rec.sequence));
+        if (!sub.valid(rec))
+            throw TestFailure(name, "record " + to_string(i) + " should still be valid");
+    }
+
+    if (sub.next(rec) != status::empty)
+        throw TestFailure(name, "next() should return status::empty after the last record");
+}
+
+void run_test(const string& name)
+{
+    using pshm::flags;
+    constexpr size_t capacity = 256;
+
+    cout << "Creating broadcast ring " << name << endl;
+    pshm::shm_broadcast_ring ring(name, flags::RDWR | flags::CREAT, capacity);
+    pshm::shm_broadcast_subscriber first(name, flags::RDONLY, capacity);
+    pshm::shm_broadcast_subscriber second(name, flags::RDONLY, capacity);
+
+    pshm::shm_broadcast_subscriber::record rec;
+    if (first.next(rec) != status::empty)
+        throw TestFailure(name, "new ring should be empty");
+
+    /* Enough to wrap around once without overrunning either subscriber. */
+    vector<string> expected = {"Hello", "", "a somewhat longer record that takes a few lines", "x"};
+    for (const string& s : expected)
+        ring.publish(s.data(), s.size());
+
+    cout << "Checking both subscribers see every record" << endl;
+    check_records(name, first, expected);
+    check_records(name, second, expected);
+
+    cout << "Checking records wrap around the end of the ring" << endl;
+    string big(ring.max_record_size() / 2, 'w');
+    for (size_t i = 0; i < 3; ++i) {
+        ring.publish(big.data(), big.size());
+        if (first.next(rec) != status::ok)
+            throw TestFailure(name, "wrapped record " + to_string(i) + " missing");
+        if (rec.length != big.size() || memcmp(rec.data, big.data(), big.size()) != 0)
+            throw TestFailure(name, "wrapped record " + to_string(i) + " is corrupt");
+    }
+    if (first.dropped() != 0)
+        throw TestFailure(name, "first subscriber should not have dropped anything");
+
+    cout << "Checking the capacity must match" << endl;
+    try {
+        pshm::shm_broadcast_subscriber wrong(name, flags::RDONLY, capacity * 2);
+        throw TestFailure(name, "subscriber with the wrong capacity should fail to attach");
+    } catch (runtime_error& ex) {
+        cout << "Good, got expected runtime_error: " << ex.what() << endl;
+    }
+
+    try {
+        string huge(capacity, 'h');
+        ring.publish(huge.data(), huge.size());
+        throw TestFailure(name, "publishing a record larger than max_record_size() should fail");
+    } catch (std::invalid_argument& ex) {
+        cout << "Good, got expected invalid_argument: " << ex.what() << endl;
+    }
+
+    if (sizeof(size_t) > 4) {
+        cout << "Checking record lengths fit their 32 bit header field" << endl;
+        /* Sparse, so only the pages that are touched cost anything. */
+        const size_t huge_capacity = size_t(1) << 33;
+        pshm::shm_broadcast_ring wide(name + "_wide", flags::RDWR | flags::CREAT, huge_capacity);
+        if (wide.max_record_size() > UINT32_MAX)
+            throw TestFailure(name, "max_record_size() allows lengths the header can't hold");
+        try {
+            wide.publish(nullptr, wide.max_record_size() + 1);
+            throw TestFailure(name, "publishing a record longer than UINT32_MAX bytes should fail");
+        } catch (std::invalid_argument& ex) {
+            cout << "Good, got expected invalid_argument: " << ex.what() << endl;
+        }
+    }
+}
@@ -0,0 +1,68 @@
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include "./testing.hpp"
+
+#include <pshm/shm_cache.hpp>
+
+void run_test(const string& name)
+{
+    using pshm::flags;
+    using cache_type = pshm::shm_cache<uint64_t, uint64_t>;
+
+    /* A single set makes the eviction order predictable. */
+    cache_type cache(name, flags::RDWR | flags::CREAT, cache_type::WAYS);
+    cache_type other(name, flags::RDWR, cache_type::WAYS);
+
+    if (cache.capacity() != cache_type::WAYS)
+        throw TestFailure(name, "capacity() is " + to_string(cache.capacity()));
+
+    cout << "Filling the cache" << endl;
+    for (uint64_t k = 0; k < cache_type::WAYS; ++k) {
+        if (!cache.put(k, k * 10))
+            throw TestFailure(name, "put(" + to_string(k) + ") should insert");
+    }
+    if (cache.put(0, 0))
+        throw TestFailure(name, "put() of an existing key should replace it");
+
+    cout << "Touching the even keys" << endl;
+    for (uint64_t k = 2; k < cache_type::WAYS; k += 2) {
+        uint64_t v = 0;
+        if (!other.get(k, v) || v != k * 10)
+            throw TestFailure(name, "get(" + to_string(k) + ") should hit with " + to_string(k * 10));
+    }
+
+    cout << "Inserting new keys to force evictions" << endl;
+    constexpr uint64_t extra = cache_type::WAYS / 2;
+    for (uint64_t k = 100; k < 100 + extra; ++k)
+        cache.put(k, k);
+
+    /* Key 0 was replaced by put() so it counts as used too. */
+    uint64_t v = 0;
+    for (uint64_t k = 0; k < cache_type::WAYS; k += 2) {
+        if (!other.get(k, v))
+            throw TestFailure(name, "recently used key " + to_string(k) + " was evicted");
+    }
+    for (uint64_t k = 1; k < cache_type::WAYS; k += 2) {
+        if (other.get(k, v))
+            throw TestFailure(name, "unused key " + to_string(k) + " should have been evicted");
+    }
+    for (uint64_t k = 100; k < 100 + extra; ++k) {
+        if (!other.get(k, v) || v != k)
+            throw TestFailure(name, "new key " + to_string(k) + " missing");
+    }
+
+    if (!cache.erase(100) || other.get(100, v))
+        throw TestFailure(name, "erase(100) should remove the key");
+
+    pshm::cache_stats st = other.stats();
+    cout << "hits " << st.hits << " misses " << st.misses << " inserts " << st.inserts << " evictions " << st.evictions << endl;
+    if (st.inserts != cache_type::WAYS + extra)
+        throw TestFailure(name, "inserts is " + to_string(st.inserts));
+    if (st.evictions != extra)
+        throw TestFailure(name, "evictions is " + to_string(st.evictions) + " but " + to_string(extra) + " was expected");
+    if (st.misses != cache_type::WAYS / 2 + 1)
+        throw TestFailure(name, "misses is " + to_string(st.misses));
+    if (st.hits != (cache_type::WAYS / 2 - 1) + cache_type::WAYS / 2 + extra)
+        throw TestFailure(name, "hits is " + to_string(st.hits));
+}
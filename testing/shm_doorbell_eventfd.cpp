@@ -0,0 +1,174 @@
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include "./testing.hpp"
+
+#include <pshm/fd_passing.hpp>
+#include <pshm/shm_broadcast_ring.hpp>
+
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace
+{
+    constexpr size_t capacity = 4096;
+    constexpr int count = 3;
+
+    /**
+     * @returns the number of ready events after waiting up to timeout ms.
+     */
+    int poll(int epfd, int timeout)
+    {
+        struct epoll_event ev;
+        int n;
+        do {
+            n = epoll_wait(epfd, &ev, 1, timeout);
+        } while (n == -1 && errno == EINTR);
+        if (n == -1)
+            throw runtime_error(string("epoll_wait() failed: ") + strerror(errno));
+        return n;
+    }
+} // namespace
+
+void run_test(const string& name)
+{
+    using pshm::flags;
+
+    pshm::shm_broadcast_subscriber sub(name, flags::RDWR | flags::CREAT, capacity);
+    int efd = sub.doorbell().make_eventfd();
+
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd == -1)
+        throw runtime_error(string("epoll_create1() failed: ") + strerror(errno));
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.fd = efd;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, efd, &ev) == -1)
+        throw runtime_error(string("epoll_ctl() failed: ") + strerror(errno));
+
+    pshm::shm_broadcast_ring ring(name, flags::RDWR, capacity);
+
+    /* Nobody asleep: publishing must leave the eventfd alone. */
+    {
+        ring.publish("busy", 4);
+        if (poll(epfd, 0) != 0)
+            throw TestFailure(name, "publish() signalled the eventfd without a sleeper");
+
+        pshm::shm_broadcast_subscriber::record rec;
+        if (sub.next(rec) != pshm::shm_broadcast_subscriber::status::ok)
+            throw TestFailure(name, "record published without a sleeper is missing");
+
+        sub.doorbell().prepare_sleep();
+        ring.publish("sleepy", 6);
+        sub.doorbell().finish_sleep();
+        if (poll(epfd, 0) != 1)
+            throw TestFailure(name, "publish() didn't signal the eventfd of a sleeper");
+        pshm::drain_eventfd(efd);
+        if (sub.next(rec) != pshm::shm_broadcast_subscriber::status::ok)
+            throw TestFailure(name, "record published to a sleeper is missing");
+    }
+
+    /* Another process publishes, with the eventfd handed over a socket. */
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) == -1)
+        throw runtime_error(string("socketpair() failed: ") + strerror(errno));
+
+    pid_t kid = fork();
+    if (kid == -1)
+        throw runtime_error(string("fork() failed: ") + strerror(errno));
+
+    if (kid == 0) {
+        close(sv[0]);
+        int fd = pshm::receive_fd(sv[1]);
+        pshm::shm_broadcast_ring writer(name, flags::RDWR, capacity);
+        writer.doorbell().notify_eventfd(fd);
+        for (int i = 0; i < count; ++i) {
+            usleep(20000);
+            writer.publish(&i, sizeof(i));
+        }
+        _exit(EXIT_SUCCESS);
+    }
+    close(sv[1]);
+    pshm::send_fd(sv[0], efd);
+    close(sv[0]);
+
+    int received = 0;
+    while (received < count) {
+        pshm::shm_broadcast_subscriber::record rec;
+        sub.doorbell().prepare_sleep();
+        if (!sub.pending() && poll(epfd, 5000) == 0)
+            throw TestFailure(name, "timed out waiting on the eventfd after " + to_string(received) + " records");
+        sub.doorbell().finish_sleep();
+        pshm::drain_eventfd(efd);
+
+        while (sub.next(rec) == pshm::shm_broadcast_subscriber::status::ok) {
+            int value;
+            std::memcpy(&value, rec.data, sizeof(value));
+            if (value != received)
+                throw TestFailure(name, "got record " + to_string(value) + " but " + to_string(received) + " was expected");
+            received++;
+        }
+    }
+
+    int wstatus;
+    if (waitpid(kid, &wstatus, 0) != kid || !WIFEXITED(wstatus) || WEXITSTATUS(wstatus) != 0)
+        throw TestFailure(name, "child failed");
+
+    /* Two consumers register their own eventfds and both are signalled. */
+    {
+        pshm::doorbell_state state;
+        std::memset(static_cast<void*>(&state), 0, sizeof(state));
+        pshm::shm_doorbell first(&state);
+        pshm::shm_doorbell second(&state);
+        int efd1 = first.make_eventfd();
+        int efd2 = second.make_eventfd();
+        if (!first.use_eventfd(efd1) || state.eventfds[0].load() == 0 || state.eventfds[1].load() == 0 || state.eventfds[2].load() != 0)
+            throw TestFailure(name, "registering again didn't keep one slot per consumer");
+
+        state.sleepers = 1;
+        pshm::shm_doorbell producer(&state);
+        producer.ring();
+        uint64_t value;
+        if (read(efd1, &value, sizeof(value)) != sizeof(value) || read(efd2, &value, sizeof(value)) != sizeof(value))
+            throw TestFailure(name, "ring() didn't signal every registered eventfd");
+
+        second.use_eventfd(-1);
+        if (state.eventfds[1].load() != 0 || state.eventfds[0].load() == 0)
+            throw TestFailure(name, "unregistering dropped the wrong eventfd");
+    }
+
+    /* A consumer died with its eventfd registered: ringing must not throw. */
+    {
+        pid_t dead = fork();
+        if (dead == -1)
+            throw runtime_error(string("fork() failed: ") + strerror(errno));
+        if (dead == 0)
+            _exit(EXIT_SUCCESS);
+        if (waitpid(dead, &wstatus, 0) != dead)
+            throw TestFailure(name, "waitpid() failed");
+
+        /* Only errors like this one may cost a consumer its registration. */
+        try {
+            close(pshm::duplicate_fd(dead, efd));
+            throw TestFailure(name, "duplicate_fd() took a descriptor from a dead process");
+        } catch (std::system_error& ex) {
+            if (ex.code().value() != ESRCH && ex.code().value() != ENOENT)
+                throw TestFailure(name, string("duplicate_fd() reported the wrong error: ") + ex.what());
+        }
+
+        pshm::doorbell_state state;
+        std::memset(static_cast<void*>(&state), 0, sizeof(state));
+        state.eventfds[0] = (static_cast<uint64_t>(dead) << 32) | static_cast<uint32_t>(efd);
+        state.sleepers = 1;
+        pshm::shm_doorbell bell(&state);
+        bell.ring();
+        if (state.eventfds[0].load() != 0)
+            throw TestFailure(name, "ring() kept a stale eventfd registration");
+        if (state.sequence.load() != 1)
+            throw TestFailure(name, "ring() didn't bump the sequence for the futex sleepers");
+    }
+    close(epfd);
+}
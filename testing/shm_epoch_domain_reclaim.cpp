@@ -0,0 +1,112 @@
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include "./testing.hpp"
+
+#include <pshm/shm_epoch_domain.hpp>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace
+{
+    constexpr size_t participants = 4;
+    constexpr size_t capacity = 8;
+
+    /** Advances the epoch until nothing more comes back. */
+    size_t drain(pshm::shm_epoch_domain& domain)
+    {
+        size_t n = 0;
+        for (int i = 0; i < 4; ++i)
+            n += domain.reclaim();
+        return n;
+    }
+} // namespace
+
+void run_test(const string& name)
+{
+    using pshm::flags;
+
+    std::vector<uint64_t> freed;
+    auto record = [&freed](uint64_t offset) { freed.push_back(offset); };
+
+    pshm::shm_epoch_domain writer(name, flags::RDWR | flags::CREAT, participants, capacity, record);
+
+    cout << "Nobody reading" << endl;
+    writer.retire(100);
+    writer.retire(101);
+    if (writer.pending() != 2 || writer.reclaim() != 0)
+        throw TestFailure(name, "Retired values must wait two epochs");
+    if (drain(writer) != 2 || freed != std::vector<uint64_t>{100, 101} || writer.pending() != 0)
+        throw TestFailure(name, "Retired values weren't reclaimed in order");
+
+    cout << "A reader holds the epoch back" << endl;
+    freed.clear();
+    {
+        pshm::shm_epoch_domain reader(name, flags::RDWR, participants, capacity, record);
+        if (reader.slot() == writer.slot())
+            throw TestFailure(name, "Two participants share a slot");
+        pshm::shm_epoch_domain::guard pin(reader);
+        writer.retire(200);
+        drain(writer);
+        if (!freed.empty())
+            throw TestFailure(name, "Reclaimed a value while a reader could hold it");
+    }
+    if (drain(writer) != 1 || freed != std::vector<uint64_t>{200})
+        throw TestFailure(name, "The value wasn't reclaimed after the reader left");
+
+    cout << "A full retire list" << endl;
+    freed.clear();
+    {
+        pshm::shm_epoch_domain reader(name, flags::RDWR, participants, capacity, record);
+        reader.enter();
+        try {
+            for (uint64_t v = 0; v <= capacity; ++v)
+                writer.retire(300 + v);
+            throw TestFailure(name, "Retiring into a full list should fail while a reader is pinned");
+        } catch (std::length_error& ex) {
+            cout << "expected: " << ex.what() << endl;
+        }
+        reader.leave();
+    }
+    drain(writer);
+    if (freed.size() != capacity || writer.pending() != 0)
+        throw TestFailure(name, "The full list wasn't reclaimed after the reader left");
+
+    cout << "A reader dies in a critical section" << endl;
+    freed.clear();
+    pid_t kid = fork();
+    if (kid == -1)
+        throw runtime_error(string("fork() failed: ") + strerror(errno));
+    if (kid == 0) {
+        pshm::shm_epoch_domain doomed(name, flags::RDWR, participants, capacity, [](uint64_t) {});
+        doomed.enter();
+        doomed.retire(400);
+        _exit(EXIT_SUCCESS);
+    }
+    int wstatus;
+    if (waitpid(kid, &wstatus, 0) != kid || !WIFEXITED(wstatus) || WEXITSTATUS(wstatus) != 0)
+        throw TestFailure(name, "child failed");
+
+    writer.retire(401);
+    drain(writer);
+    std::sort(freed.begin(), freed.end());
+    if (freed != std::vector<uint64_t>{400, 401})
+        throw TestFailure(name, "The dead reader's slot wasn't adopted and reclaimed");
+    if (writer.pending() != 0)
+        throw TestFailure(name, "Values are still pending");
+
+    cout << "Every slot taken" << endl;
+    {
+        std::vector<std::unique_ptr<pshm::shm_epoch_domain>> others;
+        for (size_t i = 1; i < participants; ++i)
+            others.push_back(std::make_unique<pshm::shm_epoch_domain>(name, flags::RDWR, participants, capacity, record));
+        try {
+            pshm::shm_epoch_domain one_too_many(name, flags::RDWR, participants, capacity, record);
+            throw TestFailure(name, "Joined with every slot taken");
+        } catch (runtime_error& ex) {
+            cout << "expected: " << ex.what() << endl;
+        }
+    }
+}
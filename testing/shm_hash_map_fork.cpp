@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include "./testing.hpp"
+
+#include <pshm/shm_hash_map.hpp>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace
+{
+    using map_type = pshm::shm_hash_map<uint32_t, uint32_t>;
+    constexpr size_t capacity = 4096;
+    constexpr uint32_t count = 2000;
+
+    /**
+     * @brief Insert every key, counting how many this process inserted.
+     *
+     * Both processes insert the same keys at the same time, so each key must
+     * end up inserted by exactly one of them.
+     */
+    uint32_t insert_all(map_type& map, uint32_t who)
+    {
+        uint32_t inserted = 0;
+        for (uint32_t k = 0; k < count; ++k) {
+            if (map.insert(k, who))
+                inserted++;
+            map.update(k, [](uint32_t& v) { v |= 0x100; });
+        }
+        return inserted;
+    }
+} // namespace
+
+void run_test(const string& name)
+{
+    using pshm::flags;
+
+    map_type map(name, flags::RDWR | flags::CREAT, capacity);
+    pshm::shm_hash_map<uint32_t, uint32_t> results(name + "_results", flags::RDWR | flags::CREAT, 16);
+
+    pid_t kid = fork();
+    if (kid == -1)
+        throw runtime_error(string("fork() failed: ") + strerror(errno));
+
+    if (kid == 0) {
+        uint32_t n = insert_all(map, 2);
+        results.insert(2, n);
+        _exit(EXIT_SUCCESS);
+    }
+
+    uint32_t mine = insert_all(map, 1);
+    int wstatus;
+    if (waitpid(kid, &wstatus, 0) != kid || !WIFEXITED(wstatus) || WEXITSTATUS(wstatus) != 0)
+        throw TestFailure(name, "child failed");
+
+    uint32_t theirs = 0;
+    if (!results.find(2, theirs))
+        throw TestFailure(name, "child didn't report how many keys it inserted");
+
+    cout << "parent inserted " << mine << ", child inserted " << theirs << endl;
+    if (mine + theirs != count)
+        throw TestFailure(name, "keys were inserted " + to_string(mine + theirs) + " times but " + to_string(count) + " was expected");
+    if (map.size() != count)
+        throw TestFailure(name, "size() is " + to_string(map.size()) + " but " + to_string(count) + " was expected");
+
+    for (uint32_t k = 0; k < count; ++k) {
+        uint32_t v = 0;
+        if (!map.find(k, v))
+            throw TestFailure(name, "key " + to_string(k) + " missing");
+        if ((v & 0xff) != 1 && (v & 0xff) != 2)
+            throw TestFailure(name, "key " + to_string(k) + " has value " + to_string(v));
+    }
+}
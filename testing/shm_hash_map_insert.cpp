@@ -0,0 +1,86 @@
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include "./testing.hpp"
+
+#include <pshm/shm_hash_map.hpp>
+
+void run_test(const string& name)
+{
+    using pshm::flags;
+    using map_type = pshm::shm_hash_map<uint64_t, TestStruct>;
+    constexpr size_t capacity = 1000;
+    constexpr uint64_t count = 600;
+
+    cout << "Creating " << name << endl;
+    map_type map(name, flags::RDWR | flags::CREAT, capacity);
+    map_type other(name, flags::RDWR, capacity);
+
+    if (map.capacity() != 1024)
+        throw TestFailure(name, "capacity() is " + to_string(map.capacity()) + " but 1024 was expected");
+
+    TestStruct ts;
+    memset(&ts, 0, sizeof(ts));
+    for (uint64_t k = 0; k < count; ++k) {
+        ts.number = static_cast<int>(k * 2);
+        if (!map.insert(k, ts))
+            throw TestFailure(name, "insert(" + to_string(k) + ") should succeed");
+    }
+    if (map.insert(7, ts))
+        throw TestFailure(name, "inserting a duplicate key should return false");
+    if (other.size() != count)
+        throw TestFailure(name, "size() is " + to_string(other.size()) + " but " + to_string(count) + " was expected");
+
+    cout << "Finding every key through a second mapping" << endl;
+    for (uint64_t k = 0; k < count; ++k) {
+        TestStruct found;
+        if (!other.find(k, found))
+            throw TestFailure(name, "find(" + to_string(k) + ") failed");
+        if (found.number != static_cast<int>(k * 2))
+            throw TestFailure(name, "find(" + to_string(k) + ") returned " + to_string(found.number));
+    }
+    for (uint64_t k = count; k < count * 2; ++k) {
+        if (other.contains(k))
+            throw TestFailure(name, "contains(" + to_string(k) + ") should be false");
+    }
+
+    cout << "Updating, replacing and erasing" << endl;
+    if (!other.update(3, [](TestStruct& v) { v.number = -3; }))
+        throw TestFailure(name, "update(3) should find the key");
+    ts.number = -4;
+    if (map.insert_or_assign(4, ts))
+        throw TestFailure(name, "insert_or_assign(4) should replace, not insert");
+    if (!map.erase(5) || map.erase(5) || map.contains(5))
+        throw TestFailure(name, "erase(5) should remove the key exactly once");
+    if (!map.insert(5, ts))
+        throw TestFailure(name, "inserting an erased key should succeed");
+
+    TestStruct found;
+    map.find(3, found);
+    if (found.number != -3)
+        throw TestFailure(name, "update(3) not visible, number is " + to_string(found.number));
+    other.find(4, found);
+    if (found.number != -4)
+        throw TestFailure(name, "insert_or_assign(4) not visible, number is " + to_string(found.number));
+
+    size_t visited = 0;
+    map.for_each([&visited](const uint64_t&, const TestStruct&) { visited++; });
+    if (visited != count)
+        throw TestFailure(name, "for_each() visited " + to_string(visited) + " but " + to_string(count) + " was expected");
+
+    cout << "Filling the map up" << endl;
+    try {
+        for (uint64_t k = count; k < count + capacity; ++k)
+            map.insert(k, ts);
+        throw TestFailure(name, "inserting past the capacity should fail");
+    } catch (std::length_error& ex) {
+        cout << "Good, got expected length_error: " << ex.what() << endl;
+    }
+
+    try {
+        map_type wrong(name, flags::RDWR, capacity * 2);
+        throw TestFailure(name, "attaching with a different capacity should fail");
+    } catch (runtime_error& ex) {
+        cout << "Good, got expected runtime_error: " << ex.what() << endl;
+    }
+}
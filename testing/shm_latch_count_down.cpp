@@ -0,0 +1,52 @@
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include "./testing.hpp"
+
+#include <pshm/shm_latch.hpp>
+
+#include <thread>
+
+void run_test(const string& name)
+{
+    using pshm::flags;
+    constexpr uint64_t workers = 4;
+
+    pshm::shm_latch ready(name, flags::RDWR | flags::CREAT, workers);
+    if (ready.try_wait() || ready.remaining() != workers)
+        throw TestFailure(name, "A fresh latch should be closed");
+
+    pshm::spin_park park(10);
+    if (ready.wait_for(park, std::chrono::milliseconds(10)))
+        throw TestFailure(name, "wait_for() returned true on a closed latch");
+
+    cout << "Counting down from " << workers << " threads" << endl;
+    std::vector<std::thread> threads;
+    for (uint64_t i = 0; i < workers; ++i) {
+        threads.emplace_back([&name] {
+            pshm::shm_latch mine(name, flags::RDWR, workers);
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            mine.count_down();
+        });
+    }
+    ready.wait(park);
+    for (auto& t : threads)
+        t.join();
+
+    if (!ready.try_wait() || ready.remaining() != 0)
+        throw TestFailure(name, "The latch should be open");
+    pshm::wait_stats st = park.stats();
+    cout << "spins " << st.spins << " parks " << st.parks << endl;
+
+    /* Stays open, even counted past zero. */
+    ready.count_down(3);
+    ready.arrive_and_wait();
+    if (!ready.try_wait())
+        throw TestFailure(name, "The latch closed again");
+
+    try {
+        pshm::shm_latch wrong(name, flags::RDWR, workers + 1);
+        throw TestFailure(name, "Attaching with another count should fail");
+    } catch (runtime_error&) {
+    }
+}
@@ -0,0 +1,55 @@
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include "./testing.hpp"
+
+#include <pshm/shm_object.hpp>
+
+void run_test(const string& name)
+{
+    using pshm::flags;
+    using advice = pshm::shm_object::advice;
+
+    constexpr size_t length = 1024 * 1024;
+    shm_object_unique_ptr ptr = make_shm_object_unique_ptr(name, flags::RDWR | flags::CREAT, length, 0);
+
+    uint8_t* p = static_cast<uint8_t*>(ptr->get());
+    for (size_t i = 0; i < length; ++i)
+        p[i] = static_cast<uint8_t>(i * 7);
+
+    const advice hints[] = {
+        advice::sequential,
+        advice::random,
+        advice::will_need,
+        advice::hugepage,
+        advice::no_hugepage,
+        advice::cold,
+        advice::dont_need,
+        advice::pageout,
+        advice::normal,
+    };
+    for (advice hint : hints) {
+        try {
+            ptr->advise(hint);
+            /* An unaligned start is rounded down to the page. */
+            ptr->advise(4097, 8192, hint);
+        } catch (runtime_error& ex) {
+            /* The kernel or headers may be too old for some hints. */
+            cout << "advice " << static_cast<int>(hint) << " not supported: " << ex.what() << endl;
+        }
+    }
+
+    /* Dropping or paging out a shared mapping must not lose the contents. */
+    for (size_t i = 0; i < length; ++i) {
+        if (p[i] != static_cast<uint8_t>(i * 7))
+            throw TestFailure(name, "byte " + to_string(i) + " changed after advise()");
+    }
+
+    try {
+        ptr->advise(length - 10, 11, advice::normal);
+        throw TestFailure(name, "advise() past the end should throw");
+    } catch (std::invalid_argument& ex) {
+        cout << "expected: " << ex.what() << endl;
+    }
+    ptr->advise(length, 0, advice::normal);
+}
@@ -0,0 +1,145 @@
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include "./testing.hpp"
+
+#include <pshm/checkpoint.hpp>
+
+#include <cstdio>
+#include <fstream>
+
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace
+{
+    uint8_t pattern(size_t i)
+    {
+        return static_cast<uint8_t>((i * 131) ^ (i >> 9));
+    }
+
+    void fill(pshm::shm_object& object)
+    {
+        uint8_t* p = static_cast<uint8_t*>(object.get());
+        for (size_t i = 0; i < object.size(); ++i)
+            p[i] = pattern(i);
+    }
+
+    void check(const string& name, const pshm::shm_object& object, const string& what)
+    {
+        const uint8_t* p = static_cast<const uint8_t*>(object.get());
+        for (size_t i = 0; i < object.size(); ++i) {
+            if (p[i] != pattern(i))
+                throw TestFailure(name, what + ": wrong byte at " + to_string(i));
+        }
+    }
+
+    template <class F>
+    void expect_runtime_error(const string& name, const string& what, F fn)
+    {
+        try {
+            fn();
+        } catch (runtime_error& ex) {
+            cout << what << ": " << ex.what() << endl;
+            return;
+        }
+        throw TestFailure(name, what + " should have failed");
+    }
+} // namespace
+
+void run_test(const string& name)
+{
+    using pshm::flags;
+    const size_t length = 3 * 1024 * 1024 + 100;
+    const pshm::segment_layout layout{length, 64, 0x5eed};
+    const string path = (name[0] == '/' ? name.substr(1) : name) + ".ckpt";
+
+    cout << "Checkpointing a segment with a header" << endl;
+    shm_object_unique_ptr object(pshm::make_shm_object(name, flags::RDWR | flags::CREAT | flags::EXCL | flags::HEADER, length, 0, layout));
+    fill(*object);
+    object->checkpoint(path);
+
+    pshm::checkpoint_header h;
+    {
+        std::ifstream in(path, std::ios::binary);
+        in.read(reinterpret_cast<char*>(&h), sizeof(h));
+    }
+    if (h.magic != pshm::checkpoint_header::MAGIC || h.length != length || h.layout_hash != layout.hash)
+        throw TestFailure(name, "checkpoint_header doesn't describe the object");
+    if (h.checksum != pshm::checksum64(object->get(), length))
+        throw TestFailure(name, "checkpoint_header::checksum is wrong");
+
+    std::memset(object->get(), 0, length);
+    object->restore(path);
+    check(name, *object, "restore()");
+
+    cout << "Round trip through a plain object at an offset" << endl;
+    {
+        const size_t plain_length = 1024 * 1024;
+        shm_object_unique_ptr plain(pshm::make_shm_object(name + "_plain", flags::RDWR | flags::CREAT, plain_length, 65536));
+        fill(*plain);
+        plain->checkpoint(path + ".plain");
+        std::memset(plain->get(), 0xff, plain_length);
+        plain->restore(path + ".plain");
+        check(name, *plain, "plain restore()");
+
+        expect_runtime_error(name, "Restoring the wrong size", [&]() { plain->restore(path); });
+        std::remove((path + ".plain").c_str());
+    }
+
+    cout << "Concurrent checkpoints to the same path" << endl;
+    {
+        std::vector<pid_t> kids;
+        for (int k = 0; k < 2; ++k) {
+            pid_t kid = fork();
+            if (kid == -1)
+                throw runtime_error(string("fork() failed: ") + strerror(errno));
+            if (kid == 0) {
+                try {
+                    for (int i = 0; i < 20; ++i)
+                        object->checkpoint(path);
+                } catch (std::exception& ex) {
+                    std::cerr << ex.what() << endl;
+                    _exit(EXIT_FAILURE);
+                }
+                _exit(EXIT_SUCCESS);
+            }
+            kids.push_back(kid);
+        }
+        for (pid_t kid : kids) {
+            int wstatus;
+            if (waitpid(kid, &wstatus, 0) != kid || !WIFEXITED(wstatus) || WEXITSTATUS(wstatus) != 0)
+                throw TestFailure(name, "a concurrent checkpoint() failed");
+        }
+
+        std::memset(object->get(), 0, length);
+        object->restore(path);
+        check(name, *object, "restore() after concurrent checkpoints");
+
+        DIR* dir = opendir(".");
+        if (dir == nullptr)
+            throw runtime_error(string("opendir() failed: ") + strerror(errno));
+        string leftover;
+        while (struct dirent* entry = readdir(dir)) {
+            if (string(entry->d_name).compare(0, path.size() + 1, path + ".") == 0)
+                leftover = entry->d_name;
+        }
+        closedir(dir);
+        if (!leftover.empty())
+            throw TestFailure(name, "checkpoint() left " + leftover + " behind");
+    }
+
+    cout << "Corrupted checkpoints are rejected" << endl;
+    {
+        std::fstream f(path, std::ios::binary | std::ios::in | std::ios::out);
+        f.seekp(static_cast<std::streamoff>(h.data_offset + length / 2));
+        f.put(static_cast<char>(~pattern(length / 2)));
+    }
+    expect_runtime_error(name, "Restoring a corrupted checkpoint", [&]() { object->restore(path); });
+    check(name, *object, "a failed restore()");
+    expect_runtime_error(name, "Restoring a missing checkpoint", [&]() { object->restore(path + ".missing"); });
+
+    std::remove(path.c_str());
+}
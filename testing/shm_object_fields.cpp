@@ -9,7 +9,7 @@ void run_test(const string& name)
 {
     using pshm::flags;
     pshm::shm_object::size_type length = sizeof(int);
-    pshm::shm_object::offset_type offset = 20;
+    pshm::shm_object::offset_type offset = 65536; // A multiple of every common page size.
     pshm::flags_t oflags = flags::RDWR | flags::CREAT | flags::EXCL;
 
     cout << "Creating " << name << endl;
@@ -45,4 +45,10 @@ void run_test(const string& name)
 
     if (ptr->get() == nullptr)
         throw TestFailure(name, "shm_object::get() returned nullptr but should be real.");
+
+    try {
+        make_shm_object_unique_ptr(name + "_unaligned", flags::RDWR | flags::CREAT, length, 20);
+        throw TestFailure(name, "An offset that isn't page aligned should be rejected");
+    } catch (std::invalid_argument&) {
+    }
 }
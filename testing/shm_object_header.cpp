@@ -0,0 +1,100 @@
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include "./testing.hpp"
+
+#include <pshm/shm_object.hpp>
+
+#if defined(__unix__)
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace
+{
+    /** @returns the lowest free descriptor, which goes up if one leaks. */
+    int next_fd()
+    {
+        int fd = ::open("/dev/null", O_RDONLY);
+        ::close(fd);
+        return fd;
+    }
+} // namespace
+#endif
+
+void run_test(const string& name)
+{
+    using pshm::flags;
+    pshm::shm_object::size_type length = sizeof(TestStruct);
+    pshm::segment_layout layout = pshm::make_segment_layout<TestStruct>();
+
+    cout << "Creating " << name << " with flags::HEADER" << endl;
+    shm_object_unique_ptr creator = make_shm_object_unique_ptr(name, flags::RDWR | flags::CREAT | flags::HEADER, length, 0, layout);
+
+    const pshm::segment_header* header = creator->header();
+    if (header == nullptr)
+        throw TestFailure(name, "shm_object::header() returned nullptr with flags::HEADER");
+    if (header->state.load() != pshm::segment_header::READY)
+        throw TestFailure(name, "segment_header::state should be READY after construction");
+    if (header->magic != pshm::segment_header::MAGIC)
+        throw TestFailure(name, "segment_header::magic is wrong");
+    if (header->payload_size != length)
+        throw TestFailure(name, "segment_header::payload_size is " + to_string(header->payload_size) + " but " + to_string(length) + " was expected");
+    if (header->layout_hash != layout.hash)
+        throw TestFailure(name, "segment_header::layout_hash doesn't match the layout");
+    if (static_cast<const char*>(creator->get()) != reinterpret_cast<const char*>(header) + header->payload_offset)
+        throw TestFailure(name, "shm_object::get() should point payload_offset bytes past the header");
+    if (creator->size() != length)
+        throw TestFailure(name, "shm_object::size() should be the payload size");
+
+    cout << "Attaching to " << name << " with a matching layout" << endl;
+    shm_object_unique_ptr attacher = make_shm_object_unique_ptr(name, flags::RDWR | flags::HEADER, length, 0, layout);
+    static_cast<TestStruct*>(creator->get())->number = 42;
+    if (static_cast<TestStruct*>(attacher->get())->number != 42)
+        throw TestFailure(name, "attacher doesn't see the creator's payload");
+
+    cout << "Attaching to " << name << " with a different size to watch it fail" << endl;
+    try {
+        pshm::segment_layout bigger = pshm::make_segment_layout<TestStruct[2]>();
+        auto bad = make_shm_object_unique_ptr(name, flags::RDWR | flags::HEADER, sizeof(TestStruct[2]), 0, bigger);
+        throw TestFailure(name, "attaching with a different payload size should fail");
+    } catch (runtime_error& ex) {
+        cout << "Good, got expected runtime_error: " << ex.what() << endl;
+    }
+
+    cout << "Attaching to " << name << " with a different layout hash to watch it fail" << endl;
+    try {
+        pshm::segment_layout other = layout;
+        other.hash ^= 1;
+        auto bad = make_shm_object_unique_ptr(name, flags::RDONLY | flags::HEADER, length, 0, other);
+        throw TestFailure(name, "attaching with a different layout hash should fail");
+    } catch (runtime_error& ex) {
+        cout << "Good, got expected runtime_error: " << ex.what() << endl;
+    }
+
+#if defined(__unix__)
+    cout << "Failed attaches don't leak descriptors" << endl;
+    int fd = next_fd();
+    for (int i = 0; i < 3; ++i) {
+        try {
+            pshm::segment_layout other = layout;
+            other.hash ^= 1;
+            auto bad = make_shm_object_unique_ptr(name, flags::RDWR | flags::HEADER, length, 0, other);
+        } catch (runtime_error&) {
+        }
+    }
+    if (next_fd() != fd)
+        throw TestFailure(name, "a failed attach leaked its descriptor");
+#endif
+
+    cout << "Trying flags::HEADER with a non-zero offset to watch it fail" << endl;
+    try {
+        auto bad = make_shm_object_unique_ptr(name, flags::RDWR | flags::HEADER, length, 4096, layout);
+        throw TestFailure(name, "flags::HEADER with an offset should fail");
+    } catch (std::invalid_argument& ex) {
+        cout << "Good, got expected invalid_argument: " << ex.what() << endl;
+    }
+
+    shm_object_unique_ptr plain = make_shm_object_unique_ptr(name + "_plain", flags::RDWR | flags::CREAT, length, 0);
+    if (plain->header() != nullptr)
+        throw TestFailure(name, "shm_object::header() should be nullptr without flags::HEADER");
+}
@@ -0,0 +1,140 @@
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include "./testing.hpp"
+
+#include <pshm/shm_object_native.hpp>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace
+{
+    bool exists(const string& name)
+    {
+        int fd = ::shm_open(name.c_str(), O_RDONLY, 0);
+        if (fd == -1)
+            return false;
+        ::close(fd);
+        return true;
+    }
+
+    const pshm::segment_layout layout{sizeof(uint64_t), alignof(uint64_t), 0x11fe};
+} // namespace
+
+void run_test(const string& name)
+{
+    using pshm::flags;
+    const string n = "/" + name;
+
+    cout << "UNLINK_OWNER: attachers leave the name alone" << endl;
+    {
+        shm_object_unique_ptr owner(pshm::make_shm_object(n, flags::RDWR | flags::CREAT, sizeof(uint64_t), 0));
+        shm_object_unique_ptr attacher(pshm::make_shm_object(n, flags::RDWR | flags::CREAT, sizeof(uint64_t), 0));
+        if (!static_cast<pshm::shm_object_native&>(*owner).created() || static_cast<pshm::shm_object_native&>(*attacher).created())
+            throw TestFailure(name, "created() picked the wrong handle");
+        attacher.reset();
+        if (!exists(n))
+            throw TestFailure(name, "An attacher unlinked the object");
+        owner.reset();
+        if (exists(n))
+            throw TestFailure(name, "The owner didn't unlink the object");
+    }
+
+    cout << "UNLINK_LAST: the last handle unlinks" << endl;
+    {
+        const pshm::flags_t f = flags::RDWR | flags::CREAT | flags::HEADER | flags::UNLINK_LAST;
+        shm_object_unique_ptr first(pshm::make_shm_object(n, f, sizeof(uint64_t), 0, layout));
+        shm_object_unique_ptr second(pshm::make_shm_object(n, f, sizeof(uint64_t), 0, layout));
+        if (first->header()->attached.load() != 2)
+            throw TestFailure(name, "segment_header::attached should count both handles");
+        first.reset();
+        if (!exists(n))
+            throw TestFailure(name, "Unlinked while a handle was still attached");
+        if (second->header()->attached.load() != 1)
+            throw TestFailure(name, "segment_header::attached didn't drop");
+        second.reset();
+        if (exists(n))
+            throw TestFailure(name, "The last handle didn't unlink the object");
+    }
+
+    cout << "PERSISTENT: state survives a restart" << endl;
+    {
+        const pshm::flags_t f = flags::RDWR | flags::CREAT | flags::HEADER | flags::PERSISTENT;
+        {
+            shm_object_unique_ptr producer(pshm::make_shm_object(n, f, sizeof(uint64_t), 0, layout));
+            *static_cast<uint64_t*>(producer->get()) = 0xfeedface;
+        }
+        if (!exists(n))
+            throw TestFailure(name, "A persistent object was unlinked");
+        {
+            shm_object_unique_ptr restarted(pshm::make_shm_object(n, f, sizeof(uint64_t), 0, layout));
+            if (*static_cast<uint64_t*>(restarted->get()) != 0xfeedface)
+                throw TestFailure(name, "The restarted producer lost its state");
+        }
+        if (!pshm::shm_object_native::unlink(n))
+            throw TestFailure(name, "unlink() didn't find the object");
+        if (pshm::shm_object_native::unlink(n) || exists(n))
+            throw TestFailure(name, "unlink() left the object behind");
+    }
+
+    cout << "Conflicting lifetimes are rejected" << endl;
+    try {
+        shm_object_unique_ptr p(pshm::make_shm_object(n, flags::RDWR | flags::CREAT | flags::UNLINK_LAST, sizeof(uint64_t), 0));
+        throw TestFailure(name, "UNLINK_LAST without HEADER should fail");
+    } catch (std::invalid_argument&) {
+    }
+    try {
+        shm_object_unique_ptr p(pshm::make_shm_object(n, flags::RDWR | flags::CREAT | flags::PERSISTENT | flags::UNLINK_OWNER, sizeof(uint64_t), 0));
+        throw TestFailure(name, "Two lifetimes should fail");
+    } catch (std::invalid_argument&) {
+    }
+    try {
+        shm_object_unique_ptr p(pshm::make_shm_object(n, flags::RDWR | flags::CREAT | flags::PERSISTENT, sizeof(uint64_t), 0));
+        throw TestFailure(name, "PERSISTENT without HEADER should fail");
+    } catch (std::invalid_argument&) {
+    }
+    if (exists(n))
+        throw TestFailure(name, "A rejected open left the object behind");
+
+    cout << "Attaching with a different lifetime is rejected" << endl;
+    {
+        const pshm::flags_t f = flags::RDWR | flags::CREAT | flags::HEADER;
+        {
+            shm_object_unique_ptr producer(pshm::make_shm_object(n, f | flags::PERSISTENT, sizeof(uint64_t), 0, layout));
+            if (producer->header()->lifetime != pshm::segment_header::LIFETIME_PERSISTENT)
+                throw TestFailure(name, "segment_header::lifetime doesn't record PERSISTENT");
+        }
+        for (pshm::flags_t other : {flags::UNLINK_LAST, flags::UNLINK_OWNER, pshm::flags_t(0)}) {
+            try {
+                shm_object_unique_ptr p(pshm::make_shm_object(n, f | other, sizeof(uint64_t), 0, layout));
+                throw TestFailure(name, "Attached to a PERSISTENT object with another lifetime");
+            } catch (runtime_error& ex) {
+                cout << "expected: " << ex.what() << endl;
+            }
+        }
+        if (!pshm::shm_object_native::unlink(n))
+            throw TestFailure(name, "A mismatched attacher unlinked the PERSISTENT object");
+    }
+
+    cout << "UNLINK_LAST: nobody attaches once the count hits 0" << endl;
+    {
+        const pshm::flags_t f = flags::RDWR | flags::CREAT | flags::HEADER | flags::UNLINK_LAST;
+        shm_object_unique_ptr last(pshm::make_shm_object(n, f, sizeof(uint64_t), 0, layout));
+        /* As if its destructor had counted down and not yet unlinked. */
+        auto& attached = const_cast<pshm::segment_header*>(last->header())->attached;
+        attached.store(0);
+        try {
+            shm_object_unique_ptr late(pshm::make_shm_object(n, f, sizeof(uint64_t), 0, layout));
+            throw TestFailure(name, "Attached to an object whose last handle is unlinking it");
+        } catch (runtime_error& ex) {
+            cout << "expected: " << ex.what() << endl;
+        }
+        if (attached.load() != 0)
+            throw TestFailure(name, "A refused attacher changed segment_header::attached");
+        attached.store(1);
+    }
+    if (exists(n))
+        throw TestFailure(name, "The last handle didn't unlink the object");
+}
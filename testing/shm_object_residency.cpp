@@ -0,0 +1,93 @@
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include "./testing.hpp"
+
+#include <pshm/residency.hpp>
+#include <pshm/shm_object.hpp>
+#include <pshm/shm_object_native.hpp>
+
+namespace
+{
+    /** @returns the registry entry for name, or nullptr. */
+    const pshm::mapping_info* find(const pshm::mapping_summary& summary, const string& name)
+    {
+        for (const auto& m : summary.mappings) {
+            if (m.name == name)
+                return &m;
+        }
+        return nullptr;
+    }
+} // namespace
+
+void run_test(const string& name)
+{
+    using pshm::flags;
+
+    const size_t page = pshm::page_size();
+    const size_t pages = 64;
+    const size_t length = pages * page;
+
+    {
+        shm_object_unique_ptr ptr = make_shm_object_unique_ptr(name, flags::RDWR | flags::CREAT, length, 0);
+
+        if (ptr->resident_bytes() != 0)
+            throw TestFailure(name, "fresh object has " + to_string(ptr->resident_bytes()) + " resident bytes");
+
+        /* Touch every other page. */
+        uint8_t* p = static_cast<uint8_t*>(ptr->get());
+        for (size_t i = 0; i < pages; i += 2)
+            p[i * page] = 1;
+
+        size_t resident = ptr->resident_bytes();
+        cout << "resident " << resident << " of " << ptr->size() << endl;
+        if (resident != pages / 2 * page)
+            throw TestFailure(name, "resident_bytes() is " + to_string(resident) + " but " + to_string(pages / 2 * page) + " was expected");
+
+        std::vector<bool> map = ptr->residency(0, length);
+        if (map.size() != pages)
+            throw TestFailure(name, "residency() has " + to_string(map.size()) + " pages");
+        for (size_t i = 0; i < pages; ++i) {
+            if (map[i] != (i % 2 == 0))
+                throw TestFailure(name, "residency() is wrong for page " + to_string(i));
+        }
+
+        /* An unaligned range is rounded out to the pages it covers. */
+        map = ptr->residency(page + 1, page);
+        if (map.size() != 2 || map[0] || !map[1])
+            throw TestFailure(name, "residency() of an unaligned range is wrong");
+
+        try {
+            ptr->residency(length, 1);
+            throw TestFailure(name, "residency() past the end should throw");
+        } catch (std::invalid_argument& ex) {
+            cout << "expected: " << ex.what() << endl;
+        }
+
+        pshm::mapping_summary summary = pshm::summarize_mappings();
+        const pshm::mapping_info* m = find(summary, ptr->name());
+        if (m == nullptr)
+            throw TestFailure(name, "live object is missing from summarize_mappings()");
+        if (m->length != length || m->resident != resident)
+            throw TestFailure(name, "summarize_mappings() disagrees with the object");
+        if (summary.resident_bytes < resident || summary.mapped_bytes < length)
+            throw TestFailure(name, "summarize_mappings() totals are too small");
+    }
+
+    if (find(pshm::summarize_mappings(), "/" + name) != nullptr || find(pshm::summarize_mappings(), name) != nullptr)
+        throw TestFailure(name, "destroyed object is still in summarize_mappings()");
+
+    cout << "Move assignment releases the old mapping" << endl;
+    {
+        pshm::shm_object_native target("/" + name + "_target", flags::RDWR | flags::CREAT, page, 0);
+        pshm::shm_object_native source("/" + name + "_source", flags::RDWR | flags::CREAT, page, 0);
+        target = std::move(source);
+        pshm::mapping_summary summary = pshm::summarize_mappings();
+        if (find(summary, "/" + name + "_target") != nullptr)
+            throw TestFailure(name, "the overwritten object is still in summarize_mappings()");
+        if (find(summary, "/" + name + "_source") == nullptr || target.name() != "/" + name + "_source")
+            throw TestFailure(name, "the moved object went missing");
+    }
+    if (find(pshm::summarize_mappings(), "/" + name + "_source") != nullptr)
+        throw TestFailure(name, "the moved object outlived its new handle");
+}
@@ -0,0 +1,34 @@
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+#include "./testing.hpp"
+
+#include <pshm/shm_ptr.hpp>
+
+void run_test(const string& name)
+{
+    using pshm::flags;
+
+    struct Smaller {
+        int number;
+    };
+
+    cout << "Creating " << name << " as a TestStruct" << endl;
+    pshm::shm_ptr<TestStruct> ptr(name, flags::RDWR | flags::CREAT | flags::HEADER);
+    ptr->number = 12345;
+
+    cout << "Attaching as a TestStruct" << endl;
+    pshm::shm_ptr<TestStruct> same(name, flags::RDWR | flags::HEADER);
+    if (same->number != ptr->number)
+        throw TestFailure(name, "number is " + to_string(same->number) + " but " + to_string(ptr->number) + " was expected");
+
+    cout << "Attaching as a smaller type to watch it fail" << endl;
+    try {
+        pshm::shm_ptr<Smaller> wrong(name, flags::RDWR | flags::HEADER);
+        throw TestFailure(name, "attaching with a different sizeof(T) should fail");
+    } catch (runtime_error& ex) {
+        cout << "Good, got expected runtime_error: " << ex.what() << endl;
+    }
+
+    if (ptr->number != 12345)
+        throw TestFailure(name, "failed attach should leave the payload alone");
+}
@@ -0,0 +1,135 @@
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include "./testing.hpp"
+
+#include <pshm/shm_reactor.hpp>
+
+#include <chrono>
+#include <thread>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace
+{
+    constexpr size_t capacity = 4096;
+    constexpr int count = 5;
+
+    /** Coroutine that runs to completion on its own. */
+    struct detached {
+        struct promise_type {
+            detached get_return_object() noexcept { return {}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() noexcept {}
+            void unhandled_exception() { std::terminate(); }
+        };
+    };
+
+    detached consume(pshm::shm_reactor& reactor, pshm::shm_broadcast_subscriber& sub, std::atomic<int>& received, std::atomic<bool>& done)
+    {
+        pshm::shm_broadcast_subscriber::record rec;
+        while (received.load() < count) {
+            auto st = co_await pshm::async_next(reactor, sub, rec);
+            if (st == pshm::shm_broadcast_subscriber::status::ok)
+                received.fetch_add(1);
+        }
+        done.store(true);
+    }
+
+    /** @returns true once done is set, false after 5 seconds. */
+    bool wait_until(std::atomic<bool>& done)
+    {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (!done.load()) {
+            if (std::chrono::steady_clock::now() > deadline)
+                return false;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return true;
+    }
+
+    /** @returns the number of eventfds registered in a doorbell. */
+    size_t registrations(pshm::shm_doorbell& bell)
+    {
+        size_t n = 0;
+        for (auto& slot : bell.state()->eventfds) {
+            if (slot.load() != 0)
+                n++;
+        }
+        return n;
+    }
+} // namespace
+
+void run_test(const string& name)
+{
+    using pshm::flags;
+
+    cout << "One reactor in this process" << endl;
+    {
+        pshm::shm_broadcast_ring ring(name, flags::RDWR | flags::CREAT, capacity);
+        pshm::shm_broadcast_subscriber sub(name, flags::RDWR, capacity);
+        std::atomic<int> received(0);
+        std::atomic<bool> done(false);
+        pshm::shm_reactor reactor;
+
+        consume(reactor, sub, received, done);
+        if (done.load())
+            throw TestFailure(name, "coroutine finished before anything was published");
+
+        for (int i = 0; i < count; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            ring.publish(&i, sizeof(i));
+        }
+        if (!wait_until(done))
+            throw TestFailure(name, "coroutine only received " + to_string(received.load()) + " records");
+    }
+
+    cout << "Two processes, each with its own reactor" << endl;
+    const string shared = name + "_shared";
+    pshm::shm_broadcast_ring ring(shared, flags::RDWR | flags::CREAT, capacity);
+
+    std::vector<pid_t> kids;
+    for (int k = 0; k < 2; ++k) {
+        pid_t kid = fork();
+        if (kid == -1)
+            throw runtime_error(string("fork() failed: ") + strerror(errno));
+        if (kid == 0) {
+            bool ok = false;
+            try {
+                pshm::shm_broadcast_subscriber sub(shared, flags::RDWR, capacity);
+                std::atomic<int> received(0);
+                std::atomic<bool> done(false);
+                pshm::shm_reactor reactor;
+                consume(reactor, sub, received, done);
+                ok = wait_until(done);
+                if (!ok)
+                    std::cerr << "pid " << getpid() << " only received " << received.load() << " records" << endl;
+            } catch (std::exception& ex) {
+                std::cerr << ex.what() << endl;
+            }
+            _exit(ok ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+        kids.push_back(kid);
+    }
+
+    /* Both reactors must stay registered, or one of them sleeps through the records. */
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (registrations(ring.doorbell()) < kids.size()) {
+        if (std::chrono::steady_clock::now() > deadline)
+            throw TestFailure(name, "only " + to_string(registrations(ring.doorbell())) + " reactors are registered");
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    for (int i = 0; i < count; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        ring.publish(&i, sizeof(i));
+    }
+
+    for (pid_t kid : kids) {
+        int wstatus;
+        if (waitpid(kid, &wstatus, 0) != kid || !WIFEXITED(wstatus) || WEXITSTATUS(wstatus) != 0)
+            throw TestFailure(name, "a subscriber process missed records");
+    }
+}
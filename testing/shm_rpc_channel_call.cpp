@@ -0,0 +1,130 @@
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include "./testing.hpp"
+
+#include <pshm/shm_rpc_channel.hpp>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace
+{
+    struct quote_request {
+        uint32_t instrument;
+        uint32_t quantity;
+    };
+
+    struct quote_response {
+        uint32_t instrument;
+        uint64_t price;
+    };
+
+    using channel_type = pshm::shm_rpc_channel<quote_request, quote_response>;
+
+    constexpr size_t slots = 8;
+    constexpr uint32_t calls = 1000;
+    /** Tells the worker to exit. */
+    constexpr uint32_t stop = 0xffffffff;
+
+    void price(const quote_request& req, quote_response& resp)
+    {
+        resp.instrument = req.instrument;
+        resp.price = static_cast<uint64_t>(req.instrument) * req.quantity;
+    }
+} // namespace
+
+void run_test(const string& name)
+{
+    using pshm::flags;
+
+    channel_type channel(name, flags::RDWR | flags::CREAT, slots);
+
+    /* Batching: several calls in flight are answered in one pass. */
+    std::vector<channel_type::ticket> tickets;
+    for (uint32_t i = 1; i <= 4; ++i)
+        tickets.push_back(channel.submit(quote_request{i, 10}));
+    if (!channel.pending())
+        throw TestFailure(name, "submitted requests aren't pending");
+    size_t served = channel.serve(price);
+    if (served != 4)
+        throw TestFailure(name, "serve() answered " + to_string(served) + " requests but 4 were expected");
+    for (uint32_t i = 1; i <= 4; ++i) {
+        quote_response resp;
+        if (!channel.try_get(tickets[i - 1], resp))
+            throw TestFailure(name, "response " + to_string(i) + " isn't ready");
+        if (resp.instrument != i || resp.price != i * 10)
+            throw TestFailure(name, "response " + to_string(i) + " doesn't match its request");
+    }
+    try {
+        quote_response resp;
+        channel.try_get(tickets[0], resp);
+        throw TestFailure(name, "collecting a ticket twice should throw");
+    } catch (logic_error& ex) {
+        cout << "expected: " << ex.what() << endl;
+    }
+
+    /* A handler that throws fails its call and leaves the rest waiting. */
+    {
+        channel_type::ticket bad = channel.submit(quote_request{13, 1});
+        channel_type::ticket good = channel.submit(quote_request{14, 1});
+        try {
+            channel.serve([](const quote_request& req, quote_response& resp) {
+                if (req.instrument == 13)
+                    throw std::runtime_error("unlucky instrument");
+                price(req, resp);
+            });
+            throw TestFailure(name, "serve() swallowed the handler's exception");
+        } catch (std::runtime_error& ex) {
+            cout << "expected: " << ex.what() << endl;
+        }
+
+        pshm::spin_park strategy;
+        try {
+            channel.wait(bad, strategy);
+            throw TestFailure(name, "waiting on a failed call should throw");
+        } catch (runtime_error& ex) {
+            cout << "expected: " << ex.what() << endl;
+        }
+        if (!channel.pending() || channel.serve(price) != 1)
+            throw TestFailure(name, "the request after the failed one wasn't left for the next serve()");
+        quote_response resp;
+        if (!channel.try_get(good, resp) || resp.instrument != 14)
+            throw TestFailure(name, "the request after the failed one wasn't answered");
+    }
+
+    /* A worker in another process. */
+    pid_t kid = fork();
+    if (kid == -1)
+        throw runtime_error(string("fork() failed: ") + strerror(errno));
+
+    if (kid == 0) {
+        channel_type worker(name, flags::RDWR, slots);
+        pshm::spin_park strategy;
+        bool running = true;
+        while (running) {
+            worker.serve_wait([&running](const quote_request& req, quote_response& resp) {
+                if (req.instrument == stop)
+                    running = false;
+                price(req, resp);
+            }, strategy);
+        }
+        _exit(EXIT_SUCCESS);
+    }
+
+    pshm::spin_park strategy(100);
+    for (uint32_t i = 0; i < calls; ++i) {
+        quote_response resp = channel.call(quote_request{i, 3}, strategy);
+        if (resp.instrument != i || resp.price != static_cast<uint64_t>(i) * 3)
+            throw TestFailure(name, "call " + to_string(i) + " got the wrong response");
+    }
+    channel.call(quote_request{stop, 0});
+
+    int wstatus;
+    if (waitpid(kid, &wstatus, 0) != kid || !WIFEXITED(wstatus) || WEXITSTATUS(wstatus) != 0)
+        throw TestFailure(name, "worker failed");
+
+    pshm::wait_stats st = strategy.stats();
+    cout << calls << " calls: spins " << st.spins << " parks " << st.parks << endl;
+}
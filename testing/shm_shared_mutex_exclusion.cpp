@@ -0,0 +1,122 @@
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include "./testing.hpp"
+
+#include <pshm/shm_shared_mutex.hpp>
+
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+
+namespace
+{
+    /** Writers keep both halves equal, so readers can spot a torn update. */
+    struct config {
+        uint64_t a;
+        uint64_t b;
+    };
+} // namespace
+
+void run_test(const string& name)
+{
+    using pshm::flags;
+    constexpr int readers = 4;
+    constexpr int writers = 2;
+    constexpr uint64_t updates = 1000;
+
+    pshm::shm_shared_mutex mutex(name, flags::RDWR | flags::CREAT, 8);
+    shm_object_unique_ptr data(pshm::make_shm_object(name + "_data", flags::RDWR | flags::CREAT, sizeof(config), 0));
+    config* cfg = static_cast<config*>(data->get());
+    cfg->a = cfg->b = 0;
+    if (mutex.slots() != 8)
+        throw TestFailure(name, "slots() is " + to_string(mutex.slots()));
+
+    cout << "try_lock() against readers and writers" << endl;
+    mutex.lock_shared();
+    if (mutex.try_lock())
+        throw TestFailure(name, "try_lock() succeeded under a reader");
+    if (!mutex.try_lock_shared())
+        throw TestFailure(name, "A second reader was turned away");
+    mutex.unlock_shared();
+    mutex.unlock_shared();
+    if (!mutex.try_lock())
+        throw TestFailure(name, "try_lock() failed on a free mutex");
+    if (mutex.try_lock_shared())
+        throw TestFailure(name, "try_lock_shared() succeeded under a writer");
+    mutex.unlock();
+
+    cout << "Writer preference" << endl;
+    mutex.lock_shared();
+    std::atomic<bool> written{false};
+    std::thread writer([&] {
+        pshm::shm_shared_mutex mine(name, flags::RDWR, 8);
+        std::lock_guard<pshm::shm_shared_mutex> hold(mine);
+        written = true;
+    });
+    /* Once the writer has claimed the mutex, new readers must back off. */
+    pshm::shm_shared_mutex other(name, flags::RDWR, 8);
+    bool refused = false;
+    for (int i = 0; i < 1000 && !refused; ++i) {
+        std::thread probe([&] {
+            if (other.try_lock_shared())
+                other.unlock_shared();
+            else
+                refused = true;
+        });
+        probe.join();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if (!refused || written)
+        throw TestFailure(name, "A waiting writer didn't hold back new readers");
+    mutex.unlock_shared();
+    writer.join();
+    if (!written)
+        throw TestFailure(name, "The writer never got in");
+
+    cout << readers << " readers and " << writers << " writers" << endl;
+    std::atomic<uint64_t> torn{0};
+    std::atomic<bool> done{false};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < readers; ++i) {
+        threads.emplace_back([&] {
+            pshm::shm_shared_mutex mine(name, flags::RDWR, 8);
+            while (!done) {
+                {
+                    std::shared_lock<pshm::shm_shared_mutex> hold(mine);
+                    if (cfg->a != cfg->b)
+                        torn++;
+                }
+                std::this_thread::yield();
+            }
+        });
+    }
+    std::vector<std::thread> updaters;
+    for (int i = 0; i < writers; ++i) {
+        updaters.emplace_back([&] {
+            pshm::shm_shared_mutex mine(name, flags::RDWR, 8);
+            for (uint64_t n = 0; n < updates; ++n) {
+                std::unique_lock<pshm::shm_shared_mutex> hold(mine);
+                cfg->a++;
+                std::this_thread::yield();
+                cfg->b++;
+            }
+        });
+    }
+    for (auto& t : updaters)
+        t.join();
+    done = true;
+    for (auto& t : threads)
+        t.join();
+
+    if (torn != 0)
+        throw TestFailure(name, "Readers saw " + to_string(torn.load()) + " torn updates");
+    if (cfg->a != writers * updates || cfg->b != writers * updates)
+        throw TestFailure(name, "Writers lost updates: " + to_string(cfg->a));
+
+    try {
+        pshm::shm_shared_mutex wrong(name, flags::RDWR, 16);
+        throw TestFailure(name, "Attaching with another slot count should fail");
+    } catch (runtime_error&) {
+    }
+}
@@ -0,0 +1,109 @@
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include "./testing.hpp"
+
+#include <pshm/shm_snapshot.hpp>
+
+#include <thread>
+
+namespace
+{
+    struct table {
+        uint64_t values[2048];
+    };
+
+    void fill(pshm::shm_object& object, uint64_t value)
+    {
+        pshm::shm_write_epoch epoch(object);
+        table* t = static_cast<table*>(object.get());
+        for (uint64_t& v : t->values)
+            v = value;
+    }
+
+    /**
+     * @returns the value every entry holds, or throws if they differ.
+     */
+    uint64_t uniform(const string& name, const pshm::shm_snapshot& snap)
+    {
+        const table* t = static_cast<const table*>(snap.get());
+        for (uint64_t v : t->values) {
+            if (v != t->values[0])
+                throw TestFailure(name, "Snapshot mixes " + to_string(t->values[0]) + " and " + to_string(v));
+        }
+        return t->values[0];
+    }
+} // namespace
+
+void run_test(const string& name)
+{
+    using pshm::flags;
+    using mode = pshm::shm_snapshot::mode;
+    const pshm::segment_layout layout = pshm::make_segment_layout<table>();
+
+    shm_object_unique_ptr object(pshm::make_shm_object(name, flags::RDWR | flags::CREAT | flags::EXCL | flags::HEADER, sizeof(table), 0, layout));
+    fill(*object, 1);
+    shm_object_unique_ptr reader(pshm::make_shm_object(name, flags::RDONLY | flags::HEADER, sizeof(table), 0, layout));
+
+    cout << "Frozen snapshot ignores later writes" << endl;
+    {
+        pshm::shm_snapshot snap(*reader, mode::frozen);
+        fill(*object, 2);
+        if (uniform(name, snap) != 1)
+            throw TestFailure(name, "Frozen snapshot changed after a write");
+        if (!snap.valid())
+            throw TestFailure(name, "Frozen snapshots are always valid");
+        snap.refresh();
+        if (uniform(name, snap) != 2)
+            throw TestFailure(name, "refresh() didn't pick up the write");
+    }
+
+    cout << "Optimistic snapshot notices writes" << endl;
+    {
+        pshm::shm_snapshot snap(*reader, mode::optimistic);
+        if (!snap.valid() || uniform(name, snap) != 2)
+            throw TestFailure(name, "Fresh optimistic snapshot should be valid");
+        uint64_t epoch = snap.epoch();
+        fill(*object, 3);
+        if (snap.valid())
+            throw TestFailure(name, "Optimistic snapshot still valid after a write");
+        snap.refresh();
+        if (!snap.valid() || snap.epoch() == epoch || uniform(name, snap) != 3)
+            throw TestFailure(name, "refresh() didn't take a new snapshot");
+    }
+
+    cout << "Frozen snapshots are consistent under a running writer" << endl;
+    {
+        std::atomic<bool> stop(false);
+        std::thread writer([&]() {
+            for (uint64_t i = 4; !stop.load(); ++i) {
+                fill(*object, i);
+                std::this_thread::yield();
+            }
+        });
+        try {
+            for (int i = 0; i < 200; ++i) {
+                pshm::shm_snapshot snap(*reader, mode::frozen);
+                uniform(name, snap);
+            }
+        } catch (...) {
+            stop = true;
+            writer.join();
+            throw;
+        }
+        stop = true;
+        writer.join();
+    }
+
+    shm_object_unique_ptr plain(pshm::make_shm_object(name + "_plain", flags::RDWR | flags::CREAT, sizeof(table), 0));
+    try {
+        pshm::shm_write_epoch epoch(*plain);
+        throw TestFailure(name, "shm_write_epoch needs a segment_header");
+    } catch (std::invalid_argument&) {
+    }
+    try {
+        pshm::shm_snapshot snap(*plain);
+        throw TestFailure(name, "shm_snapshot needs a segment_header");
+    } catch (std::invalid_argument&) {
+    }
+}
@@ -0,0 +1,69 @@
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include "./testing.hpp"
+
+#include <pshm/shm_table.hpp>
+
+#include <numeric>
+
+void run_test(const string& name)
+{
+    using pshm::flags;
+    using table = pshm::shm_table<uint32_t, double, char>;
+    const size_t capacity = 1000;
+
+    table writer(name, flags::RDWR | flags::CREAT, capacity);
+    table reader(name, flags::RDONLY, capacity);
+
+    cout << "Appending rows" << endl;
+    for (uint32_t i = 0; i < 100; ++i) {
+        if (writer.append(i, i * 0.5, static_cast<char>('a' + i % 26)) != i)
+            throw TestFailure(name, "append() returned the wrong row");
+    }
+    if (reader.size() != 100)
+        throw TestFailure(name, "Reader sees " + to_string(reader.size()) + " rows");
+
+    auto ids = reader.column<0>();
+    auto values = reader.column<1>();
+    auto tags = reader.column<2>();
+    for (const void* p : {static_cast<const void*>(ids.data()), static_cast<const void*>(values.data()), static_cast<const void*>(tags.data())}) {
+        if (reinterpret_cast<uintptr_t>(p) % table::COLUMN_ALIGNMENT != 0)
+            throw TestFailure(name, "Column isn't cache line aligned");
+    }
+    if (std::accumulate(ids.begin(), ids.end(), uint64_t(0)) != 4950)
+        throw TestFailure(name, "Sum of column 0 is wrong");
+    if (std::accumulate(values.begin(), values.end(), 0.0) != 2475.0)
+        throw TestFailure(name, "Sum of column 1 is wrong");
+    if (tags[27] != 'b')
+        throw TestFailure(name, "Column 2 has the wrong value");
+    if (std::get<1>(reader.row(42)) != 21.0)
+        throw TestFailure(name, "row() copied the wrong values");
+
+    cout << "Appending in bulk" << endl;
+    std::vector<uint32_t> more_ids(900);
+    std::vector<double> more_values(900, 1.0);
+    std::vector<char> more_tags(900, 'z');
+    std::iota(more_ids.begin(), more_ids.end(), 100);
+    if (writer.append_rows(900, more_ids.data(), more_values.data(), more_tags.data()) != 100)
+        throw TestFailure(name, "append_rows() returned the wrong first row");
+    ids = reader.column<0>();
+    if (ids.size() != capacity || ids[999] != 999)
+        throw TestFailure(name, "Bulk rows aren't visible");
+
+    try {
+        writer.append(0, 0.0, 'x');
+        throw TestFailure(name, "append() to a full table should fail");
+    } catch (std::length_error&) {
+    }
+
+    writer.clear();
+    if (!reader.column<1>().empty())
+        throw TestFailure(name, "clear() left rows behind");
+
+    try {
+        pshm::shm_table<uint32_t, float> other(name, flags::RDONLY, capacity);
+        throw TestFailure(name, "Opening with different columns should fail");
+    } catch (runtime_error&) {
+    }
+}
@@ -0,0 +1,140 @@
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include "./testing.hpp"
+
+#include <pshm/shm_task_pool.hpp>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace
+{
+    /** Names node offset of a binary tree kept in the arena. */
+    struct task {
+        uint32_t offset;
+        uint32_t depth;
+    };
+
+    constexpr size_t workers = 4;
+    constexpr uint32_t depth = 10;
+    constexpr size_t nodes = (size_t(1) << (depth + 1)) - 1;
+
+    struct arena {
+        /** Tasks queued or running. Whoever takes it to 0 stops the pool. */
+        std::atomic<uint64_t> outstanding;
+        /** Times each node was run. */
+        std::atomic<uint32_t> runs[nodes];
+    };
+
+    /** Runs tree tasks until the tree is done. */
+    void work(pshm::shm_task_pool<task>& pool, arena* a)
+    {
+        task t;
+        while (pool.next(t)) {
+            a->runs[t.offset].fetch_add(1, std::memory_order_relaxed);
+            if (t.depth > 0) {
+                a->outstanding.fetch_add(2, std::memory_order_relaxed);
+                for (uint32_t child = 1; child <= 2; ++child) {
+                    task c{t.offset * 2 + child, t.depth - 1};
+                    if (!pool.push(c))
+                        throw std::runtime_error("deque overflowed");
+                }
+            }
+            if (a->outstanding.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                pool.stop();
+        }
+    }
+} // namespace
+
+void run_test(const string& name)
+{
+    using pshm::flags;
+
+    cout << "Owner pops newest, thief steals oldest" << endl;
+    {
+        pshm::shm_task_pool<task> owner(name, flags::RDWR | flags::CREAT, 2, 5, 0);
+        pshm::shm_task_pool<task> thief(name, flags::RDWR, 2, 5, 1);
+        if (owner.capacity() != 8)
+            throw TestFailure(name, "Capacity wasn't rounded up to a power of two");
+
+        for (uint32_t i = 0; i < owner.capacity(); ++i) {
+            if (!owner.push(task{i, 0}))
+                throw TestFailure(name, "push() failed before the deque was full");
+        }
+        if (owner.push(task{99, 0}))
+            throw TestFailure(name, "push() succeeded on a full deque");
+        if (!thief.available() || thief.size(0) != owner.capacity())
+            throw TestFailure(name, "The thief can't see the owner's tasks");
+
+        task t;
+        if (!thief.steal(t, 0) || t.offset != 0)
+            throw TestFailure(name, "steal() didn't take the oldest task");
+        if (!owner.pop(t) || t.offset != 7)
+            throw TestFailure(name, "pop() didn't take the newest task");
+        if (thief.pop(t))
+            throw TestFailure(name, "pop() took from another worker's deque");
+        if (!thief.try_next(t) || t.offset != 1 || thief.steals() != 1)
+            throw TestFailure(name, "try_next() didn't fall back to stealing");
+
+        size_t left = 0;
+        while (owner.try_next(t))
+            left++;
+        if (left != 5 || owner.available())
+            throw TestFailure(name, "Tasks went missing");
+
+        thief.stop();
+        if (!owner.stopped() || owner.next(t))
+            throw TestFailure(name, "next() should return false after stop()");
+    }
+
+    cout << "Out of range worker" << endl;
+    try {
+        pshm::shm_task_pool<task> bad(name, flags::RDWR | flags::CREAT, 2, 8, 2);
+        throw TestFailure(name, "Joined as a worker that doesn't exist");
+    } catch (std::invalid_argument& ex) {
+        cout << "expected: " << ex.what() << endl;
+    }
+
+    cout << "Worker processes share a tree of " << nodes << " tasks" << endl;
+    const string pool_name = name + "_tree";
+    std::unique_ptr<pshm::shm_object> segment(pshm::make_shm_object(name + "_arena", flags::RDWR | flags::CREAT, sizeof(arena), 0));
+    arena* a = static_cast<arena*>(segment->get());
+    std::memset(static_cast<void*>(a), 0, sizeof(*a));
+
+    pshm::shm_task_pool<task> pool(pool_name, flags::RDWR | flags::CREAT, workers, 64, 0);
+    a->outstanding = 1;
+    pool.push(task{0, depth});
+
+    std::vector<pid_t> kids;
+    for (size_t id = 1; id < workers; ++id) {
+        pid_t kid = fork();
+        if (kid == -1)
+            throw runtime_error(string("fork() failed: ") + strerror(errno));
+        if (kid == 0) {
+            try {
+                pshm::shm_task_pool<task> mine(pool_name, flags::RDWR, workers, 64, id);
+                work(mine, a);
+            } catch (std::exception& ex) {
+                std::cerr << ex.what() << endl;
+                _exit(EXIT_FAILURE);
+            }
+            _exit(EXIT_SUCCESS);
+        }
+        kids.push_back(kid);
+    }
+    work(pool, a);
+    for (pid_t kid : kids) {
+        int wstatus;
+        if (waitpid(kid, &wstatus, 0) != kid || !WIFEXITED(wstatus) || WEXITSTATUS(wstatus) != 0)
+            throw TestFailure(name, "worker failed");
+    }
+
+    for (size_t i = 0; i < nodes; ++i) {
+        if (a->runs[i] != 1)
+            throw TestFailure(name, "Task " + std::to_string(i) + " ran " + std::to_string(a->runs[i]) + " times");
+    }
+    if (a->outstanding != 0 || pool.available())
+        throw TestFailure(name, "Tasks were left over");
+}
@@ -0,0 +1,80 @@
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include "./testing.hpp"
+
+#include <pshm/shm_time_series.hpp>
+
+#include <thread>
+
+void run_test(const string& name)
+{
+    using pshm::flags;
+    using series = pshm::shm_time_series<int64_t>;
+    const int64_t us = 1000;
+
+    series writer(name, flags::RDWR | flags::CREAT, 50);
+    series reader(name, flags::RDONLY, 50);
+    if (writer.capacity() != 63)
+        throw TestFailure(name, "Capacity should round up to 63");
+
+    series::sample_type s;
+    if (reader.latest(s) || reader.stats(0, 1000 * us).count != 0)
+        throw TestFailure(name, "A new series should be empty");
+
+    cout << "Appending 100 samples to a ring of 63" << endl;
+    for (int64_t i = 0; i < 100; ++i)
+        writer.append(i * us, i);
+    if (reader.size() != 63)
+        throw TestFailure(name, "Expected 63 samples but have " + to_string(reader.size()));
+    if (!reader.latest(s) || s.timestamp != 99 * us || s.value != 99)
+        throw TestFailure(name, "latest() isn't the newest sample");
+
+    series::stats_type st = reader.stats(90 * us, 99 * us);
+    if (st.count != 10 || st.sum != 945 || st.min != 90 || st.max != 99 || st.mean() != 94.5)
+        throw TestFailure(name, "stats() over [90, 99] is wrong");
+
+    st = reader.stats(std::chrono::microseconds(5));
+    if (st.count != 6 || st.min != 94)
+        throw TestFailure(name, "stats() over the last 5us is wrong");
+
+    st = reader.stats(0, 1000 * us);
+    if (st.count != 63 || st.min != 37)
+        throw TestFailure(name, "Samples the ring dropped were counted");
+
+    int64_t p = 0;
+    if (!reader.percentile(90 * us, 99 * us, 50, p) || p != 94)
+        throw TestFailure(name, "Median of [90, 99] should be 94, got " + to_string(p));
+    if (!reader.percentile(90 * us, 99 * us, 100, p) || p != 99)
+        throw TestFailure(name, "p100 should be the max");
+    if (reader.percentile(200 * us, 300 * us, 50, p))
+        throw TestFailure(name, "percentile() of an empty window should fail");
+
+    std::vector<series::sample_type> samples;
+    if (reader.copy(97 * us, 1000 * us, samples) != 3 || samples.front().value != 97 || samples.back().value != 99)
+        throw TestFailure(name, "copy() should return the window oldest first");
+
+    cout << "Reading while the writer laps the ring" << endl;
+    std::atomic<bool> stop(false);
+    std::thread appender([&]() {
+        for (int64_t i = 100; !stop.load(std::memory_order_relaxed); ++i)
+            writer.append(i * us, i);
+    });
+    try {
+        for (int n = 0; n < 2000; ++n) {
+            reader.copy(0, std::numeric_limits<int64_t>::max(), samples);
+            for (size_t i = 0; i < samples.size(); ++i) {
+                if (samples[i].timestamp != samples[i].value * us)
+                    throw TestFailure(name, "Torn sample " + to_string(samples[i].value));
+                if (i > 0 && samples[i].value != samples[i - 1].value + 1)
+                    throw TestFailure(name, "Samples aren't consecutive");
+            }
+        }
+    } catch (...) {
+        stop = true;
+        appender.join();
+        throw;
+    }
+    stop = true;
+    appender.join();
+}
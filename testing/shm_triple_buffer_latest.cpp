@@ -0,0 +1,73 @@
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include "./testing.hpp"
+
+#include <pshm/shm_triple_buffer.hpp>
+
+namespace
+{
+    /** Big enough that copying it around would hurt. */
+    struct Frame {
+        uint64_t number;
+        uint8_t pixels[1 << 20];
+    };
+
+    void write_frame(pshm::shm_triple_buffer<Frame>& writer, uint64_t number)
+    {
+        Frame& f = writer.write_buffer();
+        f.number = number;
+        memset(f.pixels, static_cast<int>(number & 0xff), sizeof(f.pixels));
+        writer.publish();
+    }
+
+    void check_frame(const string& name, const Frame& f, uint64_t number)
+    {
+        if (f.number != number)
+            throw TestFailure(name, "frame number is " + to_string(f.number) + " but " + to_string(number) + " was expected");
+        for (size_t i = 0; i < sizeof(f.pixels); i += 4096) {
+            if (f.pixels[i] != (number & 0xff))
+                throw TestFailure(name, "frame " + to_string(number) + " is torn at pixel " + to_string(i));
+        }
+    }
+} // namespace
+
+void run_test(const string& name)
+{
+    using pshm::flags;
+
+    pshm::shm_triple_buffer<Frame> writer(name);
+    pshm::shm_triple_buffer<Frame> reader(name, flags::RDWR);
+
+    if (reader.fresh())
+        throw TestFailure(name, "nothing has been published yet");
+
+    cout << "Publishing one frame" << endl;
+    write_frame(writer, 1);
+    if (!reader.fresh())
+        throw TestFailure(name, "reader should see a fresh frame");
+    const Frame& first = reader.read();
+    check_frame(name, first, 1);
+
+    cout << "Publishing frames faster than they're read" << endl;
+    for (uint64_t n = 2; n <= 5; ++n) {
+        write_frame(writer, n);
+        /* The frame the reader holds must not change under it. */
+        check_frame(name, first, 1);
+    }
+
+    const Frame& latest = reader.read();
+    check_frame(name, latest, 5);
+    if (reader.fresh())
+        throw TestFailure(name, "no new frame since the last read");
+    if (&reader.read() != &latest)
+        throw TestFailure(name, "read() without a new frame should return the same slot");
+
+    cout << "Reattaching the writer" << endl;
+    {
+        pshm::shm_triple_buffer<Frame> restarted(name, flags::RDWR);
+        write_frame(restarted, 6);
+        check_frame(name, latest, 5);
+    }
+    check_frame(name, reader.read(), 6);
+}
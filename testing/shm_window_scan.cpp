@@ -0,0 +1,105 @@
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include "./testing.hpp"
+
+#include <pshm/residency.hpp>
+#include <pshm/shm_window.hpp>
+
+namespace
+{
+    uint8_t pattern(uint64_t i)
+    {
+        return static_cast<uint8_t>((i * 31) ^ (i >> 12));
+    }
+
+    /**
+     * @brief Read every window and check it against the pattern.
+     *
+     * @returns the number of windows.
+     */
+    size_t scan(const string& name, pshm::shm_window& window, uint64_t object_size)
+    {
+        size_t windows = 0;
+        uint64_t expected_offset = 0;
+        do {
+            if (window.offset() != expected_offset)
+                throw TestFailure(name, "Window at " + to_string(window.offset()) + " but expected " + to_string(expected_offset));
+            uint64_t want = std::min<uint64_t>(window.window_size(), object_size - expected_offset);
+            if (window.size() != want)
+                throw TestFailure(name, "Window at " + to_string(window.offset()) + " has " + to_string(window.size()) + " bytes");
+
+            const uint8_t* p = static_cast<const uint8_t*>(window.data());
+            for (size_t i = 0; i < window.size(); ++i) {
+                if (p[i] != pattern(window.offset() + i))
+                    throw TestFailure(name, "Wrong byte at " + to_string(window.offset() + i));
+            }
+            expected_offset += window.window_size();
+            windows++;
+        } while (window.advance());
+
+        if (window.data() != nullptr || window.size() != 0)
+            throw TestFailure(name, "Window past the end should be empty");
+        return windows;
+    }
+} // namespace
+
+void run_test(const string& name)
+{
+    using pshm::flags;
+    const size_t page = pshm::page_size();
+    const size_t window_size = 4 * page;
+    const uint64_t object_size = 10 * page + 123;
+
+    shm_object_unique_ptr object(pshm::make_shm_object(name, flags::RDWR | flags::CREAT | flags::EXCL, object_size, 0));
+    uint8_t* p = static_cast<uint8_t*>(object->get());
+    for (uint64_t i = 0; i < object_size; ++i)
+        p[i] = pattern(i);
+
+    for (bool prefetch : {true, false}) {
+        cout << "Scanning " << name << (prefetch ? " with" : " without") << " prefetch" << endl;
+        pshm::shm_window window(name, flags::RDONLY, window_size, prefetch);
+        if (window.object_size() != object_size)
+            throw TestFailure(name, "shm_window::object_size() is " + to_string(window.object_size()));
+
+        size_t windows = scan(name, window, object_size);
+        if (windows != 3)
+            throw TestFailure(name, "Expected 3 windows but got " + to_string(windows));
+
+        /* Skip around so prefetched windows go unused. */
+        for (int i = 0; i < 8; ++i) {
+            uint64_t offset = (i % 3) * window_size;
+            if (!window.seek(offset) || static_cast<const uint8_t*>(window.data())[0] != pattern(offset))
+                throw TestFailure(name, "seek() to " + to_string(offset) + " failed");
+        }
+
+        /* Jump back into the middle, then keep going from there. */
+        if (!window.seek(window_size))
+            throw TestFailure(name, "seek() back into the object failed");
+        if (window.offset() != window_size || static_cast<const uint8_t*>(window.data())[1] != pattern(window_size + 1))
+            throw TestFailure(name, "seek() landed in the wrong place");
+        if (!window.advance() || window.offset() != 2 * window_size || window.advance())
+            throw TestFailure(name, "advance() after seek() went astray");
+
+        try {
+            window.seek(page / 2);
+            throw TestFailure(name, "seek() to an offset that isn't page aligned should fail");
+        } catch (std::invalid_argument&) {
+        }
+    }
+
+    cout << "Writing through a window" << endl;
+    {
+        pshm::shm_window window(name, flags::RDWR, window_size);
+        window.seek(2 * window_size);
+        static_cast<uint8_t*>(window.data())[0] = 0xAB;
+    }
+    if (p[2 * window_size] != 0xAB)
+        throw TestFailure(name, "Write through the window isn't visible in the object");
+
+    try {
+        pshm::shm_window window(name, flags::RDONLY, page + 1);
+        throw TestFailure(name, "A window size that isn't a page multiple should fail");
+    } catch (std::invalid_argument&) {
+    }
+}
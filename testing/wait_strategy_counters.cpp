@@ -0,0 +1,83 @@
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+#include "./testing.hpp"
+
+#include <pshm/shm_broadcast_ring.hpp>
+#include <pshm/wait_strategy.hpp>
+
+#include <chrono>
+#include <thread>
+
+namespace
+{
+    constexpr size_t capacity = 4096;
+
+    /**
+     * @brief Wait with strategy while another thread publishes a bit later.
+     */
+    template <class Strategy>
+    pshm::wait_stats wait_for_publish(const string& name, pshm::shm_broadcast_ring& ring, pshm::shm_broadcast_subscriber& sub, Strategy strategy)
+    {
+        std::thread writer([&ring] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            ring.publish("x", 1);
+        });
+        bool ok = sub.wait_for(strategy, std::chrono::seconds(5));
+        writer.join();
+        if (!ok)
+            throw TestFailure(name, "timed out waiting for a record");
+
+        pshm::shm_broadcast_subscriber::record rec;
+        if (sub.next(rec) != pshm::shm_broadcast_subscriber::status::ok)
+            throw TestFailure(name, "wait returned without a record");
+
+        pshm::wait_stats st = strategy.stats();
+        cout << "spins " << st.spins << " yields " << st.yields << " parks " << st.parks << endl;
+        return st;
+    }
+} // namespace
+
+void run_test(const string& name)
+{
+    using pshm::flags;
+
+    pshm::shm_broadcast_ring ring(name, flags::RDWR | flags::CREAT, capacity);
+    pshm::shm_broadcast_subscriber sub(name, flags::RDWR, capacity);
+
+    pshm::wait_stats st = wait_for_publish(name, ring, sub, pshm::busy_spin());
+    if (st.spins == 0 || st.yields != 0 || st.parks != 0)
+        throw TestFailure(name, "busy_spin should only spin");
+
+    st = wait_for_publish(name, ring, sub, pshm::spin_yield(10));
+    if (st.spins != 10 || st.yields == 0 || st.parks != 0)
+        throw TestFailure(name, "spin_yield should spin 10 times then yield");
+
+    st = wait_for_publish(name, ring, sub, pshm::spin_park(10));
+    if (st.spins != 10 || st.parks == 0)
+        throw TestFailure(name, "spin_park should spin 10 times then park");
+
+    st = wait_for_publish(name, ring, sub, pshm::timed_backoff(10));
+    if (st.spins != 10 || st.parks == 0)
+        throw TestFailure(name, "timed_backoff should spin 10 times then sleep");
+
+    /* Nothing is published: every strategy must give up. */
+    pshm::spin_park park(10);
+    if (sub.wait_for(park, std::chrono::milliseconds(10)))
+        throw TestFailure(name, "spin_park wait_for() returned true without a record");
+    pshm::timed_backoff backoff;
+    if (sub.wait_for(backoff, std::chrono::milliseconds(10)))
+        throw TestFailure(name, "timed_backoff wait_for() returned true without a record");
+
+    /* Strategies that don't park never write, so read only subscribers can use them. */
+    pshm::shm_broadcast_subscriber reader(name, flags::RDONLY, capacity);
+    pshm::busy_spin spin;
+    if (reader.wait_for(spin, std::chrono::milliseconds(1)))
+        throw TestFailure(name, "busy_spin wait_for() returned true without a record");
+    try {
+        reader.wait_for(park, std::chrono::milliseconds(1));
+        throw TestFailure(name, "spin_park on a read only subscriber should throw");
+    } catch (runtime_error& ex) {
+        cout << "expected: " << ex.what() << endl;
+    }
+}
@@ -0,0 +1,461 @@
+// SPDX-License-Identifier: Zlib
+// Copyright 2022-Current, Terry M. Poulin.
+
+/*
+ * pshm-inspect: list the shared memory objects under /dev/shm.
+ *
+ * For each object reports the size, how much of it is resident, and which
+ * processes currently map it or hold it open. Optionally removes stale
+ * objects, i.e. objects that no process maps or holds open anymore, such as
+ * those left behind by a crashed producer. Objects created with
+ * pshm::flags::HEADER also have their pshm::segment_header reported, and
+ * those created with pshm::flags::PERSISTENT are never considered stale.
+ */
+
+#include <pshm/config.hpp>
+#include <pshm/residency.hpp>
+#include <pshm/segment_header.hpp>
+#include <pshm/stdcpp.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <set>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::map;
+using std::runtime_error;
+using std::set;
+using std::string;
+using std::vector;
+
+namespace
+{
+    /** Where Linux mounts the tmpfs backing shm_open(). */
+    const string shm_dir = "/dev/shm";
+
+    /**
+     * @brief Copy of the interesting bits of a pshm::segment_header.
+     */
+    struct header_info {
+        uint32_t state;
+        uint32_t version;
+        uint32_t library_version;
+        uint64_t payload_size;
+        uint64_t payload_offset;
+        uint64_t alignment;
+        uint64_t layout_hash;
+        uint8_t lifetime;
+    };
+
+    /**
+     * @brief Information about one shared memory object.
+     */
+    struct segment_info {
+        string name;
+        size_t size;
+        size_t resident;
+        set<pid_t> pids;
+        bool has_header;
+        header_info header;
+    };
+
+    /**
+     * @brief Command line options.
+     */
+    struct options {
+        bool remove_stale = false;
+        bool dry_run = false;
+        string prefix;
+        set<string> names;
+    };
+
+    void usage(std::ostream& os, const char* prog)
+    {
+        os << "usage: " << prog << " [options] [name ...]" << endl
+           << endl
+           << "List shared memory objects under " << shm_dir << "." << endl
+           << endl
+           << "Options:" << endl
+           << "  -p, --prefix PREFIX   only consider objects whose name starts with PREFIX." << endl
+           << "  -r, --remove-stale    shm_unlink() objects that no process maps or holds open," << endl
+           << "                        except those created with flags::PERSISTENT." << endl
+           << "                        Requires a name or --prefix." << endl
+           << "  -n, --dry-run         with --remove-stale: report but do not unlink." << endl
+           << "  -V, --version         print the pshm version." << endl
+           << "  -h, --help            print this help." << endl;
+    }
+
+    /**
+     * @brief Strip the leading '/' that portable shm names use.
+     *
+     * @param name as given on the command line.
+     * @returns name as it appears under shm_dir.
+     */
+    string strip_slash(const string& name)
+    {
+        if (!name.empty() && name.front() == '/')
+            return name.substr(1);
+        return name;
+    }
+
+    bool selected(const options& opts, const string& name)
+    {
+        if (!opts.names.empty() && opts.names.count(name) == 0)
+            return false;
+        return name.compare(0, opts.prefix.size(), opts.prefix) == 0;
+    }
+
+    /**
+     * @brief Count resident pages of the object with mincore().
+     *
+     * Maps the object read only and asks the kernel which pages are in core.
+     * This does not fault anything in.
+     *
+     * @param path the file under shm_dir.
+     * @param size the size of the object.
+     * @returns the number of resident bytes.
+     * @throws runtime_error on failure.
+     */
+    size_t resident_bytes(const string& path, size_t size)
+    {
+        if (size == 0)
+            return 0;
+
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd == -1)
+            throw runtime_error("open() failed: " + path + ": " + std::strerror(errno));
+
+        void* p = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        int error = errno;
+        ::close(fd);
+        if (p == MAP_FAILED)
+            throw runtime_error("mmap() failed: " + path + ": " + std::strerror(error));
+
+        size_t resident;
+        try {
+            resident = pshm::resident_bytes(p, size);
+        } catch (runtime_error& ex) {
+            ::munmap(p, size);
+            throw runtime_error(string(ex.what()) + ": " + path);
+        }
+        ::munmap(p, size);
+        return std::min(resident, size);
+    }
+
+    /**
+     * @brief Read the pshm::segment_header, if there is one.
+     *
+     * @param path the file under shm_dir.
+     * @param info where to store the header.
+     * @returns true if the object starts with a pshm::segment_header.
+     */
+    bool read_header(const string& path, header_info& info)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd == -1)
+            return false;
+        pshm::segment_header header;
+        ssize_t n = ::pread(fd, &header, sizeof(header), 0);
+        ::close(fd);
+        if (n != static_cast<ssize_t>(sizeof(header)) || header.magic != pshm::segment_header::MAGIC)
+            return false;
+
+        info.state = header.state.load(std::memory_order_relaxed);
+        info.version = header.version;
+        info.library_version = header.library_version;
+        info.payload_size = header.payload_size;
+        info.payload_offset = header.payload_offset;
+        info.alignment = header.alignment;
+        info.layout_hash = header.layout_hash;
+        info.lifetime = header.lifetime;
+        return true;
+    }
+
+    const char* state_name(uint32_t state)
+    {
+        switch (state) {
+            case pshm::segment_header::UNINITIALIZED:
+                return "uninitialized";
+            case pshm::segment_header::INITIALIZING:
+                return "initializing";
+            case pshm::segment_header::READY:
+                return "ready";
+            default:
+                return "unknown";
+        }
+    }
+
+    const char* lifetime_name(uint8_t lifetime)
+    {
+        switch (lifetime) {
+            case pshm::segment_header::LIFETIME_OWNER:
+                return "owner";
+            case pshm::segment_header::LIFETIME_LAST:
+                return "last";
+            case pshm::segment_header::LIFETIME_PERSISTENT:
+                return "persistent";
+            default:
+                return "unknown";
+        }
+    }
+
+    /**
+     * @returns true if the object was created with pshm::flags::PERSISTENT.
+     */
+    bool persistent(const segment_info& info)
+    {
+        return info.has_header && info.header.lifetime == pshm::segment_header::LIFETIME_PERSISTENT;
+    }
+
+    /**
+     * @brief Name of the object a /proc path refers to.
+     *
+     * @param path from /proc/PID/maps or a /proc/PID/fd link.
+     * @param name set to the object's name under shm_dir.
+     * @returns false if path isn't under shm_dir.
+     */
+    bool object_name(const string& path, string& name)
+    {
+        const string needle = shm_dir + "/";
+        const string deleted = " (deleted)";
+
+        size_t i = path.find(needle);
+        if (i == string::npos)
+            return false;
+        name = path.substr(i + needle.size());
+        if (name.size() > deleted.size() && name.compare(name.size() - deleted.size(), deleted.size(), deleted) == 0)
+            name.erase(name.size() - deleted.size());
+        return true;
+    }
+
+    /**
+     * @brief Find which processes map or hold open which objects.
+     *
+     * Scans /proc/PID/maps for mappings of files under shm_dir, and the
+     * /proc/PID/fd links for descriptors of them. A process between
+     * shm_open() and mmap(), or a shm_window between windows, only shows up in
+     * the latter. Processes we are not allowed to inspect are silently
+     * skipped, so run as root for the complete picture.
+     *
+     * @returns map of object name to the set of processes using it.
+     */
+    map<string, set<pid_t>> attached_pids()
+    {
+        map<string, set<pid_t>> result;
+
+        DIR* proc = ::opendir("/proc");
+        if (proc == nullptr)
+            throw runtime_error(string("opendir() failed: /proc: ") + std::strerror(errno));
+
+        while (struct dirent* entry = ::readdir(proc)) {
+            char* end = nullptr;
+            long pid = std::strtol(entry->d_name, &end, 10);
+            if (pid <= 0 || *end != '\0')
+                continue;
+
+            const string dir = string("/proc/") + entry->d_name;
+            string name;
+
+            std::ifstream maps(dir + "/maps");
+            string line;
+            while (std::getline(maps, line)) {
+                if (object_name(line, name))
+                    result[name].insert(static_cast<pid_t>(pid));
+            }
+
+            DIR* fds = ::opendir((dir + "/fd").c_str());
+            if (fds == nullptr)
+                continue;
+            while (struct dirent* fd = ::readdir(fds)) {
+                char target[PATH_MAX];
+                ssize_t n = ::readlink((dir + "/fd/" + fd->d_name).c_str(), target, sizeof(target));
+                if (n > 0 && object_name(string(target, static_cast<size_t>(n)), name))
+                    result[name].insert(static_cast<pid_t>(pid));
+            }
+            ::closedir(fds);
+        }
+        ::closedir(proc);
+
+        return result;
+    }
+
+    /**
+     * @brief Gather information on the selected objects.
+     */
+    vector<segment_info> scan(const options& opts)
+    {
+        vector<segment_info> segments;
+        map<string, set<pid_t>> pids = attached_pids();
+
+        DIR* dir = ::opendir(shm_dir.c_str());
+        if (dir == nullptr)
+            throw runtime_error("opendir() failed: " + shm_dir + ": " + std::strerror(errno));
+
+        while (struct dirent* entry = ::readdir(dir)) {
+            string name = entry->d_name;
+            if (name == "." || name == ".." || !selected(opts, name))
+                continue;
+
+            string path = shm_dir + "/" + name;
+            struct stat st;
+            if (::stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+                continue;
+
+            segment_info info;
+            info.name = name;
+            info.size = static_cast<size_t>(st.st_size);
+            try {
+                info.resident = resident_bytes(path, info.size);
+            } catch (runtime_error& ex) {
+                cerr << "pshm-inspect: " << ex.what() << endl;
+                info.resident = 0;
+            }
+            info.pids = pids[name];
+            info.has_header = read_header(path, info.header);
+            segments.push_back(info);
+        }
+        ::closedir(dir);
+
+        std::sort(segments.begin(), segments.end(), [](const segment_info& a, const segment_info& b) {
+            return a.name < b.name;
+        });
+        return segments;
+    }
+
+    void print(const vector<segment_info>& segments)
+    {
+        cout << std::left
+             << std::setw(32) << "NAME" << ' '
+             << std::right
+             << std::setw(14) << "SIZE" << ' '
+             << std::setw(14) << "RESIDENT" << ' '
+             << "PIDS" << endl;
+
+        for (const segment_info& info : segments) {
+            cout << std::left
+                 << std::setw(32) << ("/" + info.name) << ' '
+                 << std::right
+                 << std::setw(14) << info.size << ' '
+                 << std::setw(14) << info.resident << ' ';
+            if (info.pids.empty()) {
+                cout << '-';
+            } else {
+                const char* sep = "";
+                for (pid_t pid : info.pids) {
+                    cout << sep << pid;
+                    sep = ",";
+                }
+            }
+            cout << endl;
+
+            if (info.has_header) {
+                const header_info& h = info.header;
+                cout << "    header: version " << h.version
+                     << " library " << h.library_version
+                     << " payload " << h.payload_size << " at " << h.payload_offset
+                     << " alignment " << h.alignment
+                     << " layout 0x" << std::hex << h.layout_hash << std::dec
+                     << " state " << state_name(h.state)
+                     << " lifetime " << lifetime_name(h.lifetime)
+                     << endl;
+            }
+        }
+    }
+
+    /**
+     * @brief Unlink objects that nothing maps or holds open.
+     *
+     * Persistent objects are meant to sit unused between runs of their
+     * producer, so they are skipped.
+     *
+     * @returns the number of objects that could not be removed.
+     */
+    int remove_stale(const vector<segment_info>& segments, bool dry_run)
+    {
+        int failures = 0;
+
+        for (const segment_info& info : segments) {
+            if (!info.pids.empty())
+                continue;
+
+            string name = "/" + info.name;
+            if (persistent(info)) {
+                cout << "keeping persistent " << name << endl;
+                continue;
+            }
+            if (dry_run) {
+                cout << "would remove stale " << name << endl;
+                continue;
+            }
+            if (::shm_unlink(name.c_str()) != 0) {
+                cerr << "pshm-inspect: shm_unlink() failed: " << name << ": " << std::strerror(errno) << endl;
+                failures++;
+                continue;
+            }
+            cout << "removed stale " << name << endl;
+        }
+
+        return failures;
+    }
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    options opts;
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            usage(cout, argv[0]);
+            return 0;
+        } else if (arg == "-V" || arg == "--version") {
+            cout << "pshm-inspect " << PSHM_VERSION_STRING << endl;
+            return 0;
+        } else if (arg == "-r" || arg == "--remove-stale") {
+            opts.remove_stale = true;
+        } else if (arg == "-n" || arg == "--dry-run") {
+            opts.dry_run = true;
+        } else if (arg == "-p" || arg == "--prefix") {
+            if (++i == argc) {
+                usage(cerr, argv[0]);
+                return 2;
+            }
+            opts.prefix = strip_slash(argv[i]);
+        } else if (!arg.empty() && arg.front() == '-') {
+            usage(cerr, argv[0]);
+            return 2;
+        } else {
+            opts.names.insert(strip_slash(arg));
+        }
+    }
+
+    /* Too easy to wipe out some other program's persistent objects otherwise. */
+    if (opts.remove_stale && opts.names.empty() && opts.prefix.empty()) {
+        cerr << "pshm-inspect: --remove-stale requires a name or --prefix" << endl;
+        return 2;
+    }
+
+    try {
+        vector<segment_info> segments = scan(opts);
+        print(segments);
+        if (opts.remove_stale)
+            return remove_stale(segments, opts.dry_run) == 0 ? 0 : 1;
+    } catch (std::exception& ex) {
+        cerr << "pshm-inspect: " << ex.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}